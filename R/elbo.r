@@ -1,13 +1,15 @@
 #' Compute the Evidence Lower Bound (ELBO)
 #'
 #' @param fit the fit model.
-#' @param y response vector.
-#' @param X input matrix.
-#' @param mcn number of Monte-Carlo samples.
+#' @param y response vector, may be omitted if the fit contains a model handle, see \code{return_model} in \code{gsvb.fit}.
+#' @param X input matrix, may be omitted if the fit contains a model handle.
+#' @param mcn number of Monte-Carlo samples drawn per batch.
+#' @param tol target std. error of the Monte-Carlo estimate, relative to the magnitude of the estimate (absolute for estimates below 1). Batches of \code{mcn} samples are drawn until the relative std. error is below \code{tol}. If 0 a single batch is drawn.
+#' @param max_mcn maximum number of Monte-Carlo samples.
 #' @param approx elements of gamma less than an approximation threshold are not used in computations.
 #' @param approx_thresh the threshold below which elements of gamma are not used.
 #'
-#' @return the ELBO (numeric)
+#' @return the ELBO (numeric) with the Monte-Carlo std. error of the estimate as the attribute \code{"se"}.
 #' 
 #' @section Details: TODO
 #'
@@ -25,8 +27,17 @@
 #' gsvb.elbo(f, y, X, groups) 
 #'
 #' @export
-gsvb.elbo <- function(fit, y, X, mcn=5e2, approx=FALSE, approx_thresh=1e-3)
+gsvb.elbo <- function(fit, y, X, mcn=5e2, tol=0, max_mcn=1e5, approx=FALSE,
+    approx_thresh=1e-3)
 {
+    # use the data and state kept by the model handle
+    if (missing(y) && missing(X) && !is.null(fit$model)) {
+	res <- model_elbo(fit$model, mcn, tol, max_mcn, approx, approx_thresh)
+	return(structure(res[1], se=res[2]))
+    }
+
+    fit <- gsvb.expand(fit)
+
     n <- nrow(X)
     p <- ncol(X)
     groups <- fit$parameters$groups
@@ -40,17 +51,17 @@ gsvb.elbo <- function(fit, y, X, mcn=5e2, approx=FALSE, approx_thresh=1e-3)
 	yx <- t(X) %*% y
 	xtx <- t(X) %*% X
 
-	res <- ifelse(fit$parameters$diag_covariance,
-	    elbo_linear_c(yty, yx, xtx, groups, n, p, fit$mu, fit$s, fit$g[groups],
-	    fit$tau_a, fit$tau_b, fit$parameters$lambda, fit$parameters$a0, 
-	    fit$parameters$b0, fit$parameters$tau_a0, fit$parameters$tau_b0,
-	    mcn, approx, approx_thresh),
-
-	    elbo_linear_u(yty, yx, xtx, groups, n, p, fit$mu, fit$s, fit$g[groups],
-	    fit$tau_a, fit$tau_b, fit$parameters$lambda, fit$parameters$a0, 
-	    fit$parameters$b0, fit$parameters$tau_a0, fit$parameters$tau_b0,
-	    mcn, approx, approx_thresh)
-	)
+	if (fit$parameters$diag_covariance) {
+	    res <- elbo_linear_c(yty, yx, xtx, groups, n, p, fit$mu, fit$s, 
+		fit$g[groups], fit$tau_a, fit$tau_b, fit$parameters$lambda, 
+		fit$parameters$a0, fit$parameters$b0, fit$parameters$tau_a0, 
+		fit$parameters$tau_b0, mcn, tol, max_mcn, approx, approx_thresh)
+	} else {
+	    res <- elbo_linear_u(yty, yx, xtx, groups, n, p, fit$mu, fit$s, 
+		fit$g[groups], fit$tau_a, fit$tau_b, fit$parameters$lambda, 
+		fit$parameters$a0, fit$parameters$b0, fit$parameters$tau_a0, 
+		fit$parameters$tau_b0, mcn, tol, max_mcn, approx, approx_thresh)
+	}
     } 
     else if (any(fit$parameters$family == c(2,3,4))) 
     {
@@ -68,20 +79,21 @@ gsvb.elbo <- function(fit, y, X, mcn=5e2, approx=FALSE, approx_thresh=1e-3)
 	w <- fit$parameters$a0 / (fit$parameters$a0 + fit$parameters$b0)
 
 	res <- elbo_logistic(y, X, groups, fit$mu, s, fit$g[groups], Ss,
-	    fit$parameters$lambda, w, mcn, fit$parameters$diag_covariance)
+	    fit$parameters$lambda, w, mcn, tol, max_mcn, 
+	    fit$parameters$diag_covariance)
     }
     else if (fit$parameters$family == 5) {
 	w <- fit$parameters$a0 / (fit$parameters$a0 + fit$parameters$b0)
 	
 	if (fit$parameters$diag_covariance) {
 	    res <- elbo_poisson(y, X, groups, fit$mu, fit$s, fit$g[groups],	
-		fit$parameters$lambda, w, mcn);
+		fit$parameters$lambda, w, mcn, tol, max_mcn);
 	} else {
 	    res <- elbo_poisson_S(y, X, groups, fit$mu, fit$s, fit$g[groups],	
-		fit$parameters$lambda, w, mcn);
+		fit$parameters$lambda, w, mcn, tol, max_mcn);
 	}
     }
 
 
-    return(res)
+    return(structure(res[1], se=res[2]))
 }
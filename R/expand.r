@@ -0,0 +1,55 @@
+#' Expand a compact fit
+#'
+#' @param fit fit model returned by \code{gsvb.fit} with \code{compact=TRUE}
+#'
+#' @return the fit with \code{mu}, \code{s}, \code{g} and \code{beta_hat} given for every group. Dense fits are returned unchanged.
+#'
+#' @section Details:
+#' Groups that were dropped from the compact fit have \code{g = 0}, \code{mu = 0} and unit std. devs., or an identity covariance matrix, so they do not contribute to the posterior mean or the predictive.
+#'
+#' @examples
+#' n <- 100
+#' p <- 1000
+#' gsize <- 5
+#' groups <- c(rep(1:(p/gsize), each=gsize))
+#'
+#' X <- matrix(rnorm(n * p), nrow=n, ncol=p)
+#' b <- c(rep(0, gsize), rep(-4, gsize), rep(8, gsize), rep(0, p - 3 * gsize))
+#' y <- X %*% b + rnorm(n, 0, 1)
+#'
+#' f <- gsvb.fit(y, X, groups, compact=TRUE)
+#' f$active
+#' beta_hat <- gsvb.expand(f)$beta_hat
+#'
+#' @export
+gsvb.expand <- function(fit)
+{
+    if (!isTRUE(fit$parameters$compact))
+	return(fit)
+
+    groups <- fit$parameters$groups
+    idx <- which(groups %in% fit$active)
+
+    mu <- numeric(length(groups))
+    mu[idx] <- fit$mu
+
+    g <- numeric(max(groups))
+    g[fit$active] <- fit$g
+
+    if (fit$parameters$diag_covariance) {
+	s <- rep(1, length(groups))
+	s[idx] <- fit$s
+    } else {
+	s <- lapply(tabulate(groups), diag)
+	s[fit$active] <- fit$s
+    }
+
+    fit$mu <- mu
+    fit$s <- s
+    fit$g <- g
+    fit$beta_hat <- mu * g[groups]
+    fit$active <- NULL
+    fit$parameters$compact <- FALSE
+
+    return(fit)
+}
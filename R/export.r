@@ -0,0 +1,63 @@
+#' Export a fit to a binary model file
+#'
+#' @param fit the fit model.
+#' @param file path of the model file.
+#' @param min_g groups with an inclusion probability below \code{min_g} are not stored.
+#'
+#' @return the sum of the inclusion probabilities of the groups that were not stored, invisibly.
+#'
+#' @section Details:
+#' The file stores the stored groups, their inclusion probabilities, means and the std. devs. or the Cholesky factor of their covariance. The format is versioned and every section is 64 byte aligned, so it can be memory mapped and scored in C++ with the header-only scorer in \code{system.file("include", "gsvb_scorer.h", package="gsvb")}. Files use the native byte order.
+#'
+#' @examples
+#' n <- 100
+#' p <- 1000
+#' gsize <- 5
+#' groups <- c(rep(1:(p/gsize), each=gsize))
+#'
+#' X <- matrix(rnorm(n * p), nrow=n, ncol=p)
+#' b <- c(rep(0, gsize), rep(-4, gsize), rep(8, gsize), rep(0, p - 3 * gsize))
+#' y <- X %*% b + rnorm(n, 0, 1)
+#'
+#' f <- gsvb.fit(y, X, groups)
+#' file <- tempfile(fileext=".gsvb")
+#' gsvb.export(f, file)
+#' gsvb.score(file, X)
+#'
+#' @export
+gsvb.export <- function(fit, file, min_g=1e-3)
+{
+    fit <- gsvb.expand(fit)
+    diag_cov <- fit$parameters$diag_covariance
+    family <- fit$parameters$family
+
+    dropped <- model_write(path.expand(file), fit$mu,
+	if (diag_cov) fit$s else numeric(0), if (diag_cov) list() else fit$s,
+	fit$g, fit$parameters$groups, diag_cov, family,
+	if (family == 1) fit$tau_a else 0, if (family == 1) fit$tau_b else 0,
+	fit$parameters$intercept, min_g)
+
+    return(invisible(dropped))
+}
+
+
+#' Score new data with a binary model file
+#'
+#' @param file path of a model file written by \code{gsvb.export}.
+#' @param newdata input feature matrix.
+#'
+#' @return a list with the mean and variance, \code{var}, of the posterior predictive and the mean and variance of the linear predictor, \code{eta_mean} and \code{eta_var}.
+#'
+#' @section Details:
+#' The moments are computed as in \code{gsvb.predict} with \code{type="moments"} using the groups stored in the file.
+#'
+#' @export
+gsvb.score <- function(file, newdata)
+{
+    if (!is.matrix(newdata))
+	stop("newdata must be a matrix")
+
+    res <- model_score(path.expand(file), newdata)
+
+    return(lapply(res, as.vector))
+}
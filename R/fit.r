@@ -19,23 +19,48 @@
 #' @param tau_a0 shape parameter for the inverse-Gamma(a0, b0) prior on the variance, tau^2.
 #' @param tau_b0 scale parameter for the inverse-Gamma(a0, b0) prior on the variance, tau^2.
 #' @param mu initial values of mu, the means of the variational family.
-#' @param s initial values of s, the std. dev of the variational family.
+#' @param s initial values of s, the std. dev of the variational family. If \code{NULL} then \eqn{s_j = (\| x_j \|^2 \tau_{a0} / \tau_{b0} + 2 \lambda)^{-1/2}}.
 #' @param g initial values of g, the group inclusion probabilities of the variational family.
 #' @param track_elbo track the evidence lower bound (ELBO).
-#' @param track_elbo_every the number of iterations between computing the ELBO.
-#' @param track_elbo_mcn number of Monte-Carlo samples to compute the ELBO.
+#' @param track_elbo_every the number of iterations between recording the ELBO. The closed form terms of the ELBO are maintained incrementally as each group is updated and the Monte-Carlo terms are evaluated on a background thread, which keeps an estimate for each group and only re-estimates the groups updated since the previous recorded ELBO, with up to \code{track_elbo_max} samples of the coefficients of each group. If the evaluation falls behind the fit, the fit waits for it, so on large models a larger \code{track_elbo_every} or a smaller \code{track_elbo_max} keeps the cost down.
+#' @param track_elbo_mcn number of Monte-Carlo samples drawn per batch when computing the ELBO.
+#' @param track_elbo_tol target std. error of the Monte-Carlo estimate of each group's term of the ELBO, relative to the magnitude of the estimate (absolute for estimates below 1). Samples are drawn in batches of \code{track_elbo_mcn} until the relative std. error is below \code{track_elbo_tol} or \code{track_elbo_max} samples are drawn. If 0 a single batch is drawn.
+#' @param track_elbo_max maximum number of Monte-Carlo samples per group used to compute the ELBO.
 #' @param niter maximum number of iteration to run the algorithm for.
 #' @param niter.refined maximum number of iteration to run the "binomial-refined" algorithm for.
 #' @param tol convergence tolerance.
+#' @param convergence convergence criteria, the fit stops as soon as any of the criteria are met. One or more of:
+#' \itemize{
+#' 	\item{\code{"l1"}}{ the L1 norm of the change in each of mu, s and g is below \code{tol}.}
+#' 	\item{\code{"relative"}}{ the L1 norm of the change in each of mu, s and g relative to the dimension plus the L1 norm of the previous value is below \code{tol}.}
+#' 	\item{\code{"max"}}{ the largest absolute change in each of mu, s and g is below \code{tol}.}
+#' 	\item{\code{"elbo"}}{ the relative improvement of a deterministic lower bound of the ELBO is below \code{tol}. The Monte-Carlo term is bounded using Jensen's inq.}
+#' 	\item{\code{"gamma"}}{ no group inclusion probability has crossed 0.5 in \code{convergence_k} iterations.}
+#' }
+#' @param convergence_k number of iterations used by the \code{"gamma"} criterion.
 #' @param verbose print additional information.
 #' @param thresh threshold used for the "logit-refined" family
 #' @param l number of parameters used for the "logit-refined" family, samller is faster but more approximate.
 #' @param ordering ordering of group updates. 0 is no ordering, 1 is random ordering, 2 is ordering by the norm of the group
+#' @param return_model return a handle to the model kept in C++ memory, used by \code{gsvb.elbo}, \code{gsvb.sample}, \code{gsvb.predict} and \code{gsvb.refit} to avoid recomputing the model state. The handle is built by the fitting routine and keeps its data and cached expressions, e.g. \code{t(X) \%*\% X} or V (gaussian, see \code{gram}), or X and the terms of the bound, so their memory is held until the handle is garbage collected. Note: the handle is not valid after the fit is saved and reloaded.
+#' @param compact return only the groups with an inclusion probability of at least \code{compact_min_g}, see details.
+#' @param compact_min_g the inclusion probability below which groups are dropped from a compact fit.
+#' @param checkpoint path of a file the state of the fit is written to every \code{checkpoint_every} iterations and when the fit is interrupted, see details.
+#' @param checkpoint_every number of iterations between checkpoints.
+#' @param resume path of a checkpoint to resume the fit from. The data and the other arguments should be those of the fit that wrote it.
+#' @param time_budget wall time in seconds the fit may run for. The fit stops at the end of the first sweep past the budget, see details.
+#' @param progress function called every \code{progress_every} iterations with a list of the stage, the iteration, the most recent ELBO estimate (\code{NA} if not available), the number of groups with \code{g >= 0.5} and the seconds elapsed. If it returns \code{TRUE} the fit stops. May also be an external pointer to a compiled callback, see details.
+#' @param progress_every number of iterations between calls of \code{progress}.
+#' @param spectral evaluate the traces and log-determinants of the covariance updates of large groups from the eigendecomposition of their block of \code{t(X) \%*\% X} (gaussian family with \code{diag_covariance=FALSE}), see details. \code{TRUE} or a list overriding the settings: \code{min_size}, the group size from which the decomposition is used (200).
+#' @param gram representation of \code{t(X) \%*\% X} in the gaussian fit. One of \code{"dense"}, the p x p matrix, \code{"svd"}, the right singular vectors and singular values of X, or \code{"auto"}, which uses \code{"svd"} if n < p and the dense matrix would take more than 2GB, see details.
+#' @param warmup start the binomial and poisson fits on a small random subset of the rows and grow it geometrically until all the rows are used, see details. \code{TRUE} or a list overriding the settings: \code{n0}, the initial number of rows (\code{max(200, n/64)}), \code{growth}, the factor the rows grow by (4), \code{niter}, the maximum iterations on each subset (20), and \code{tol}, the convergence tolerance on each subset (\code{10 * tol}).
+#' @param auto tune the options that only change the speed of the fit on a short calibration run, see details. \code{TRUE} or a list overriding the settings of the calibration: \code{n}, the number of rows subsampled (500), \code{niter}, the maximum iterations of each calibration fit (50), \code{tol}, the largest difference in the inclusion probabilities from the default settings (0.05), and \code{time_budget}, the time limit of each calibration fit in seconds (10).
 #' @param init_method method to initialize the algorithm. One of:
 #' \itemize{
-#' 	\item{\code{"lasso"}}{initialize using the group LASSO.}
+#' 	\item{\code{"gcd"}}{initialize using the group LASSO, fit natively with a few passes of group coordinate descent along a short regularization path.}
+#' 	\item{\code{"lasso"}}{initialize using the group LASSO fit by \code{gglasso}, or the LASSO fit by \code{glmnet} for the poisson family.}
 #' 	\item{\code{"random"}}{initialize using random values.}
-#' 	\item{\code{"ridge"}}{initialize using the ridge penalty.}
+#' 	\item{\code{"ridge"}}{initialize using the ridge penalty, fit natively by IRLS. When p > n the dual problem is solved so that only the n x n Gram matrix is formed.}
 #' }
 #' 
 #' 
@@ -49,9 +74,32 @@
 #' \item{tau_b}{the scale parameter for the variational posterior of tau^2. (linear only)}
 #' \item{parameters}{a list containing the model hyperparameters and other model information}
 #' \item{converged}{a boolean indicating if the algorithm has converged.}
+#' \item{converged_by}{the convergence criterion that was met, \code{NA} if the algorithm has not converged.}
+#' \item{stopped_by}{\code{"time_budget"} or \code{"progress"} if the fit was stopped early by the time budget or the progress callback, \code{NA} otherwise.}
 #' \item{iter}{the number of iterations the algorithm was ran for.}
+#' \item{elbo}{the ELBO at every \code{track_elbo_every} iterations. For the binomial families the expected log-likelihood is lower bounded using the bound of the chosen algorithm. (if \code{track_elbo})}
+#' \item{elbo_se}{the Monte-Carlo std. error of each ELBO estimate. (if \code{track_elbo})}
+#' \item{model}{an external pointer to the model. (if \code{return_model})}
+#' \item{active}{the labels of the groups kept in a compact fit. (if \code{compact})}
+#' \item{memory}{the peak size in bytes of each major buffer and large temporary allocated by the fitting routine, the total of the buffers, and \code{peak}, the largest memory held at once by the buffers and a temporary, see \code{gsvb.memory}.}
+#' \item{profile}{wall time per phase of the fit and counts of the L-BFGS objective evaluations and iterations, per phase, per group and per sweep. (if compiled with \code{-DGSVB_PROFILE})}
 #' 
-#' @section Details: TODO
+#' @section Details: 
+#' If the package is compiled with \code{-DGSVB_PROFILE} in \code{PKG_CPPFLAGS}, the fit contains a \code{profile}. Its \code{time} element holds the seconds spent in each phase: setup (e.g. computing \code{t(X) \%*\% X}), the mu, s and g updates, tau (linear only), the ELBO, and aux (maintenance of the cached terms of the binomial and poisson bounds). Each second is attributed to the innermost phase. \code{evals} and \code{iterations} count the L-BFGS objective evaluations and iterations. If the environment variable \code{GSVB_PROFILE_TRACE} is set to a file path, a Chrome trace of the phases is also written to that file. Without the flag the instrumentation is compiled out.
+#'
+#' If \code{compact=TRUE}, \code{mu}, \code{s} and \code{g} only contain the groups listed in \code{active} and \code{beta_hat} is a sparse \code{dgCMatrix}, so the size of the fit scales with the number of active groups rather than p. The remaining groups are dropped inside the fitting routine, before the results are copied to R. \code{gsvb.expand} returns the equivalent dense fit, where the dropped groups have \code{g = 0}, \code{mu = 0} and unit std. devs. The other \code{gsvb} functions expand compact fits as needed.
+#'
+#' If \code{checkpoint} is set, the variational parameters, the ELBO trace, the number of iterations and the state of R's RNG are written to the file at the end of every \code{checkpoint_every} iterations and before an interrupt is raised. A fit that is interrupted or killed can then be continued with \code{resume}, which runs the remaining iterations of the \code{niter} budget. The cached terms of the bounds are recomputed from the parameters, and the \code{"elbo"} and \code{"gamma"} convergence criteria restart their windows, so a resumed fit may stop at a different iteration than an uninterrupted one. The file is replaced atomically.
+#'
+#' The \code{time_budget} and \code{progress} callback stop the fit cleanly with the state at the end of the last sweep, which is returned with \code{converged = FALSE} and the reason in \code{stopped_by}. If \code{checkpoint} is set a checkpoint is also written, so the fit can be continued later with \code{resume}. The budget includes the time spent initializing the fit, and for the \code{"binomial-refined"} family the refined stage is skipped if the first stage is stopped. A compiled callback is an external pointer to a \code{fit_progress_callback}, see \code{src/control.h}, and avoids the overhead of calling into R.
+#'
+#' With \code{spectral}, the eigendecomposition \eqn{X_G^T X_G = Q \Lambda Q^T} of each group with at least \code{min_size} coefficients is computed once per fit, at about the cost of one inverse. The covariance of the group, \eqn{S = (E[1/\tau^2] X_G^T X_G + v I)^{-1}}, shares the eigenvectors, so the update of v evaluates \code{trace(X_G^T X_G S)}, \code{log det S}, \code{trace(S)} and \code{sum(S^2)} exactly as sums over the eigenvalues, in place of an inverse and a determinant per step of the optimization, and the log-determinant of S in the g update and the ELBO is evaluated the same way. S itself is formed once per update as \eqn{Q diag(1 / (E[1/\tau^2] \Lambda + v)) Q^T}, as the mu update and the returned covariances use it. The fit is the same as without \code{spectral} up to rounding, at the cost of keeping Q for each of these groups.
+#'
+#' With \code{gram="svd"}, the gaussian fit computes the thin SVD \eqn{X = U D V^T} and holds V, p x min(n, p), in place of the p x p matrix \eqn{X^T X = V D^2 V^T}, so the memory of the fit scales with \code{n * p} rather than \code{p^2} when n < p. The block of each group, \eqn{V_G D^2 V_G^T}, and its cross terms with the other groups are formed from the rows of V of the group as it is updated, so a sweep costs about \code{sum(|G|^2) * min(n, p)} rather than \code{p * sum(|G|)}. The fit is the same as the dense fit up to rounding. The model returned with \code{return_model} holds V, and \code{gsvb.refit} continues from it.
+#'
+#' With \code{warmup}, the early sweeps of the \code{"binomial"} and \code{"poisson"} families, which only move mu and g roughly into place, are run on nested random subsets of the rows. The fit starts on \code{n0} rows, and each time it converges on the current subset with the tolerance of the warm-up, or after its \code{niter} iterations, the subset grows by \code{growth}, with the std. devs scaled by the square root of the ratio of the rows, or the full covariances by the ratio, which are passed on to the next fit. Once the next subset would hold all the rows, the fit continues from the warm-up on the full data, so the final sweeps and the convergence check are exact. The sizes, iterations and times of the warm-up fits are returned in \code{parameters$warmup}. The \code{"binomial-refined"} family warms up its first stage. The warm-up is skipped when resuming from a checkpoint, and the warm-up fits are not checkpointed or reported to \code{progress}.
+#'
+#' With \code{auto}, the options that are not given and only change the speed of the fit are tuned: \code{ordering}, \code{track_elbo_every} (if \code{track_elbo}), and for \code{family="binomial"} the bound, Jaakkola's or Jensen's (if \code{diag_covariance}). A reference fit with the default settings is run to convergence on a subsample of the rows, then each option is varied in turn and the setting with the fastest main loop whose inclusion probabilities are within \code{tol} of the reference is kept. The chosen settings and the calibration runs, with their times, iterations and differences from the reference, are returned in \code{parameters$auto}. Only the total time of the main loop, and the time per sweep, are used to compare the settings; if the package is compiled with \code{-DGSVB_PROFILE}, the time of each phase of each calibration fit, from its \code{profile}, is also recorded in the calibration runs as the columns \code{time_setup}, \code{time_mu} and so on.
 #'
 #' @examples
 #' library(gsvb)
@@ -75,16 +123,53 @@
 gsvb.fit <- function(y, X, groups, family="gaussian", intercept=TRUE, 
     diag_covariance=TRUE, lambda=1, a0=1, b0=length(unique(groups)), 
     tau_a0=1e-3, tau_b0=1e-3, mu=NULL, 
-    s=apply(X, 2, function(x) 1/sqrt(sum(x^2)*tau_a0/tau_b0+2*lambda)),
-    g=rep(0.5, ncol(X)), track_elbo=TRUE, track_elbo_every=5, 
-    track_elbo_mcn=5e2, niter=150, niter.refined=20, 
-    tol=1e-3, verbose=TRUE, thresh=0.02, l=5, ordering=2, init_method="lasso") 
+    s=NULL,
+    g=rep(0.5, ncol(X)), track_elbo=TRUE, track_elbo_every=1, 
+    track_elbo_mcn=1e2, track_elbo_tol=1e-3, track_elbo_max=1e3, niter=150, niter.refined=20, 
+    tol=1e-3, convergence="l1", convergence_k=5, verbose=TRUE, thresh=0.02, 
+    l=5, ordering=2, return_model=FALSE, compact=FALSE, compact_min_g=1e-3,
+    init_method="gcd", checkpoint=NULL, checkpoint_every=10, resume=NULL,
+    time_budget=Inf, progress=NULL, progress_every=1, spectral=FALSE, gram="auto",
+    warmup=FALSE, auto=FALSE) 
 {
+    start <- proc.time()[["elapsed"]]
+
+    # tune the options left at their defaults that only change the speed
+    tuned <- NULL
+    if (!isFALSE(auto)) {
+	free <- list()
+	if (missing(ordering))
+	    free$ordering <- c(2, 1, 0)
+	if (track_elbo && missing(track_elbo_every))
+	    free$track_elbo_every <- c(1, 5, 25)
+	if (identical(family, "binomial"))
+	    free$family <- if (diag_covariance) 
+		c("binomial-jaakkola", "binomial-jensens") else "binomial-jaakkola"
+
+	args <- mget(setdiff(names(formals()), c("y", "X", "groups")))
+	tuned <- auto_tune(y, X, groups, args, free, auto)
+
+	if (!is.null(tuned$settings$ordering)) 
+	    ordering <- tuned$settings$ordering
+	if (!is.null(tuned$settings$track_elbo_every)) 
+	    track_elbo_every <- tuned$settings$track_elbo_every
+	if (!is.null(tuned$settings$family)) 
+	    family <- tuned$settings$family
+    }
+
+
     family <- pmatch(family, c("gaussian", "binomial-jensens", "binomial-jaakkola", 
 	    "binomial-refined", "poisson"))
 
-	if (is.null(init_method)) init_method <- "lasso"
-	init_method <- pmatch(init_method, c("lasso", "random", "ridge"))
+	if (is.null(init_method)) init_method <- "gcd"
+	init_method <- pmatch(init_method, c("lasso", "random", "ridge", "gcd"))
+
+    conv_criteria <- c("l1", "relative", "max", "elbo", "gamma")
+    convergence <- pmatch(convergence, conv_criteria)
+
+    gram <- pmatch(gram, c("dense", "svd", "auto"))
+    if (!is.na(gram) && gram == 3)
+	gram <- if (nrow(X) < ncol(X) && 8 * ncol(X)^2 > 2^31) 2 else 1
 
     # check user input
     if (min(groups) != 1) 
@@ -99,14 +184,61 @@ gsvb.fit <- function(y, X, groups, family="gaussian", intercept=TRUE,
 	stop("Hyperparameters must be greater than 0")
     if (is.na(family))
 	stop("Invalid family")
+    if (length(convergence) == 0 || any(is.na(convergence)))
+	stop("Invalid convergence criteria")
     if (any(family == c(2,3,4)) && !all(y == 1 | y == 0))
 	stop("Classification requires y to be in {0, 1}")
+    if (is.na(init_method))
+	stop("Invalid init_method")
+    if (is.na(gram))
+	stop("gram must be one of \"dense\", \"svd\" or \"auto\"")
 
-    # init s for other families
+    # continue from the state of a checkpoint
+    cp <- NULL
+    if (!is.null(resume)) {
+	cp <- checkpoint_read(path.expand(resume))
+
+	if (cp$family != family)
+	    stop("checkpoint was written by a fit of a different family")
+	if (length(cp$mu) != ncol(X) + intercept)
+	    stop("checkpoint does not match the dimensions of X")
+
+	mu <- cp$mu
+	s <- cp$s
+	g <- cp$g
+	if (length(cp$rng) > 0)
+	    assign(".Random.seed", cp$rng, envir=globalenv())
+    }
+
+    # full covariances of the warm-up, passed to the first stage
+    warm_S <- NULL
+
+    # options of the main loop of the fitting routines, the state of a
+    # resumed fit is passed to the stage that wrote the checkpoint
+    control <- function(stage) {
+	ctl <- list(checkpoint=if (is.null(checkpoint)) NULL else 
+	    path.expand(checkpoint), checkpoint_every=checkpoint_every, 
+	    family=family, stage=stage, 
+	    time_budget=time_budget - (proc.time()[["elapsed"]] - start),
+	    progress=progress, progress_every=progress_every, gram=gram,
+	    model=return_model)
+	if (!isFALSE(spectral))
+	    ctl$spectral <- modifyList(list(min_size=200),
+		if (is.list(spectral)) spectral else list())
+	if (!is.null(cp) && cp$stage == stage)
+	    ctl <- c(ctl, cp[c("iter", "S", "v", "tau_a", "tau_b", "elbo", 
+		"elbo_se")])
+	if (!is.null(warm_S) && stage == 1)
+	    ctl$S <- warm_S
+	return(ctl)
+    }
+
+    # init s, tau is not used by the other families
     if (any(family == c(2,3,4,5)) && (is.null(tau_a0) || is.null(tau_b0))) {
 	tau_a0 <- tau_b0 <- 1
-	s <- apply(X, 2, function(x) 1/sqrt(sum(x^2)+2*lambda))
     }
+    if (is.null(s))
+	s <- 1/sqrt(colSums(X^2) * tau_a0/tau_b0 + 2*lambda)
 
     # pre-processing
     if (intercept) {
@@ -148,30 +280,58 @@ gsvb.fit <- function(y, X, groups, family="gaussian", intercept=TRUE,
 		{
 			mu <- rnorm(ncol(X), 0, 0.5)
 		}
-		else if (init_method == 3) {
-		if (family == 1) {
-			glfit <- glmnet::glmnet(X, y, family="gaussian", standardize=FALSE, 
-			intercept=FALSE, alpha=0)
-		} else if (any(c(2,3,4) == family)) {
-			yy <- y
-			yy[which(y == 0)] <- -1
-			glfit <- glmnet::glmnet(X, y, family="binomial", standardize=FALSE, 
-			intercept=FALSE, alpha=0)
-		} else if (5 == family) {
-			message("Group LASSO not available for the poisson model. Using the LASSO to initialize.")
-			glfit <- glmnet::glmnet(X, y, family="poisson", standardize=FALSE, 
-			intercept=FALSE, alpha=0)
-		}
-		# take mu as the estimate for smallest reg parameter
-		mu <- glfit$beta[ , length(glfit$lambda)]
+		else 
+		{
+			# native ridge or group coordinate descent
+			mu <- init_mu(y, X, groups, family, init_method)
 		}
 	}
 
+    # groups with g below min_g are dropped by the fitting routines
+    min_g <- if (compact) compact_min_g else 0
+
+    # progressive row-sampling warm-up, the fits on the subsets use the
+    # first stage of each family and are neither tracked nor checkpointed
+    warm <- NULL
+    if (!isFALSE(warmup) && any(family == c(2,3,4,5)) && is.null(cp)) {
+	# as for the fits below, Jensen's and the refined bound are diagonal
+	if (any(family == c(2, 4)))
+	    diag_covariance <- TRUE
+	warm_fit <- function(rows, mu, s, g, S, niter, tol) {
+	    ctl <- control(1)
+	    ctl[c("checkpoint", "progress", "model")] <- NULL
+	    ctl$S <- S
+	    if (family == 5) {
+		fit_poisson(y[rows], X[rows, , drop=FALSE], groups, lambda, a0, 
+		    b0, mu, s, g, diag_covariance, FALSE, track_elbo_every,
+		    track_elbo_mcn, track_elbo_tol, track_elbo_max, niter, tol,
+		    convergence, convergence_k, FALSE, 0, ctl)
+	    } else {
+		fit_logistic(y[rows], X[rows, , drop=FALSE], groups, lambda, 
+		    a0, b0, mu, s, g, diag_covariance, FALSE, track_elbo_every, 
+		    track_elbo_mcn, track_elbo_tol, track_elbo_max, thresh, l, 
+		    niter, if (family == 2) 2 else 3, tol, convergence, 
+		    convergence_k, FALSE, ordering, 0, ctl)
+	    }
+	}
+	w <- row_warmup(nrow(X), warm_fit, mu, s, g, diag_covariance, warmup,
+	    tol)
+	mu <- w$mu
+	s <- w$s
+	g <- w$g
+	warm_S <- w$S
+	warm <- w$schedule
+
+	if (verbose && !is.null(warm))
+	    cat("Warm-up on", paste(warm$rows, collapse=", "), "rows\n")
+    }
+
     if (family == 1) # LINEAR
     {
 	f <- fit_linear(y, X, groups, lambda, a0, b0, tau_a0, tau_b0, 
 	    mu, s, g, diag_covariance, track_elbo, track_elbo_every, 
-	    track_elbo_mcn, niter, tol, verbose, ordering)
+	    track_elbo_mcn, track_elbo_tol, track_elbo_max, niter, tol, convergence,
+	    convergence_k, verbose, ordering, min_g, control(1))
     }
     if (family == 2) # LOGISTIC - JENSEN BOUND
     {
@@ -180,52 +340,89 @@ gsvb.fit <- function(y, X, groups, family="gaussian", intercept=TRUE,
 	diag_covariance <- TRUE
 	f <- fit_logistic(y, X, groups, lambda, a0, b0,
 	    mu, s, g, diag_covariance, track_elbo, track_elbo_every,
-	    track_elbo_mcn, thresh, l, niter, 2, tol, verbose, ordering)
+	    track_elbo_mcn, track_elbo_tol, track_elbo_max, thresh, l, niter, 2,
+	    tol, convergence, convergence_k, verbose, ordering, min_g, control(1))
     }
     if (family == 3) # LOGISTIC - JAAKKOLA BOUND
     {
 	f <- fit_logistic(y, X, groups, lambda, a0, b0,
 	    mu, s, g, diag_covariance, track_elbo, track_elbo_every,
-	    track_elbo_mcn, thresh, l, niter, 3, tol, verbose, ordering)
+	    track_elbo_mcn, track_elbo_tol, track_elbo_max, thresh, l, niter, 3,
+	    tol, convergence, convergence_k, verbose, ordering, min_g, control(1))
     }
     if (family == 4) # LOGISTIC - OUR BOUND
     {
 	message("Logistic model with new bound currently only supoorts a variational family with diagonal covariance matrix.")
 	diag_covariance <- TRUE
 
-	f <- fit_logistic(y, X, groups, lambda, a0, b0,
-	    mu, s, g, diag_covariance, FALSE, track_elbo_every,
-	    track_elbo_mcn, thresh, l, niter, 3, tol, verbose, ordering)
+	# a checkpoint of the refined stage skips the first stage
+	f <- list(mu=mu, sigma=s, gamma=g)
+	if (is.null(cp) || cp$stage == 1) {
+	    f <- fit_logistic(y, X, groups, lambda, a0, b0,
+		mu, s, g, diag_covariance, FALSE, track_elbo_every,
+		track_elbo_mcn, track_elbo_tol, track_elbo_max, thresh, l, niter,
+		3, tol, convergence, convergence_k, verbose, ordering, 0, 
+		control(1))
+	}
 
 	# if mu is provided by the user then this input is taken
 	# and refined with our tight upper bound.
-	f <- fit_logistic(y, X, groups, lambda, a0, b0,
-	    f$mu, f$s, f$g, diag_covariance, track_elbo, track_elbo_every,
-	    track_elbo_mcn, thresh, l, niter.refined, 1, tol, verbose, ordering)
+	if (is.null(f$stopped_by) || f$stopped_by == 0) {
+	    # the model of the first stage is replaced by that of the second
+	    if (!is.null(f$model))
+		model_free(f$model)
+	    f <- fit_logistic(y, X, groups, lambda, a0, b0,
+		f$mu, f$sigma, f$gamma, diag_covariance, track_elbo, track_elbo_every,
+		track_elbo_mcn, track_elbo_tol, track_elbo_max, thresh, l, 
+		niter.refined, 1, tol, convergence, convergence_k, verbose,
+		ordering, min_g, control(2))
+	} else if (min_g > 0) {
+	    # the first stage does not drop the inactive groups
+	    keep <- f$gamma >= min_g
+	    f$active <- unique(groups[keep])
+	    f$mu <- f$mu[keep]
+	    f$sigma <- f$sigma[keep]
+	    f$gamma <- f$gamma[keep]
+	}
     }
     if (family == 5) # POISSON REG
     {
 	f <- fit_poisson(y, X, groups, lambda, a0, b0, mu, s, g,
 	    diag_covariance, track_elbo, track_elbo_every, track_elbo_mcn, 
-	    niter, tol, verbose)
+	    track_elbo_tol, track_elbo_max, niter, tol, convergence, convergence_k,
+	    verbose, min_g, control(1))
     }
     
+    # exact names, f$s would also partially match stopped_by
     if (diag_covariance == FALSE && any(c(1,3,5) == family)) {
 	f$s <- lapply(f$S, function(s) matrix(s, nrow=sqrt(length(s))))
+    } else {
+	f$s <- f$sigma
     }
    
+    # coefficients of the groups returned by the fitting routine
+    idx <- if (compact) which(groups %in% f$active) else seq_along(groups)
+
     res <- list(
 	mu = f$mu,
 	s = f$s,
-	g = f$g[!duplicated(groups)],
+	g = f$g[!duplicated(groups[idx])],
 	beta_hat = f$mu * f$g,
 	parameters = list(lambda = lambda, a0 = a0, b0=b0,
 			  intercept=intercept, diag_covariance=diag_covariance,
-			  groups=groups, family=family),
+			  groups=groups, family=family, compact=compact),
 	converged = f$converged,
+	converged_by = if (f$converged_by > 0) conv_criteria[f$converged_by] else NA,
+	stopped_by = if (!f$converged && f$stopped_by > 0) 
+	    c("time_budget", "progress")[f$stopped_by] else NA,
 	iter = f$iter
     )
 
+    if (!is.null(tuned))
+	res$parameters$auto <- tuned
+    if (!is.null(warm))
+	res$parameters$warmup <- warm
+
     if (family == 1) {
 	res$tau_a = f$tau_a
 	res$tau_b = f$tau_b
@@ -234,8 +431,24 @@ gsvb.fit <- function(y, X, groups, family="gaussian", intercept=TRUE,
 	res$parameters$tau_b0=tau_b0
     }
    
-    if (track_elbo)
+    if (track_elbo) {
 	res$elbo <- f$elbo
+	res$elbo_se <- f$elbo_se
+    }
+
+    res$memory <- f$memory
+
+    if (length(f$profile) > 0)
+	res$profile <- f$profile
+
+    if (compact) {
+	res$active <- f$active
+	res$beta_hat <- Matrix::sparseMatrix(i=idx, j=rep(1, length(idx)), 
+	    x=res$beta_hat, dims=c(length(groups), 1))
+    }
+
+    if (return_model)
+	res$model <- f$model
 
     return(res)
 }
@@ -0,0 +1,125 @@
+#' Estimate the memory required to fit a model
+#'
+#' @param n number of observations.
+#' @param p number of columns of the input matrix.
+#' @param groups group structure.
+#' @param family the family, see \code{gsvb.fit}.
+#' @param intercept should an intercept term be included.
+#' @param diag_covariance should a diagonal covariance matrix be used in the variational approximation.
+#' @param track_elbo track the evidence lower bound (ELBO).
+#' @param init_method method to initialize the algorithm, see \code{gsvb.fit}.
+#' @param gram representation of \code{t(X) \%*\% X} in the gaussian fit, see \code{gsvb.fit}.
+#'
+#' @return a list containing:
+#' \item{bytes}{the estimated peak size in bytes of each major buffer and large temporary of the fit. The names match those of the \code{memory} element of the fit.}
+#' \item{total}{the sum of \code{bytes} over the buffers, the memory held during the fit.}
+#' \item{peak}{the estimated peak memory of the call to \code{gsvb.fit}, the larger of \code{total} with the largest temporary, the memory held during the initialization, and for \code{"binomial-refined"} the memory held by its first stage with Jaakkola's bound.}
+#'
+#' @section Details:
+#' The estimate covers the buffers and temporaries allocated by \code{gsvb.fit} that scale with n, p or the group sizes, it does not include the inputs or the memory held by R before the call. The buffers are:
+#' \itemize{
+#' 	\item{\code{X_input}}{ the copy of X made in R when adding the intercept column.}
+#' 	\item{\code{X}}{ the copy of X used by the fitting routine.}
+#' 	\item{\code{xtx}}{ \code{t(X) \%*\% X} (gaussian with \code{gram="dense"}).}
+#' 	\item{\code{V}}{ the right singular vectors of X (gaussian with \code{gram="svd"}).}
+#' 	\item{\code{XX}}{ the elementwise square of X (binomial-jensens, and poisson with a diagonal covariance).}
+#' 	\item{\code{XAX}}{ \code{t(X) \%*\% A \%*\% X} of Jaakkola's bound (binomial-jaakkola).}
+#' 	\item{\code{Xm}, \code{Xs}}{ the per group linear predictors of the refined bound (binomial-refined).}
+#' 	\item{\code{Ss}, \code{Us}}{ the group covariances and their Cholesky factors (if \code{diag_covariance=FALSE}).}
+#' 	\item{\code{P}}{ terms of the expected log-likelihood kept per observation.}
+#' 	\item{\code{spectra}}{ the eigendecompositions of the large groups with \code{spectral} (gaussian with \code{diag_covariance=FALSE}), about the size of their covariances. Not included in the estimate.}
+#' 	\item{\code{state}}{ the variational parameters, their previous values and other vectors of length p.}
+#' 	\item{\code{elbo_queue}}{ the copies of the parameters waiting to be evaluated by the ELBO worker (if \code{track_elbo}).}
+#' 	\item{\code{init}}{ the initialization. This memory is freed before the fit starts.}
+#' }
+#' and the temporaries, which are not counted in \code{total}:
+#' \itemize{
+#' 	\item{\code{svd}}{ the copy of X and the transpose of V made by the SVD of X (gaussian with \code{gram="svd"}). X is freed after the SVD.}
+#' 	\item{\code{X_G}}{ the copies of the columns of a group, and their squares, made by the updates (binomial and poisson).}
+#' 	\item{\code{AX}}{ \code{A \%*\% X}, formed to update \code{XAX} (binomial with Jaakkola's bound).}
+#' }
+#'
+#' @examples
+#' groups <- rep(1:200, each=5)
+#' m <- gsvb.memory(100, 1000, groups)
+#' m$peak / 2^20	# MiB
+#'
+#' f <- gsvb.fit(rnorm(100), matrix(rnorm(100 * 1000), 100, 1000), groups,
+#'     niter=5)
+#' f$memory
+#' m$total
+#'
+#' @export
+gsvb.memory <- function(n, p, groups, family="gaussian", intercept=TRUE,
+    diag_covariance=TRUE, track_elbo=TRUE, init_method="gcd", gram="auto")
+{
+    family <- pmatch(family, c("gaussian", "binomial-jensens", "binomial-jaakkola",
+	    "binomial-refined", "poisson"))
+    init_method <- pmatch(init_method, c("lasso", "random", "ridge", "gcd"))
+    gram <- pmatch(gram, c("dense", "svd", "auto"))
+
+    if (is.na(family))
+	stop("Invalid family")
+    if (is.na(init_method))
+	stop("Invalid init_method")
+    if (is.na(gram))
+	stop("gram must be one of \"dense\", \"svd\" or \"auto\"")
+    if (gram == 3)
+	gram <- if (n < p && 8 * p^2 > 2^31) 2 else 1
+    if (length(groups) != p)
+	stop("groups must be of length p")
+
+    # the binomial families other than jaakkola use a diagonal covariance
+    if (any(family == c(2, 4)))
+	diag_covariance <- TRUE
+
+    d <- 8
+    m <- as.vector(table(groups))
+    if (intercept) {
+	m <- c(1, m)
+	p <- p + 1
+    }
+    M <- length(m)
+    S <- if (diag_covariance) 0 else d * sum(m^2)
+
+    bytes <- c(X_input = if (intercept) d * n * p else 0, X = d * n * p)
+
+    if (family == 1) {
+	bytes <- c(bytes, if (gram == 1) c(xtx = d * p^2) else 
+	    c(V = d * p * min(n, p)), Ss = S, state = d * 8 * p)
+	temp <- if (gram == 1) c() else c(svd = d * (n * p + p * min(n, p)))
+    } else if (family == 5) {
+	bytes <- c(bytes, XX = if (diag_covariance) d * n * p else 0, Ss = S,
+	    Us = S, P = d * n, state = d * 7 * p)
+	temp <- c(X_G = (if (diag_covariance) 2 else 1) * d * n * max(m))
+    } else {
+	# only the buffers of the bound are allocated, the memory reported by
+	# the refined bound is that of its second stage
+	bytes <- c(bytes, switch(family - 1,
+	    c(XX = d * n * p, P = d * n),
+	    c(XAX = d * p^2, Ss = S, P = d * n),
+	    c(Xm = d * n * M, Xs = d * n * M)), state = d * 7 * p)
+	temp <- c(X_G = 2 * d * n * max(m), if (family == 3) c(AX = d * n * p))
+    }
+
+    # at most four snapshots are queued and one evaluated
+    if (track_elbo)
+	bytes <- c(bytes, elbo_queue = 5 * (d * (p + M) +
+	    if (diag_covariance) d * p else S))
+
+    # ridge solves a system of the smaller dimension, gcd copies a group
+    init <- switch(init_method,
+	d * n * p,
+	0,
+	2 * d * min(n, p)^2,
+	d * n * max(m))
+
+    total <- sum(bytes)
+
+    # the first stage of the refined bound uses Jaakkola's bound
+    first <- if (family == 4) 
+	total - d * 2 * n * M + d * (p^2 + n + n * p) else 0
+
+    return(list(bytes=c(bytes, temp, init=init), total=total,
+	peak=max(total + max(0, temp), bytes[["X_input"]] + init, first)))
+}
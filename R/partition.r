@@ -0,0 +1,205 @@
+#' Fit a linear model with the groups partitioned across worker processes
+#'
+#' @param y response vector.
+#' @param X input matrix, or a function of a vector of column indices that returns those columns of X. The function is called on the workers, so X is never held by a single process.
+#' @param groups group structure.
+#' @param cluster a cluster of worker processes from \code{parallel::makeCluster}, with \code{gsvb} installed. Each worker owns one contiguous range of the groups.
+#' @param intercept should an intercept term be included.
+#' @param diag_covariance should a diagonal covariance matrix be used in the variational approximation.
+#' @param lambda penalization hyperparameter for the multivariate exponential prior.
+#' @param a0 shape parameter for the Beta(a0, b0) mixing prior.
+#' @param b0 shape parameter for the Beta(a0, b0) mixing prior.
+#' @param tau_a0 shape parameter for the inverse-Gamma(a0, b0) prior on the variance, tau^2.
+#' @param tau_b0 scale parameter for the inverse-Gamma(a0, b0) prior on the variance, tau^2.
+#' @param niter maximum number of iteration to run the algorithm for.
+#' @param sweeps number of sweeps each worker runs over its groups per iteration.
+#' @param tol convergence tolerance.
+#' @param convergence convergence criteria, one or more of \code{"l1"}, \code{"relative"}, \code{"max"} and \code{"gamma"}, see \code{gsvb.fit}.
+#' @param convergence_k number of iterations used by the \code{"gamma"} criterion.
+#' @param ordering ordering of group updates within each worker, see \code{gsvb.fit}.
+#' @param verbose print additional information.
+#'
+#' @return A fit of the \code{"gaussian"} family, see \code{gsvb.fit}, without the ELBO. \code{parameters$partition} holds the first and last group of each worker.
+#'
+#' @section Details:
+#' The groups are split into one contiguous range per worker, balanced by the number of columns. Each worker holds its columns of X, the block \code{t(X_G) \%*\% X_G} of each of its groups, the n-vector of its contribution to the fitted values and the variational parameters of its groups, so the memory of a worker scales with its share of the columns and the squared sizes of its groups. The cross terms of a group with the other groups of the worker are formed from the columns of the group and the worker's contribution to the fitted values, which is updated after each group. At each iteration the n-vector of the fitted values \code{X \%*\% beta_hat} and \code{E[1/tau^2]} are sent to the workers, each updates its groups against the residual of the others, and returns the n-vector of its contribution to the fitted values along with a few scalars. The blocks are updated in parallel from the same fitted values (a block-Jacobi schedule), so the fit can differ from that of \code{gsvb.fit}, and the iterations may oscillate if the columns of different workers are strongly correlated. More \code{sweeps} reduce the number of exchanges.
+#'
+#' The fit is initialized with \code{mu = 0}, \code{g = 0.5} and the default \code{s} of \code{gsvb.fit}.
+#'
+#' @examples
+#' library(gsvb)
+#'
+#' n <- 100
+#' p <- 1000
+#' gsize <- 5
+#' groups <- c(rep(1:(p/gsize), each=gsize))
+#'
+#' X <- matrix(rnorm(n * p), nrow=n, ncol=p)
+#' b <- c(rep(0, gsize), rep(-4, gsize), rep(8, gsize), rep(0, p - 3 * gsize))
+#' y <- X %*% b + rnorm(n, 0, 1)
+#'
+#' cl <- parallel::makeCluster(2)
+#' f <- gsvb.fit_partitioned(y, X, groups, cl)
+#' parallel::stopCluster(cl)
+#'
+#' plot(f$beta_hat, col=4, ylab=expression(hat(beta)))
+#' points(b, pch=20)
+#'
+#' @export
+gsvb.fit_partitioned <- function(y, X, groups, cluster, intercept=TRUE,
+    diag_covariance=TRUE, lambda=1, a0=1, b0=length(unique(groups)),
+    tau_a0=1e-3, tau_b0=1e-3, niter=150, sweeps=1, tol=1e-3,
+    convergence="l1", convergence_k=5, ordering=2, verbose=TRUE)
+{
+    conv_criteria <- c("l1", "relative", "max", "elbo", "gamma")
+    convergence <- pmatch(convergence, conv_criteria)
+
+    # check user input
+    if (min(groups) != 1)
+	stop("group labels must start at 1")
+    if (max(groups) != length(unique(groups)))
+	stop("group labels must not exceed the unique number of groups")
+    if (!all(groups == rep(unique(groups), table(groups))))
+	stop("groups must be ordered")
+    if (any(is.na(convergence)) || any(convergence == 4))
+	stop("convergence must be one of \"l1\", \"relative\", \"max\" or \"gamma\"")
+    if (is.matrix(X) && ncol(X) != length(groups))
+	stop("groups must be of length ncol(X)")
+
+    y <- as.vector(y)
+    n <- length(y)
+    K <- length(cluster)
+
+    # contiguous ranges of groups with about the same number of columns
+    sizes <- as.vector(table(groups))
+    K <- min(K, length(sizes))
+    part <- findInterval(cumsum(sizes) - sizes,
+	seq(0, length(groups), length.out=K + 1)[-(K + 1)])
+    parts <- lapply(seq_len(K), function(k) {
+	gs <- which(part == k)
+	list(k=k, groups=gs, cols=which(groups %in% gs))
+    })
+    parts <- parts[sapply(parts, function(p) length(p$groups) > 0)]
+    K <- length(parts)
+
+    # build the blocks on the workers, the first one holds the intercept.
+    # With a matrix only the columns of each worker are sent to it.
+    for (k in seq_len(K)) {
+	parts[[k]]$X <- if (is.function(X)) X else X[, parts[[k]]$cols, 
+	    drop=FALSE]
+    }
+    workers <- cluster[seq_len(K)]
+    key <- paste0(".gsvb_block_", sample.int(.Machine$integer.max, 1))
+    on.exit(parallel::clusterCall(workers, function(key)
+	if (exists(key, envir=globalenv())) rm(list=key, envir=globalenv()), 
+	key), add=TRUE)
+
+    init <- parallel::clusterApply(workers, parts,
+	function(part, y, groups, key, intercept, diag_covariance, lambda,
+	    a0, b0, tau_a0, tau_b0)
+	{
+	    Xk <- as.matrix(if (is.function(part$X)) part$X(part$cols) 
+		else part$X)
+	    gk <- groups[part$cols]
+	    s <- 1/sqrt(colSums(Xk^2) * tau_a0/tau_b0 + 2*lambda)
+	    if (intercept && part$k == 1) {
+		Xk <- cbind(rep(1, nrow(Xk)), Xk)
+		gk <- c(0, gk)
+		s <- c(1/sqrt(sqrt(nrow(Xk)) * tau_a0 / tau_b0 + 2 *lambda), s)
+	    }
+
+	    b <- gsvb:::block_create(Xk, y, gk, lambda, a0, b0,
+		rep(0, ncol(Xk)), s, rep(0.5, ncol(Xk)), diag_covariance)
+	    assign(key, b, envir=globalenv())
+	    gsvb:::block_contribution(b)
+	}, y=y, groups=groups, key=key, intercept=intercept, 
+	diag_covariance=diag_covariance, lambda=lambda, a0=a0, b0=b0, 
+	tau_a0=tau_a0, tau_b0=tau_b0)
+    parts <- lapply(parts, function(p) { p$X <- NULL; p })
+
+    fit <- Reduce(`+`, lapply(init, `[[`, "c"))
+    r <- sum(sapply(init, `[[`, "r"))
+    tau <- linear_tau(tau_a0, tau_b0, sum((y - fit)^2) + r, n)
+
+    num_iter <- niter
+    converged <- FALSE
+    converged_by <- 0
+    stable_iters <- 0
+
+    for (iter in seq_len(niter))
+    {
+	res <- parallel::clusterCall(workers, function(key, fit, e_tau, 
+	    sweeps, ordering) 
+	{
+	    gsvb:::block_sweep(get(key, envir=globalenv()), fit, e_tau, 
+		sweeps, ordering)
+	}, key, fit, tau[1] / tau[2], sweeps, ordering)
+
+	fit <- Reduce(`+`, lapply(res, `[[`, "c"))
+	r <- sum(sapply(res, `[[`, "r"))
+	tau <- linear_tau(tau_a0, tau_b0, sum((y - fit)^2) + r, n)
+
+	if (verbose) cat(iter)
+
+	# the convergence criteria of gsvb.fit from the changes of the blocks,
+	# rows are mu, s and g, columns sum |d|, sum |old|, size and max |d|
+	change <- Reduce(`+`, lapply(res, function(x) 
+	    cbind(x$change[, -2], 0)))
+	change[, 4] <- apply(sapply(res, function(x) x$change[, 2]), 1, max)
+	crossed <- any(sapply(res, `[[`, "crossed"))
+	stable_iters <- if (crossed) 0 else stable_iters + 1
+
+	for (criterion in convergence) {
+	    done <- switch(criterion,
+		all(change[, 1] < tol),
+		all(change[, 1] / (change[, 3] + change[, 2]) < tol),
+		all(change[, 4] < tol),
+		FALSE,
+		stable_iters >= convergence_k)
+	    if (done) {
+		converged_by <- criterion
+		break
+	    }
+	}
+
+	if (converged_by) {
+	    if (verbose) cat("\nConverged in", iter, "iterations\n")
+	    num_iter <- iter
+	    converged <- TRUE
+	    break
+	}
+    }
+
+    # gather the state, blocks are in the order of the groups
+    f <- parallel::clusterCall(workers, function(key) 
+	gsvb:::block_state(get(key, envir=globalenv())), key)
+    mu <- unlist(lapply(f, `[[`, "mu"))
+    g <- unlist(lapply(f, `[[`, "gamma"))
+    s <- if (diag_covariance) unlist(lapply(f, `[[`, "sigma")) else
+	lapply(unlist(lapply(f, `[[`, "S"), recursive=FALSE), 
+	    function(s) matrix(s, nrow=sqrt(length(s))))
+
+    if (intercept)
+	groups <- c(min(groups) - 1, groups) + 1
+
+    res <- list(
+	mu = mu,
+	s = s,
+	g = g[!duplicated(groups)],
+	beta_hat = mu * g,
+	parameters = list(lambda = lambda, a0 = a0, b0=b0,
+			  intercept=intercept, diag_covariance=diag_covariance,
+			  groups=groups, family=1, compact=FALSE,
+			  tau_a0=tau_a0, tau_b0=tau_b0,
+			  partition=t(sapply(parts, function(p) 
+			      range(p$groups)))),
+	converged = converged,
+	converged_by = if (converged_by > 0) conv_criteria[converged_by] else NA,
+	iter = num_iter,
+	tau_a = tau[1],
+	tau_b = tau[2],
+	tau_hat = tau[2] / (tau[1] - 1)
+    )
+
+    return(res)
+}
@@ -5,9 +5,15 @@
 #' @param samples number of Monte-Carlo samples.
 #' @param quantiles quantiles to return 
 #' @param return_samples return all the samples
+#' @param type one of \code{"samples"} or \code{"moments"}. If \code{"moments"} the mean and variance of the posterior predictive are computed in closed form without sampling.
 #'
-#' @return a list with the mean of the posterior predictive, the quantiles, and optionally the samples.
+#' @return a list with the mean of the posterior predictive, the quantiles, and optionally the samples. If \code{type="moments"} a list with the mean and variance, \code{var}, of the posterior predictive.
 #' 
+#' @section Details:
+#' Samples are generated in blocks and summarized online, the quantiles are estimated using the P^2 algorithm. Memory is therefore linear in the number of rows of \code{newdata} regardless of the number of samples, unless \code{return_samples=TRUE}.
+#'
+#' For \code{type="moments"} the moments are exact for the linear and poisson models. For the binomial families the mean uses the probit approximation to the logistic function, \eqn{E[y] \approx \sigma(m / \sqrt{1 + \pi v / 8})} where \eqn{m} and \eqn{v} are the mean and variance of the linear predictor.
+#'
 #' @examples
 #' n <- 100
 #' p <- 1000
@@ -23,42 +29,47 @@
 #'
 #' @export
 gsvb.predict <- function(fit, newdata, samples=1e4, 
-    quantiles=c(0.025, 0.975), return_samples=FALSE) 
+    quantiles=c(0.025, 0.975), return_samples=FALSE, type="samples") 
 {
-    M <- length(fit$g)
-    n <- nrow(newdata)
-    groups <- fit$parameters$groups
+    fit <- gsvb.expand(fit)
+    diag_cov <- fit$parameters$diag_covariance
+    family <- fit$parameters$family
+
+    type <- pmatch(type, c("samples", "moments"))
+    if (is.na(type))
+	stop("Invalid type")
 
     if (fit$parameters$intercept)
 	newdata <- cbind(1, newdata)
 
-    # samples <- gsvb::gsvb.sample(fit, samples=samples)
-    samples <- gsvb.sample(fit, samples=samples)
-    Xb <- newdata %*% samples$beta
+    # the seed of the RNG streams used by the sampler is drawn from R's RNG
+    # so that predictions are reproducible with set.seed
+    seed <- sample.int(.Machine$integer.max, 1)
 
-    if (fit$parameters$family == 1)
-    {
-	sigma <- sqrt(fit$tau_b / fit$tau_a)
-	y.star <- Xb + sigma * rt(prod(dim(Xb)), 2 + fit$tau_a)
-    }
-    else if(any(fit$parameters$family == c(2,3,4)))
-    {
-	y.star <- 1/(1 + exp(-Xb))	
-    }
-    else if(fit$parameters$family == 5)
-    {
-	lambda <- exp(Xb)
-	y.star <- matrix(rpois(prod(dim(lambda)), lambda), nrow=n)
+    if (!is.null(fit$model)) {
+	res <- model_predict(fit$model, newdata, samples, quantiles, 
+	    return_samples, type, seed)
+    } else if (type == 2) {
+	res <- predict_moments(newdata, fit$mu, 
+	    if (diag_cov) fit$s else numeric(0), 
+	    if (diag_cov) list() else fit$s, fit$g, fit$parameters$groups, 
+	    diag_cov, family, if (family == 1) fit$tau_a else 0, 
+	    if (family == 1) fit$tau_b else 0)
+    } else {
+	res <- predict_stream(newdata, fit$mu, 
+	    if (diag_cov) fit$s else numeric(0),
+	    if (diag_cov) list() else fit$s, fit$g, fit$parameters$groups, 
+	    diag_cov, family, if (family == 1) fit$tau_a else 0, 
+	    if (family == 1) fit$tau_b else 0, samples, quantiles, 
+	    return_samples, seed)
     }
 
-    res <- list(
-	mean=apply(y.star, 1, mean),
-	quantiles=apply(y.star, 1, quantile, probs=quantiles)
-    )
+    if (type == 2)
+	return(list(mean=as.vector(res$mean), var=as.vector(res$var)))
 
-    if (return_samples) {
-	res <- c(res, list(samples=y.star))
-    }
+    res$mean <- as.vector(res$mean)
+    rownames(res$quantiles) <- paste0(formatC(100 * quantiles, format="fg", 
+	width=1, digits=max(2L, getOption("digits"))), "%")
 
     return(res)
 }
@@ -0,0 +1,98 @@
+#' Refit a model from its current state
+#'
+#' @param fit fit model returned by \code{gsvb.fit} with \code{return_model=TRUE}
+#' @param niter maximum number of iterations to run the algorithm for.
+#' @param tol convergence tolerance.
+#' @param convergence the convergence criteria, see \code{gsvb.fit}.
+#' @param convergence_k number of iterations used by the \code{"gamma"} criterion, see \code{gsvb.fit}.
+#' @param ordering the ordering of the group updates, see \code{gsvb.fit}.
+#' @param track_elbo track the evidence lower bound (ELBO).
+#' @param track_elbo_every the number of iterations between recording the ELBO.
+#' @param track_elbo_mcn number of Monte-Carlo samples drawn per batch when computing the ELBO.
+#' @param track_elbo_tol target std. error of the Monte-Carlo estimate of the ELBO relative to its magnitude, see \code{gsvb.fit}.
+#' @param track_elbo_max maximum number of Monte-Carlo samples used to compute the ELBO.
+#' @param thresh threshold used for the refined binomial bound.
+#' @param l number of parameters used for the refined binomial bound.
+#' @param verbose print additional information.
+#'
+#' @return a fit as returned by \code{gsvb.fit}, containing the updated model handle.
+#'
+#' @section Details:
+#' The fit is continued from the variational parameters held by the model handle, using the data and the expressions cached by the fitting routine of \code{gsvb.fit}, so no data is copied from R. The gaussian fit continues from \code{t(X) \%*\% X} or V in the representation chosen by \code{gram}, and the binomial and poisson fits reuse the terms of the bound for the current state, so the first sweep does not recompute them. The handle is updated in place, any other fit that shares it will use the new state.
+#'
+#' @examples
+#' n <- 100
+#' p <- 1000
+#' gsize <- 5
+#' groups <- c(rep(1:(p/gsize), each=gsize))
+#'
+#' X <- matrix(rnorm(n * p), nrow=n, ncol=p)
+#' b <- c(rep(0, gsize), rep(-4, gsize), rep(8, gsize), rep(0, p - 3 * gsize))
+#' y <- X %*% b + rnorm(n, 0, 1)
+#'
+#' f <- gsvb.fit(y, X, groups, niter=10, return_model=TRUE)
+#' f <- gsvb.refit(f, niter=150)
+#'
+#' @export
+gsvb.refit <- function(fit, niter=150, tol=1e-3, convergence="l1",
+    convergence_k=5, ordering=2, track_elbo=FALSE, track_elbo_every=1,
+    track_elbo_mcn=1e2, track_elbo_tol=1e-3, track_elbo_max=1e3, thresh=0.02,
+    l=5, verbose=TRUE)
+{
+    conv_criteria <- c("l1", "relative", "max", "elbo", "gamma")
+    convergence <- pmatch(convergence, conv_criteria)
+
+    if (is.null(fit$model))
+	stop("fit does not contain a model, see return_model in gsvb.fit")
+    if (length(convergence) == 0 || any(is.na(convergence)))
+	stop("Invalid convergence criteria")
+
+    family <- fit$parameters$family
+    groups <- fit$parameters$groups
+
+    f <- model_refit(fit$model, track_elbo, track_elbo_every, track_elbo_mcn,
+	track_elbo_tol, track_elbo_max, thresh, l, niter, tol, convergence,
+	convergence_k, verbose, ordering)
+
+    # exact names, f$s would also partially match stopped_by
+    if (fit$parameters$diag_covariance == FALSE && any(c(1,3,5) == family)) {
+	f$s <- lapply(f$S, function(s) matrix(s, nrow=sqrt(length(s))))
+    } else {
+	f$s <- f$sigma
+    }
+
+    res <- list(
+	mu = f$mu,
+	s = f$s,
+	g = f$g[!duplicated(groups)],
+	beta_hat = f$mu * f$g,
+	parameters = fit$parameters,
+	converged = f$converged,
+	converged_by = if (f$converged_by > 0) conv_criteria[f$converged_by] else NA,
+	stopped_by = if (!f$converged && f$stopped_by > 0) 
+	    c("time_budget", "progress")[f$stopped_by] else NA,
+	iter = f$iter
+    )
+
+    if (family == 1) {
+	res$tau_a = f$tau_a
+	res$tau_b = f$tau_b
+	res$tau_hat = f$tau_b / (f$tau_a - 1)
+    }
+
+    if (track_elbo) {
+	res$elbo <- f$elbo
+	res$elbo_se <- f$elbo_se
+    }
+
+    res$memory <- f$memory
+
+    if (length(f$profile) > 0)
+	res$profile <- f$profile
+
+    # the model holds the dense state
+    res$parameters$compact <- FALSE
+    res$model <- fit$model
+
+    return(res)
+}
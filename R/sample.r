@@ -4,9 +4,12 @@
 #' @param samples number of samples
 #'
 #' @return a list containing:
-#' \item{beta}{a matrix of samples from beta}
+#' \item{beta}{a sparse matrix (\code{dgCMatrix}) of samples from beta, each column is a sample}
 #' \item{tau}{vector of samples from tau (only for linear model)}
 #' 
+#' @section Details:
+#' Samples are drawn in parallel. Only the coefficients of the groups that are active in a sample are stored, so memory scales with the number of active groups rather than the number of coefficients.
+#'
 #' @examples
 #' n <- 100
 #' p <- 1000
@@ -24,37 +27,20 @@
 #' @export
 gsvb.sample <- function(fit, samples=1e4)
 {
-    groups <- fit$parameters$groups
-    M <- length(fit$g)
-
-    beta <- replicate(samples, 
-    {
-	active_groups <- runif(M) <= fit$g
-	grp <- active_groups[groups]
+    fit <- gsvb.expand(fit)
+    diag_cov <- fit$parameters$diag_covariance
 
-	b <- rep(0, length(grp))
+    # the seed of the RNG streams used by the sampler is drawn from R's RNG
+    # so that samples are reproducible with set.seed
+    seed <- sample.int(.Machine$integer.max, 1)
 
-	if (length(active_groups) == 0)
-	    return(b)
-
-	if (fit$parameters$diag_covariance)
-	{
-	    # sample only from the active groups
-	    m <- rnorm(sum(grp), fit$mu[grp], fit$s[grp])
-	} else 
-	{
-	    m <- sapply(which(active_groups), function(j) {
-		Gj <- which(groups == j)
-		rnorm(length(Gj)) %*% t(chol(fit$s[[j]])) + fit$m[Gj]
-	    })
-	    m <- matrix(as.numeric(unlist(m)), ncol=1)
-	}
-	
-	if (length(grp) != 0) {
-	    b[grp] <- m
-	}
-	return(b)
-    }, simplify="matrix")
+    if (!is.null(fit$model)) {
+	beta <- model_sample(fit$model, samples, seed)
+    } else {
+	beta <- sample_beta(fit$mu, if (diag_cov) fit$s else numeric(0),
+	    if (diag_cov) list() else fit$s, fit$g, fit$parameters$groups, 
+	    diag_cov, samples, seed)
+    }
 
     if (fit$parameters$family == 1) {
 	tau <- 1/rgamma(samples, shape=fit$tau_a, rate=fit$tau_b)
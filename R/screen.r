@@ -0,0 +1,147 @@
+#' Fit a model to the groups that survive a coarse-to-fine screening
+#'
+#' @param y response vector.
+#' @param X input matrix.
+#' @param groups group structure.
+#' @param family which family and bound to use when fitting the model, see \code{gsvb.fit}.
+#' @param intercept should an intercept term be included.
+#' @param pilot_k number of principal directions per group in the pilot fit.
+#' @param pilot_min_g inclusion probability in the pilot fit above which a group is a candidate for the full fit.
+#' @param alpha level of the score test of the excluded groups, Bonferroni corrected for the number of excluded groups.
+#' @param rounds maximum number of times the groups rejected by the score test are added to the candidates and the model refit.
+#' @param verbose print additional information.
+#' @param ... other arguments passed to \code{gsvb.fit}, except the initial values \code{mu}, \code{s} and \code{g}.
+#'
+#' @return A compact fit, see \code{gsvb.fit}, of the candidate groups with the group structure of X, and:
+#' \item{screen}{a list of \code{pilot_g}, the inclusion probability of each group in the pilot fit, \code{p_value}, the p-value of the last score test of each excluded group (\code{NA} for the candidates), \code{missed}, groups rejected by the last score test that were not fit as \code{rounds} was reached, and \code{rounds}, the number of candidates and the groups added in each round.}
+#'
+#' @section Details:
+#' The pilot fit replaces each group by its leading \code{pilot_k} principal directions, \code{X_G V_G}, and is fit with the same engine as the full fit, so its cost scales with the number of groups rather than p. The groups with a pilot inclusion probability of at least \code{pilot_min_g} are then fit at full resolution. Each excluded group is checked with a score test of adding it to the full fit, \code{r' X_G (X_G' W X_G)^-1 X_G' r}, compared to a chi-squared distribution with \code{|G|} degrees of freedom, where \code{r} and \code{W} are the working residuals and weights at the posterior mean (divided by \code{tau_hat} for the gaussian family). The rejected groups are added and the model refit, starting from the previous fit, until none are rejected or after \code{rounds} refits. A pass over the columns of X is made to form the pilot design and for each score test, the fits themselves only see the candidate groups.
+#'
+#' As b0 is the number of groups by default, it is set to the number of groups of X rather than the number of candidates.
+#'
+#' @examples
+#' library(gsvb)
+#'
+#' n <- 100
+#' p <- 1000
+#' gsize <- 5
+#' groups <- c(rep(1:(p/gsize), each=gsize))
+#'
+#' X <- matrix(rnorm(n * p), nrow=n, ncol=p)
+#' b <- c(rep(0, gsize), rep(-4, gsize), rep(8, gsize), rep(0, p - 3 * gsize))
+#' y <- X %*% b + rnorm(n, 0, 1)
+#'
+#' f <- gsvb.fit_screened(y, X, groups)
+#' f$active
+#'
+#' plot(as.vector(f$beta_hat), col=4, ylab=expression(hat(beta)))
+#' points(b, pch=20)
+#'
+#' @export
+gsvb.fit_screened <- function(y, X, groups, family="gaussian", intercept=TRUE,
+    pilot_k=1, pilot_min_g=0.05, alpha=0.05, rounds=3, verbose=TRUE, ...)
+{
+    fam <- pmatch(family, c("gaussian", "binomial-jensens", "binomial-jaakkola",
+	    "binomial-refined", "poisson"))
+
+    # check user input
+    if (is.na(fam))
+	stop("Invalid family")
+    if (min(groups) != 1)
+	stop("group labels must start at 1")
+    if (max(groups) != length(unique(groups)))
+	stop("group labels must not exceed the unique number of groups")
+    if (!all(groups == rep(unique(groups), table(groups))))
+	stop("groups must be ordered")
+
+    args <- list(...)
+    if (any(c("mu", "s", "g") %in% names(args)))
+	stop("initial values can not be passed to the screened fit")
+    M <- length(unique(groups))
+    if (is.null(args$b0)) args$b0 <- M
+    args$compact <- FALSE
+    args$return_model <- FALSE
+    y <- as.vector(y)
+
+    # pilot fit on the principal directions of each group
+    pc <- group_components(X, groups, pilot_k)
+    pilot <- do.call(gsvb.fit, c(list(y=y, X=pc$Z, groups=as.vector(pc$groups),
+	family=family, intercept=intercept, verbose=FALSE), args))
+    pilot_g <- if (intercept) pilot$g[-1] else pilot$g
+
+    cand <- which(pilot_g >= pilot_min_g)
+    if (length(cand) == 0)
+	cand <- which.max(pilot_g)
+
+    if (verbose)
+	cat("Pilot fit:", length(cand), "of", M, "groups are candidates\n")
+
+    size <- tabulate(groups)
+    trace <- list()
+    mu <- NULL
+    f <- NULL
+
+    for (round in 0:rounds)
+    {
+	cols <- which(groups %in% cand)
+	Xc <- X[, cols, drop=FALSE]
+	f <- do.call(gsvb.fit, c(list(y=y, X=Xc, groups=match(groups[cols], cand),
+	    family=family, intercept=intercept, verbose=verbose, mu=mu), args))
+
+	# working residuals and weights at the posterior mean
+	b <- as.vector(f$beta_hat)
+	eta <- if (intercept) b[1] + Xc %*% b[-1] else Xc %*% b
+	eta <- as.vector(eta)
+	if (fam == 1) {
+	    r <- (y - eta) / sqrt(f$tau_hat)
+	    w <- rep(1, length(y))
+	} else if (fam == 5) {
+	    r <- y - exp(eta)
+	    w <- exp(eta)
+	} else {
+	    r <- y - plogis(eta)
+	    w <- plogis(eta) * (1 - plogis(eta))
+	}
+
+	excl <- setdiff(seq_len(M), cand)
+	p_value <- rep(NA, M)
+	add <- integer(0)
+	if (length(excl) > 0) {
+	    score <- group_score(X, groups, excl, r, w)
+	    p_value[excl] <- pchisq(score, size[excl], lower.tail=FALSE)
+	    add <- excl[p_value[excl] < alpha / length(excl)]
+	}
+
+	trace[[length(trace) + 1]] <- data.frame(round=round,
+	    candidates=length(cand), added=length(add))
+	if (length(add) == 0 || round == rounds)
+	    break
+
+	if (verbose)
+	    cat("Score test: adding", length(add), "groups\n")
+
+	# warm start from the previous fit, the added groups start at 0
+	prev <- c(if (intercept) 0, groups[cols])
+	cand <- sort(c(cand, add))
+	new <- c(if (intercept) 0, groups[groups %in% cand])
+	mu <- numeric(length(new))
+	mu[new %in% c(0, prev)] <- f$mu
+    }
+
+    # the fit of the candidates as a compact fit of all the groups
+    pgroups <- if (intercept) c(1, groups + 1) else groups
+    active <- if (intercept) c(1, cand + 1) else cand
+    idx <- which(pgroups %in% active)
+
+    f$parameters$groups <- pgroups
+    f$parameters$compact <- TRUE
+    f$active <- active
+    f$beta_hat <- Matrix::sparseMatrix(i=idx, j=rep(1, length(idx)),
+	x=as.vector(f$beta_hat), dims=c(length(pgroups), 1))
+    f$screen <- list(pilot_g=pilot_g, p_value=p_value,
+	missed=if (length(add) > 0 && round == rounds) add else integer(0),
+	rounds=do.call(rbind, trace))
+
+    return(f)
+}
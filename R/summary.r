@@ -0,0 +1,56 @@
+#' Summarize the variational posterior
+#'
+#' @param fit fit model
+#' @param prob the probability contained in the credible interval of each coefficient
+#' @param fdr the Bayesian false discovery rate used to select groups
+#'
+#' @return a list containing:
+#' \item{coefficients}{a data frame with a row per coefficient and the columns \code{group}, \code{mean}, the posterior mean, \code{inclusion.prob}, the marginal inclusion probability, and \code{lower}, \code{upper}, \code{contains.dirac}, the credible interval as in \code{gsvb.credible_intervals}}
+#' \item{groups}{a data frame with a row per group and the columns \code{group}, \code{inclusion.prob} and \code{selected}, indicating if the group is selected}
+#' \item{bfdr}{the estimated Bayesian false discovery rate of the selected groups}
+#' 
+#' @section Details: 
+#' Groups are selected by taking the largest set of groups with the highest inclusion probabilities such that the mean of \eqn{1 - \gamma_k} over the set, the Bayesian FDR, is at most \code{fdr}.
+#'
+#' @examples
+#' n <- 100
+#' p <- 1000
+#' gsize <- 5
+#' groups <- c(rep(1:(p/gsize), each=gsize))
+#' 
+#' X <- matrix(rnorm(n * p), nrow=n, ncol=p)
+#' b <- c(rep(0, gsize), rep(-4, gsize), rep(8, gsize), rep(0, p - 3 * gsize))
+#' y <- X %*% b + rnorm(n, 0, 1)
+#' 
+#' f <- gsvb.fit(y, X, groups)
+#' s <- gsvb.summary(f, prob=0.95, fdr=0.05)
+#' s$groups[s$groups$selected, ]
+#' 
+#' @export
+gsvb.summary <- function(fit, prob=0.95, fdr=0.05)
+{
+    fit <- gsvb.expand(fit)
+    diag_cov <- fit$parameters$diag_covariance
+    groups <- fit$parameters$groups
+
+    res <- posterior_summary(fit$mu, if (diag_cov) fit$s else numeric(0),
+	if (diag_cov) list() else fit$s, fit$g, groups, diag_cov, prob, fdr)
+
+    coefficients <- data.frame(
+	group=groups,
+	mean=as.vector(fit$beta_hat),
+	inclusion.prob=as.vector(res$inclusion_prob),
+	lower=as.vector(res$lower),
+	upper=as.vector(res$upper),
+	contains.dirac=as.vector(res$contains_dirac) == 1
+    )
+
+    group_summary <- data.frame(
+	group=unique(groups),
+	inclusion.prob=fit$g,
+	selected=as.vector(res$selected) == 1
+    )
+
+    return(list(coefficients=coefficients, groups=group_summary, 
+	bfdr=res$bfdr))
+}
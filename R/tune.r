@@ -0,0 +1,99 @@
+# Settings chosen by gsvb.fit(auto=TRUE).
+#
+# The options of gsvb.fit that are left at their defaults and only change
+# how fast the fit runs, rather than the model, are tuned on a subsample of
+# the rows. A reference fit with the default settings is run to
+# convergence, then each option is varied in turn, holding the others at
+# the best value so far, and the fastest setting whose inclusion
+# probabilities are within `tol` of the reference is kept. The time of a
+# fit is the time of its main loop, measured by the progress callback, so
+# the initialization does not count. If the package is compiled with
+# -DGSVB_PROFILE, the time of each phase of each calibration fit is also
+# recorded in the calibration table, as the columns time_<phase>, but only
+# the total time is used to choose the settings.
+#
+# args are the arguments of the call to gsvb.fit and free the candidate
+# values of the options that may be tuned, the first value of each is the
+# default. Returns the chosen settings and the calibration runs.
+auto_tune <- function(y, X, groups, args, free, opts)
+{
+    opts <- modifyList(list(n=500, niter=50, tol=0.05, time_budget=10),
+	if (is.list(opts)) opts else list())
+
+    if (length(free) == 0)
+	return(list(settings=list(), n=0, niter=opts$niter, tol=opts$tol,
+	    calibration=NULL))
+
+    # the rows used for the calibration
+    rows <- seq_len(nrow(X))
+    if (nrow(X) > opts$n)
+	rows <- sort(sample.int(nrow(X), opts$n))
+    ys <- y[rows]
+    Xs <- X[rows, , drop=FALSE]
+
+    calibrate <- function(settings) {
+	t <- c(0, 0)
+	a <- modifyList(args, settings)
+	a <- modifyList(a, list(y=ys, X=Xs, groups=groups, niter=opts$niter,
+	    verbose=FALSE, auto=FALSE, return_model=FALSE, compact=FALSE,
+	    time_budget=opts$time_budget, progress_every=1,
+	    progress=function(info) { t[info$stage] <<- info$elapsed; FALSE }))
+	a["checkpoint"] <- list(NULL)
+	a["resume"] <- list(NULL)
+
+	f <- tryCatch(suppressMessages(do.call(gsvb.fit, a)),
+	    error=function(e) NULL)
+	if (is.null(f)) return(NULL)
+	list(fit=f, seconds=sum(t))
+    }
+
+    # the row of a calibration run, with the time of each phase if profiled
+    run_row <- function(option, value, r, d_g, chosen) {
+	phases <- if (length(r$fit$profile) > 0) {
+	    tm <- r$fit$profile$time
+	    setNames(as.list(tm), paste0("time_", names(tm)))
+	} else list()
+	as.data.frame(c(list(option=option, value=value, seconds=r$seconds,
+	    iter=r$fit$iter, per_sweep=r$seconds / max(r$fit$iter, 1),
+	    converged=r$fit$converged, d_g=d_g, chosen=chosen), phases),
+	    stringsAsFactors=FALSE)
+    }
+
+    best <- lapply(free, function(v) v[1])
+    ref <- calibrate(best)
+    if (is.null(ref))
+	stop("auto: the calibration fit with the default settings failed")
+
+    runs <- list(run_row("default", NA, ref, 0, NA))
+    best_time <- ref$seconds
+
+    for (opt in names(free)) {
+	chosen <- NULL
+	for (v in free[[opt]][-1]) {
+	    settings <- modifyList(best, setNames(list(v), opt))
+	    r <- calibrate(settings)
+	    if (is.null(r)) next
+
+	    d_g <- max(abs(r$fit$g - ref$fit$g))
+	    ok <- d_g <= opts$tol && r$seconds < best_time
+	    if (ok) {
+		chosen <- v
+		best_time <- r$seconds
+	    }
+
+	    runs[[length(runs) + 1]] <- run_row(opt, as.character(v), r,
+		d_g, ok)
+	}
+	if (!is.null(chosen)) {
+	    # only the last setting kept for an option is chosen
+	    runs <- lapply(runs, function(r) {
+		if (r$option == opt) r$chosen <- r$value == as.character(chosen)
+		r
+	    })
+	    best[[opt]] <- chosen
+	}
+    }
+
+    list(settings=best, n=length(rows), niter=opts$niter, tol=opts$tol,
+	calibration=do.call(rbind, runs))
+}
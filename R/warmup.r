@@ -0,0 +1,55 @@
+# Progressive row-sampling warm-up of the binomial and poisson fits, used
+# by gsvb.fit(warmup=TRUE).
+#
+# The early sweeps only move mu and g roughly into place, so they are run
+# on nested random subsets of the rows: the fit starts on n0 rows and the
+# subset grows by `growth` each time the fit on the current subset
+# converges with the looser tolerance `tol`, or after `niter` sweeps, until
+# the next subset would hold all the rows. The last warm-up fit is the
+# starting point of the fit on the full data. The covariances shrink as
+# 1/n, so they are rescaled as the subset grows: the std. devs by
+# sqrt(m / m_next) and the full covariances, which are passed on to the
+# next fit as control$S, by m / m_next.
+#
+# fit is called as fit(rows, mu, s, g, S, niter, tol), with S NULL for the
+# first fit, and returns the output of the fitting routine. Returns the
+# warm start and the schedule.
+row_warmup <- function(n, fit, mu, s, g, diag_covariance, opts, tol)
+{
+    opts <- modifyList(list(n0=max(200, ceiling(n / 64)), growth=4,
+	niter=20, tol=10 * tol), if (is.list(opts)) opts else list())
+
+    if (opts$growth <= 1)
+	stop("warmup growth must be greater than 1")
+
+    perm <- sample.int(n)
+    m <- min(opts$n0, n)
+    stages <- list()
+    S <- NULL
+
+    while (m < n) {
+	t <- proc.time()[["elapsed"]]
+	f <- fit(sort(perm[seq_len(m)]), mu, s, g, S, opts$niter, opts$tol)
+
+	m_next <- min(ceiling(m * opts$growth), n)
+	mu <- f$mu
+	g <- f$gamma
+	if (diag_covariance) {
+	    s <- f$sigma * sqrt(m / m_next)
+	} else {
+	    S <- lapply(f$S, function(S) 
+		matrix(S, nrow=sqrt(length(S))) * m / m_next)
+	    s <- sqrt(unlist(lapply(S, diag)))
+	}
+
+	stages[[length(stages) + 1]] <- data.frame(rows=m, iter=f$iterations,
+	    converged=f$converged, seconds=proc.time()[["elapsed"]] - t)
+
+	if (f$stopped_by > 0)
+	    break
+	m <- m_next
+    }
+
+    list(mu=mu, s=s, g=g, S=S,
+	schedule=if (length(stages)) do.call(rbind, stages) else NULL)
+}
@@ -0,0 +1,337 @@
+#ifndef GSVB_SCORER_H
+#define GSVB_SCORER_H
+
+// Header-only scorer for models exported with gsvb.export.
+//
+// The file is mapped into memory and the header and the group table are
+// validated on load, the means and covariance factors are read in place,
+// so the load time does not depend on the number of coefficients. Only the groups
+// kept at export are stored, coefficients of the remaining groups are
+// zero and are never touched when scoring.
+//
+// Layout (native byte order, every section starts at a multiple of
+// GSVB_FILE_ALIGN bytes):
+//
+//	file_header
+//	group_record[n_groups]	first design column, size and offsets
+//	double[n_groups]	inclusion probabilities g
+//	double[n_coef]		means mu
+//	double[n_factor]	std. devs s (diag_cov) or the lower Cholesky
+//				factor L of each group covariance, S = LL',
+//				stored column major
+//
+// Design columns include the intercept, which is column 0 when the
+// intercept flag is set, newdata is given without it.
+//
+// Usage:
+//	gsvb::scorer sc("model.gsvb");
+//	sc.score(X, n, sc.ncol(), 1, mean, var);	// X row major n x p
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define GSVB_FILE_VERSION 1
+#define GSVB_FILE_ALIGN 64
+#define GSVB_FILE_ENDIAN 0x01020304u
+
+#define GSVB_FILE_DIAG_COV 1u
+#define GSVB_FILE_INTERCEPT 2u
+
+namespace gsvb {
+
+struct file_header
+{
+    char magic[8];		// "GSVBMDL"
+    uint32_t version;
+    uint32_t endian;		// GSVB_FILE_ENDIAN as written
+    uint32_t family;		// as in gsvb.fit, 1 gaussian .. 5 poisson
+    uint32_t flags;		// GSVB_FILE_DIAG_COV | GSVB_FILE_INTERCEPT
+    uint64_t p;			// number of columns of newdata
+    uint64_t n_groups;		// number of stored groups
+    uint64_t n_coef;
+    uint64_t n_factor;
+    double tau_a;
+    double tau_b;
+    uint64_t off_groups;
+    uint64_t off_g;
+    uint64_t off_mu;
+    uint64_t off_factor;
+    uint64_t size;		// total size of the file in bytes
+    uint8_t reserved[16];
+};
+
+struct group_record
+{
+    uint64_t col;		// first design column of the group
+    uint64_t size;
+    uint64_t coef;		// offset of the group in mu
+    uint64_t factor;		// offset of the group in the factors
+};
+
+static_assert(sizeof(file_header) == 128, "unexpected file_header size");
+static_assert(sizeof(group_record) == 32, "unexpected group_record size");
+
+inline uint64_t file_align(const uint64_t off)
+{
+    return (off + GSVB_FILE_ALIGN - 1) / GSVB_FILE_ALIGN * GSVB_FILE_ALIGN;
+}
+
+
+// fill in the offsets and the size of the file given the counts
+inline void file_layout(file_header &h)
+{
+    h.off_groups = file_align(sizeof(file_header));
+    h.off_g = file_align(h.off_groups + h.n_groups * sizeof(group_record));
+    h.off_mu = file_align(h.off_g + h.n_groups * sizeof(double));
+    h.off_factor = file_align(h.off_mu + h.n_coef * sizeof(double));
+    h.size = file_align(h.off_factor + h.n_factor * sizeof(double));
+}
+
+
+class scorer
+{
+public:
+    explicit scorer(const std::string &path) :
+	base(nullptr), length(0)
+    {
+	map(path);
+
+	if (length < sizeof(file_header)) {
+	    unmap();
+	    throw std::runtime_error("gsvb: file too small: " + path);
+	}
+
+	std::memcpy(&h, base, sizeof(file_header));
+
+	std::string err;
+	if (std::strncmp(h.magic, "GSVBMDL", 8) != 0)
+	    err = "not a gsvb model file";
+	else if (h.endian != GSVB_FILE_ENDIAN)
+	    err = "byte order mismatch";
+	else if (h.version != GSVB_FILE_VERSION)
+	    err = "unsupported version " + std::to_string(h.version);
+	else if (h.size > length)
+	    err = "truncated file";
+	else
+	    err = check_layout();
+
+	if (!err.empty()) {
+	    unmap();
+	    throw std::runtime_error("gsvb: " + err + ": " + path);
+	}
+
+	groups = reinterpret_cast<const group_record *>(base + h.off_groups);
+	g = reinterpret_cast<const double *>(base + h.off_g);
+	mu = reinterpret_cast<const double *>(base + h.off_mu);
+	factor = reinterpret_cast<const double *>(base + h.off_factor);
+    }
+
+    ~scorer() { unmap(); }
+
+    scorer(const scorer &) = delete;
+    scorer &operator=(const scorer &) = delete;
+
+    const file_header &header() const { return h; }
+    uint64_t ncol() const { return h.p; }
+    uint64_t ngroups() const { return h.n_groups; }
+    bool diag_cov() const { return h.flags & GSVB_FILE_DIAG_COV; }
+    bool intercept() const { return h.flags & GSVB_FILE_INTERCEPT; }
+
+    // Predictive moments of the rows of X. Element (i, j) of X is
+    // X[i * rs + j * cs], e.g. rs = p, cs = 1 for a row major matrix and
+    // rs = 1, cs = n for a column major matrix.
+    //
+    // mean, var are the moments of the response as in gsvb.predict with
+    // type = "moments", eta_mean, eta_var those of the linear predictor
+    // x'b and may be null.
+    void score(const double *X, const size_t n, const size_t rs,
+	    const size_t cs, double *mean, double *var,
+	    double *eta_mean = nullptr, double *eta_var = nullptr) const
+    {
+	constexpr double pi = 3.14159265358979323846;
+	const bool diag = diag_cov();
+	const uint64_t c0 = intercept() ? 1 : 0;
+
+	std::vector<double> xg;
+	std::vector<double> t;
+
+	for (size_t i = 0; i < n; ++i)
+	{
+	    double m = 0.0, v = 0.0, P = 1.0, P2 = 1.0;
+
+	    for (uint64_t k = 0; k < h.n_groups; ++k)
+	    {
+		const group_record &r = groups[k];
+		const double *mu_G = mu + r.coef;
+		const double *f_G = factor + r.factor;
+		const uint64_t mk = r.size;
+
+		xg.resize(mk);
+		for (uint64_t j = 0; j < mk; ++j) {
+		    const uint64_t col = r.col + j;
+		    xg[j] = col < c0 ? 1.0 : X[i * rs + (col - c0) * cs];
+		}
+
+		double c = 0.0, q = 0.0;
+		for (uint64_t j = 0; j < mk; ++j)
+		    c += xg[j] * mu_G[j];
+
+		if (diag) {
+		    for (uint64_t j = 0; j < mk; ++j)
+			q += xg[j] * xg[j] * f_G[j] * f_G[j];
+		} else {
+		    // x'Sx = || L'x ||^2
+		    for (uint64_t a = 0; a < mk; ++a) {
+			double ta = 0.0;
+			for (uint64_t b = a; b < mk; ++b)
+			    ta += f_G[a * mk + b] * xg[b];
+			q += ta * ta;
+		    }
+		}
+
+		const double gk = g[k];
+		m += gk * c;
+		v += gk * (q + c * c) - gk * gk * c * c;
+
+		if (h.family == 5) {
+		    P  *= (1.0 - gk) + gk * std::exp(c + 0.5 * q);
+		    P2 *= (1.0 - gk) + gk * std::exp(2.0 * c + 2.0 * q);
+		}
+	    }
+
+	    if (eta_mean) eta_mean[i] = m;
+	    if (eta_var) eta_var[i] = v;
+
+	    if (h.family == 1) {
+		const double e_tau2 = h.tau_a > 1.0 ?
+		    h.tau_b / (h.tau_a - 1.0) : INFINITY;
+		mean[i] = m;
+		var[i] = v + e_tau2;
+	    } else if (h.family == 5) {
+		mean[i] = P;
+		var[i] = P + P2 - P * P;
+	    } else {
+		mean[i] = 1.0 / (1.0 + std::exp(-m /
+			    std::sqrt(1.0 + pi * v / 8.0)));
+		var[i] = mean[i] * (1.0 - mean[i]);
+	    }
+	}
+    }
+
+private:
+    // the offsets must be those of file_layout and each group must lie
+    // within the design columns, mu and the factors, so a corrupt file is
+    // rejected rather than read out of bounds. The counts are bounded by
+    // the length first, so the layout does not overflow.
+    std::string check_layout() const
+    {
+	const uint64_t max_n = length / sizeof(double);
+	if (h.n_groups > length / sizeof(group_record) || h.n_coef > max_n ||
+		h.n_factor > max_n)
+	    return "invalid counts";
+
+	file_header e = h;
+	file_layout(e);
+	if (e.off_groups != h.off_groups || e.off_g != h.off_g ||
+		e.off_mu != h.off_mu || e.off_factor != h.off_factor ||
+		e.size > length)
+	    return "invalid offsets";
+
+	const uint64_t ncol = h.p + (intercept() ? 1 : 0);
+	const group_record *r = reinterpret_cast<const group_record *>(
+		base + h.off_groups);
+	for (uint64_t k = 0; k < h.n_groups; ++k) {
+	    const uint64_t mk = r[k].size;
+	    if (mk > ncol || r[k].col > ncol - mk)
+		return "group " + std::to_string(k) + " exceeds the columns";
+	    if (mk > h.n_coef || r[k].coef > h.n_coef - mk)
+		return "group " + std::to_string(k) + " exceeds the means";
+
+	    uint64_t nf = mk;
+	    if (!diag_cov()) {
+		if (mk > 0 && mk > h.n_factor / mk)
+		    return "group " + std::to_string(k) + 
+			" exceeds the factors";
+		nf = mk * mk;
+	    }
+	    if (nf > h.n_factor || r[k].factor > h.n_factor - nf)
+		return "group " + std::to_string(k) + " exceeds the factors";
+	}
+
+	return "";
+    }
+
+    void map(const std::string &path)
+    {
+#ifndef _WIN32
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	    throw std::runtime_error("gsvb: cannot open " + path);
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+	    close(fd);
+	    throw std::runtime_error("gsvb: cannot stat " + path);
+	}
+
+	length = static_cast<size_t>(st.st_size);
+	void *addr = length ?
+	    mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+
+	if (addr == MAP_FAILED)
+	    throw std::runtime_error("gsvb: cannot map " + path);
+	base = static_cast<const char *>(addr);
+#else
+	// no mmap, read into a buffer of doubles to keep the alignment
+	std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+	if (!in)
+	    throw std::runtime_error("gsvb: cannot open " + path);
+
+	length = static_cast<size_t>(in.tellg());
+	buffer.resize((length + sizeof(double) - 1) / sizeof(double));
+	in.seekg(0);
+	in.read(reinterpret_cast<char *>(buffer.data()), length);
+	base = reinterpret_cast<const char *>(buffer.data());
+#endif
+    }
+
+    void unmap()
+    {
+#ifndef _WIN32
+	if (base) munmap(const_cast<char *>(base), length);
+#else
+	buffer.clear();
+#endif
+	base = nullptr;
+    }
+
+    const char *base;
+    size_t length;
+#ifdef _WIN32
+    std::vector<double> buffer;
+#endif
+
+    file_header h;
+    const group_record *groups;
+    const double *g;
+    const double *mu;
+    const double *factor;
+};
+
+}
+
+#endif
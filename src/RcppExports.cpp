@@ -13,9 +13,86 @@ Rcpp::Rostream<true>&  Rcpp::Rcout = Rcpp::Rcpp_cout_get();
 Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
 #endif
 
+// bench_kernels
+Rcpp::DataFrame bench_kernels(const uword n, const uword p, const uword m, const uword threads, const uword reps, const double min_time, const Rcpp::CharacterVector kernels);
+RcppExport SEXP _gsvb_bench_kernels(SEXP nSEXP, SEXP pSEXP, SEXP mSEXP, SEXP threadsSEXP, SEXP repsSEXP, SEXP min_timeSEXP, SEXP kernelsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const uword >::type n(nSEXP);
+    Rcpp::traits::input_parameter< const uword >::type p(pSEXP);
+    Rcpp::traits::input_parameter< const uword >::type m(mSEXP);
+    Rcpp::traits::input_parameter< const uword >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< const uword >::type reps(repsSEXP);
+    Rcpp::traits::input_parameter< const double >::type min_time(min_timeSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::CharacterVector >::type kernels(kernelsSEXP);
+    rcpp_result_gen = Rcpp::wrap(bench_kernels(n, p, m, threads, reps, min_time, kernels));
+    return rcpp_result_gen;
+END_RCPP
+}
+// checkpoint_read
+Rcpp::List checkpoint_read(const std::string& path);
+RcppExport SEXP _gsvb_checkpoint_read(SEXP pathSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type path(pathSEXP);
+    rcpp_result_gen = Rcpp::wrap(checkpoint_read(path));
+    return rcpp_result_gen;
+END_RCPP
+}
+// model_write
+double model_write(const std::string& path, const vec& mu, const vec& s, const std::vector<mat>& Ss, const vec& g, const uvec& groups, const bool diag_cov, const uword family, const double tau_a, const double tau_b, const bool intercept, const double min_g);
+RcppExport SEXP _gsvb_model_write(SEXP pathSEXP, SEXP muSEXP, SEXP sSEXP, SEXP SsSEXP, SEXP gSEXP, SEXP groupsSEXP, SEXP diag_covSEXP, SEXP familySEXP, SEXP tau_aSEXP, SEXP tau_bSEXP, SEXP interceptSEXP, SEXP min_gSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type mu(muSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type s(sSEXP);
+    Rcpp::traits::input_parameter< const std::vector<mat>& >::type Ss(SsSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type g(gSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type groups(groupsSEXP);
+    Rcpp::traits::input_parameter< const bool >::type diag_cov(diag_covSEXP);
+    Rcpp::traits::input_parameter< const uword >::type family(familySEXP);
+    Rcpp::traits::input_parameter< const double >::type tau_a(tau_aSEXP);
+    Rcpp::traits::input_parameter< const double >::type tau_b(tau_bSEXP);
+    Rcpp::traits::input_parameter< const bool >::type intercept(interceptSEXP);
+    Rcpp::traits::input_parameter< const double >::type min_g(min_gSEXP);
+    rcpp_result_gen = Rcpp::wrap(model_write(path, mu, s, Ss, g, groups, diag_cov, family, tau_a, tau_b, intercept, min_g));
+    return rcpp_result_gen;
+END_RCPP
+}
+// model_score
+Rcpp::List model_score(const std::string& path, const mat& X);
+RcppExport SEXP _gsvb_model_score(SEXP pathSEXP, SEXP XSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< const mat& >::type X(XSEXP);
+    rcpp_result_gen = Rcpp::wrap(model_score(path, X));
+    return rcpp_result_gen;
+END_RCPP
+}
+// init_mu
+vec init_mu(const vec& y, const mat& X, const uvec& groups, const uword family, const uword method);
+RcppExport SEXP _gsvb_init_mu(SEXP ySEXP, SEXP XSEXP, SEXP groupsSEXP, SEXP familySEXP, SEXP methodSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const vec& >::type y(ySEXP);
+    Rcpp::traits::input_parameter< const mat& >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type groups(groupsSEXP);
+    Rcpp::traits::input_parameter< const uword >::type family(familySEXP);
+    Rcpp::traits::input_parameter< const uword >::type method(methodSEXP);
+    rcpp_result_gen = Rcpp::wrap(init_mu(y, X, groups, family, method));
+    return rcpp_result_gen;
+END_RCPP
+}
 // fit_linear
-Rcpp::List fit_linear(vec y, mat X, uvec groups, const double lambda, const double a0, const double b0, const double tau_a0, const double tau_b0, vec mu, vec s, vec g, bool diag_cov, bool track_elbo, const uword track_elbo_every, const uword track_elbo_mcn, unsigned int niter, double tol, bool verbose, const uword ordering);
-RcppExport SEXP _gsvb_fit_linear(SEXP ySEXP, SEXP XSEXP, SEXP groupsSEXP, SEXP lambdaSEXP, SEXP a0SEXP, SEXP b0SEXP, SEXP tau_a0SEXP, SEXP tau_b0SEXP, SEXP muSEXP, SEXP sSEXP, SEXP gSEXP, SEXP diag_covSEXP, SEXP track_elboSEXP, SEXP track_elbo_everySEXP, SEXP track_elbo_mcnSEXP, SEXP niterSEXP, SEXP tolSEXP, SEXP verboseSEXP, SEXP orderingSEXP) {
+Rcpp::List fit_linear(vec y, mat X, uvec groups, const double lambda, const double a0, const double b0, const double tau_a0, const double tau_b0, vec mu, vec s, vec g, bool diag_cov, bool track_elbo, const uword track_elbo_every, const uword track_elbo_mcn, const double track_elbo_tol, const uword track_elbo_max, unsigned int niter, double tol, const uvec convergence, const uword convergence_k, bool verbose, const uword ordering, const double compact, const Rcpp::List control);
+RcppExport SEXP _gsvb_fit_linear(SEXP ySEXP, SEXP XSEXP, SEXP groupsSEXP, SEXP lambdaSEXP, SEXP a0SEXP, SEXP b0SEXP, SEXP tau_a0SEXP, SEXP tau_b0SEXP, SEXP muSEXP, SEXP sSEXP, SEXP gSEXP, SEXP diag_covSEXP, SEXP track_elboSEXP, SEXP track_elbo_everySEXP, SEXP track_elbo_mcnSEXP, SEXP track_elbo_tolSEXP, SEXP track_elbo_maxSEXP, SEXP niterSEXP, SEXP tolSEXP, SEXP convergenceSEXP, SEXP convergence_kSEXP, SEXP verboseSEXP, SEXP orderingSEXP, SEXP compactSEXP, SEXP controlSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -34,17 +111,23 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< bool >::type track_elbo(track_elboSEXP);
     Rcpp::traits::input_parameter< const uword >::type track_elbo_every(track_elbo_everySEXP);
     Rcpp::traits::input_parameter< const uword >::type track_elbo_mcn(track_elbo_mcnSEXP);
+    Rcpp::traits::input_parameter< const double >::type track_elbo_tol(track_elbo_tolSEXP);
+    Rcpp::traits::input_parameter< const uword >::type track_elbo_max(track_elbo_maxSEXP);
     Rcpp::traits::input_parameter< unsigned int >::type niter(niterSEXP);
     Rcpp::traits::input_parameter< double >::type tol(tolSEXP);
+    Rcpp::traits::input_parameter< const uvec >::type convergence(convergenceSEXP);
+    Rcpp::traits::input_parameter< const uword >::type convergence_k(convergence_kSEXP);
     Rcpp::traits::input_parameter< bool >::type verbose(verboseSEXP);
     Rcpp::traits::input_parameter< const uword >::type ordering(orderingSEXP);
-    rcpp_result_gen = Rcpp::wrap(fit_linear(y, X, groups, lambda, a0, b0, tau_a0, tau_b0, mu, s, g, diag_cov, track_elbo, track_elbo_every, track_elbo_mcn, niter, tol, verbose, ordering));
+    Rcpp::traits::input_parameter< const double >::type compact(compactSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::List >::type control(controlSEXP);
+    rcpp_result_gen = Rcpp::wrap(fit_linear(y, X, groups, lambda, a0, b0, tau_a0, tau_b0, mu, s, g, diag_cov, track_elbo, track_elbo_every, track_elbo_mcn, track_elbo_tol, track_elbo_max, niter, tol, convergence, convergence_k, verbose, ordering, compact, control));
     return rcpp_result_gen;
 END_RCPP
 }
 // elbo_linear_c
-double elbo_linear_c(const double yty, const vec& yx, const mat& xtx, const uvec& groups, const uword n, const uword p, const vec& mu, const vec& s, const vec& g, const double tau_a, const double tau_b, const double lambda, const double a0, const double b0, const double tau_a0, const double tau_b0, const uword mcn, const bool approx, const double approx_thresh);
-RcppExport SEXP _gsvb_elbo_linear_c(SEXP ytySEXP, SEXP yxSEXP, SEXP xtxSEXP, SEXP groupsSEXP, SEXP nSEXP, SEXP pSEXP, SEXP muSEXP, SEXP sSEXP, SEXP gSEXP, SEXP tau_aSEXP, SEXP tau_bSEXP, SEXP lambdaSEXP, SEXP a0SEXP, SEXP b0SEXP, SEXP tau_a0SEXP, SEXP tau_b0SEXP, SEXP mcnSEXP, SEXP approxSEXP, SEXP approx_threshSEXP) {
+vec elbo_linear_c(const double yty, const vec& yx, const mat& xtx, const uvec& groups, const uword n, const uword p, const vec& mu, const vec& s, const vec& g, const double tau_a, const double tau_b, const double lambda, const double a0, const double b0, const double tau_a0, const double tau_b0, const uword mcn, const double mc_tol, const uword mc_max, const bool approx, const double approx_thresh);
+RcppExport SEXP _gsvb_elbo_linear_c(SEXP ytySEXP, SEXP yxSEXP, SEXP xtxSEXP, SEXP groupsSEXP, SEXP nSEXP, SEXP pSEXP, SEXP muSEXP, SEXP sSEXP, SEXP gSEXP, SEXP tau_aSEXP, SEXP tau_bSEXP, SEXP lambdaSEXP, SEXP a0SEXP, SEXP b0SEXP, SEXP tau_a0SEXP, SEXP tau_b0SEXP, SEXP mcnSEXP, SEXP mc_tolSEXP, SEXP mc_maxSEXP, SEXP approxSEXP, SEXP approx_threshSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -65,15 +148,17 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const double >::type tau_a0(tau_a0SEXP);
     Rcpp::traits::input_parameter< const double >::type tau_b0(tau_b0SEXP);
     Rcpp::traits::input_parameter< const uword >::type mcn(mcnSEXP);
+    Rcpp::traits::input_parameter< const double >::type mc_tol(mc_tolSEXP);
+    Rcpp::traits::input_parameter< const uword >::type mc_max(mc_maxSEXP);
     Rcpp::traits::input_parameter< const bool >::type approx(approxSEXP);
     Rcpp::traits::input_parameter< const double >::type approx_thresh(approx_threshSEXP);
-    rcpp_result_gen = Rcpp::wrap(elbo_linear_c(yty, yx, xtx, groups, n, p, mu, s, g, tau_a, tau_b, lambda, a0, b0, tau_a0, tau_b0, mcn, approx, approx_thresh));
+    rcpp_result_gen = Rcpp::wrap(elbo_linear_c(yty, yx, xtx, groups, n, p, mu, s, g, tau_a, tau_b, lambda, a0, b0, tau_a0, tau_b0, mcn, mc_tol, mc_max, approx, approx_thresh));
     return rcpp_result_gen;
 END_RCPP
 }
 // elbo_linear_u
-double elbo_linear_u(const double yty, const vec& yx, const mat& xtx, const uvec& groups, const uword n, const uword p, const vec& mu, const std::vector<mat>& Ss, const vec& g, const double tau_a, const double tau_b, const double lambda, const double a0, const double b0, const double tau_a0, const double tau_b0, const uword mcn, const bool approx, const double approx_thresh);
-RcppExport SEXP _gsvb_elbo_linear_u(SEXP ytySEXP, SEXP yxSEXP, SEXP xtxSEXP, SEXP groupsSEXP, SEXP nSEXP, SEXP pSEXP, SEXP muSEXP, SEXP SsSEXP, SEXP gSEXP, SEXP tau_aSEXP, SEXP tau_bSEXP, SEXP lambdaSEXP, SEXP a0SEXP, SEXP b0SEXP, SEXP tau_a0SEXP, SEXP tau_b0SEXP, SEXP mcnSEXP, SEXP approxSEXP, SEXP approx_threshSEXP) {
+vec elbo_linear_u(const double yty, const vec& yx, const mat& xtx, const uvec& groups, const uword n, const uword p, const vec& mu, const std::vector<mat>& Ss, const vec& g, const double tau_a, const double tau_b, const double lambda, const double a0, const double b0, const double tau_a0, const double tau_b0, const uword mcn, const double mc_tol, const uword mc_max, const bool approx, const double approx_thresh);
+RcppExport SEXP _gsvb_elbo_linear_u(SEXP ytySEXP, SEXP yxSEXP, SEXP xtxSEXP, SEXP groupsSEXP, SEXP nSEXP, SEXP pSEXP, SEXP muSEXP, SEXP SsSEXP, SEXP gSEXP, SEXP tau_aSEXP, SEXP tau_bSEXP, SEXP lambdaSEXP, SEXP a0SEXP, SEXP b0SEXP, SEXP tau_a0SEXP, SEXP tau_b0SEXP, SEXP mcnSEXP, SEXP mc_tolSEXP, SEXP mc_maxSEXP, SEXP approxSEXP, SEXP approx_threshSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -94,15 +179,17 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const double >::type tau_a0(tau_a0SEXP);
     Rcpp::traits::input_parameter< const double >::type tau_b0(tau_b0SEXP);
     Rcpp::traits::input_parameter< const uword >::type mcn(mcnSEXP);
+    Rcpp::traits::input_parameter< const double >::type mc_tol(mc_tolSEXP);
+    Rcpp::traits::input_parameter< const uword >::type mc_max(mc_maxSEXP);
     Rcpp::traits::input_parameter< const bool >::type approx(approxSEXP);
     Rcpp::traits::input_parameter< const double >::type approx_thresh(approx_threshSEXP);
-    rcpp_result_gen = Rcpp::wrap(elbo_linear_u(yty, yx, xtx, groups, n, p, mu, Ss, g, tau_a, tau_b, lambda, a0, b0, tau_a0, tau_b0, mcn, approx, approx_thresh));
+    rcpp_result_gen = Rcpp::wrap(elbo_linear_u(yty, yx, xtx, groups, n, p, mu, Ss, g, tau_a, tau_b, lambda, a0, b0, tau_a0, tau_b0, mcn, mc_tol, mc_max, approx, approx_thresh));
     return rcpp_result_gen;
 END_RCPP
 }
 // fit_logistic
-Rcpp::List fit_logistic(vec y, mat X, uvec groups, const double lambda, const double a0, const double b0, vec mu, vec s, vec g, const bool diag_cov, bool track_elbo, const uword track_elbo_every, const uword track_elbo_mcn, const double thresh, const int l, unsigned int niter, unsigned int alg, double tol, bool verbose, const uword ordering);
-RcppExport SEXP _gsvb_fit_logistic(SEXP ySEXP, SEXP XSEXP, SEXP groupsSEXP, SEXP lambdaSEXP, SEXP a0SEXP, SEXP b0SEXP, SEXP muSEXP, SEXP sSEXP, SEXP gSEXP, SEXP diag_covSEXP, SEXP track_elboSEXP, SEXP track_elbo_everySEXP, SEXP track_elbo_mcnSEXP, SEXP threshSEXP, SEXP lSEXP, SEXP niterSEXP, SEXP algSEXP, SEXP tolSEXP, SEXP verboseSEXP, SEXP orderingSEXP) {
+Rcpp::List fit_logistic(vec y, mat X, uvec groups, const double lambda, const double a0, const double b0, vec mu, vec s, vec g, const bool diag_cov, bool track_elbo, const uword track_elbo_every, const uword track_elbo_mcn, const double track_elbo_tol, const uword track_elbo_max, const double thresh, const int l, unsigned int niter, unsigned int alg, double tol, const uvec convergence, const uword convergence_k, bool verbose, const uword ordering, const double compact, const Rcpp::List control);
+RcppExport SEXP _gsvb_fit_logistic(SEXP ySEXP, SEXP XSEXP, SEXP groupsSEXP, SEXP lambdaSEXP, SEXP a0SEXP, SEXP b0SEXP, SEXP muSEXP, SEXP sSEXP, SEXP gSEXP, SEXP diag_covSEXP, SEXP track_elboSEXP, SEXP track_elbo_everySEXP, SEXP track_elbo_mcnSEXP, SEXP track_elbo_tolSEXP, SEXP track_elbo_maxSEXP, SEXP threshSEXP, SEXP lSEXP, SEXP niterSEXP, SEXP algSEXP, SEXP tolSEXP, SEXP convergenceSEXP, SEXP convergence_kSEXP, SEXP verboseSEXP, SEXP orderingSEXP, SEXP compactSEXP, SEXP controlSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -119,20 +206,26 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< bool >::type track_elbo(track_elboSEXP);
     Rcpp::traits::input_parameter< const uword >::type track_elbo_every(track_elbo_everySEXP);
     Rcpp::traits::input_parameter< const uword >::type track_elbo_mcn(track_elbo_mcnSEXP);
+    Rcpp::traits::input_parameter< const double >::type track_elbo_tol(track_elbo_tolSEXP);
+    Rcpp::traits::input_parameter< const uword >::type track_elbo_max(track_elbo_maxSEXP);
     Rcpp::traits::input_parameter< const double >::type thresh(threshSEXP);
     Rcpp::traits::input_parameter< const int >::type l(lSEXP);
     Rcpp::traits::input_parameter< unsigned int >::type niter(niterSEXP);
     Rcpp::traits::input_parameter< unsigned int >::type alg(algSEXP);
     Rcpp::traits::input_parameter< double >::type tol(tolSEXP);
+    Rcpp::traits::input_parameter< const uvec >::type convergence(convergenceSEXP);
+    Rcpp::traits::input_parameter< const uword >::type convergence_k(convergence_kSEXP);
     Rcpp::traits::input_parameter< bool >::type verbose(verboseSEXP);
     Rcpp::traits::input_parameter< const uword >::type ordering(orderingSEXP);
-    rcpp_result_gen = Rcpp::wrap(fit_logistic(y, X, groups, lambda, a0, b0, mu, s, g, diag_cov, track_elbo, track_elbo_every, track_elbo_mcn, thresh, l, niter, alg, tol, verbose, ordering));
+    Rcpp::traits::input_parameter< const double >::type compact(compactSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::List >::type control(controlSEXP);
+    rcpp_result_gen = Rcpp::wrap(fit_logistic(y, X, groups, lambda, a0, b0, mu, s, g, diag_cov, track_elbo, track_elbo_every, track_elbo_mcn, track_elbo_tol, track_elbo_max, thresh, l, niter, alg, tol, convergence, convergence_k, verbose, ordering, compact, control));
     return rcpp_result_gen;
 END_RCPP
 }
 // elbo_logistic
-double elbo_logistic(const vec& y, const mat& X, const uvec& groups, const vec& mu, const vec& s, const vec& g, const std::vector<mat>& Ss, const double lambda, const double w, const uword mcn, const bool diag);
-RcppExport SEXP _gsvb_elbo_logistic(SEXP ySEXP, SEXP XSEXP, SEXP groupsSEXP, SEXP muSEXP, SEXP sSEXP, SEXP gSEXP, SEXP SsSEXP, SEXP lambdaSEXP, SEXP wSEXP, SEXP mcnSEXP, SEXP diagSEXP) {
+vec elbo_logistic(const vec& y, const mat& X, const uvec& groups, const vec& mu, const vec& s, const vec& g, const std::vector<mat>& Ss, const double lambda, const double w, const uword mcn, const double mc_tol, const uword mc_max, const bool diag);
+RcppExport SEXP _gsvb_elbo_logistic(SEXP ySEXP, SEXP XSEXP, SEXP groupsSEXP, SEXP muSEXP, SEXP sSEXP, SEXP gSEXP, SEXP SsSEXP, SEXP lambdaSEXP, SEXP wSEXP, SEXP mcnSEXP, SEXP mc_tolSEXP, SEXP mc_maxSEXP, SEXP diagSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -146,14 +239,167 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const double >::type lambda(lambdaSEXP);
     Rcpp::traits::input_parameter< const double >::type w(wSEXP);
     Rcpp::traits::input_parameter< const uword >::type mcn(mcnSEXP);
+    Rcpp::traits::input_parameter< const double >::type mc_tol(mc_tolSEXP);
+    Rcpp::traits::input_parameter< const uword >::type mc_max(mc_maxSEXP);
     Rcpp::traits::input_parameter< const bool >::type diag(diagSEXP);
-    rcpp_result_gen = Rcpp::wrap(elbo_logistic(y, X, groups, mu, s, g, Ss, lambda, w, mcn, diag));
+    rcpp_result_gen = Rcpp::wrap(elbo_logistic(y, X, groups, mu, s, g, Ss, lambda, w, mcn, mc_tol, mc_max, diag));
+    return rcpp_result_gen;
+END_RCPP
+}
+// model_elbo
+vec model_elbo(SEXP model, const uword mcn, const double mc_tol, const uword mc_max, const bool approx, const double approx_thresh);
+RcppExport SEXP _gsvb_model_elbo(SEXP modelSEXP, SEXP mcnSEXP, SEXP mc_tolSEXP, SEXP mc_maxSEXP, SEXP approxSEXP, SEXP approx_threshSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< const uword >::type mcn(mcnSEXP);
+    Rcpp::traits::input_parameter< const double >::type mc_tol(mc_tolSEXP);
+    Rcpp::traits::input_parameter< const uword >::type mc_max(mc_maxSEXP);
+    Rcpp::traits::input_parameter< const bool >::type approx(approxSEXP);
+    Rcpp::traits::input_parameter< const double >::type approx_thresh(approx_threshSEXP);
+    rcpp_result_gen = Rcpp::wrap(model_elbo(model, mcn, mc_tol, mc_max, approx, approx_thresh));
+    return rcpp_result_gen;
+END_RCPP
+}
+// model_sample
+sp_mat model_sample(SEXP model, const uword samples, const unsigned int seed);
+RcppExport SEXP _gsvb_model_sample(SEXP modelSEXP, SEXP samplesSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< const uword >::type samples(samplesSEXP);
+    Rcpp::traits::input_parameter< const unsigned int >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(model_sample(model, samples, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// model_predict
+Rcpp::List model_predict(SEXP model, const mat& X, const uword samples, const vec& probs, const bool keep_samples, const uword type, const unsigned int seed);
+RcppExport SEXP _gsvb_model_predict(SEXP modelSEXP, SEXP XSEXP, SEXP samplesSEXP, SEXP probsSEXP, SEXP keep_samplesSEXP, SEXP typeSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< const mat& >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const uword >::type samples(samplesSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type probs(probsSEXP);
+    Rcpp::traits::input_parameter< const bool >::type keep_samples(keep_samplesSEXP);
+    Rcpp::traits::input_parameter< const uword >::type type(typeSEXP);
+    Rcpp::traits::input_parameter< const unsigned int >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(model_predict(model, X, samples, probs, keep_samples, type, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// model_free
+void model_free(SEXP model);
+RcppExport SEXP _gsvb_model_free(SEXP modelSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type model(modelSEXP);
+    model_free(model);
+    return R_NilValue;
+END_RCPP
+}
+// model_refit
+Rcpp::List model_refit(SEXP model, bool track_elbo, const uword track_elbo_every, const uword track_elbo_mcn, const double track_elbo_tol, const uword track_elbo_max, const double thresh, const int l, unsigned int niter, double tol, const uvec convergence, const uword convergence_k, bool verbose, const uword ordering);
+RcppExport SEXP _gsvb_model_refit(SEXP modelSEXP, SEXP track_elboSEXP, SEXP track_elbo_everySEXP, SEXP track_elbo_mcnSEXP, SEXP track_elbo_tolSEXP, SEXP track_elbo_maxSEXP, SEXP threshSEXP, SEXP lSEXP, SEXP niterSEXP, SEXP tolSEXP, SEXP convergenceSEXP, SEXP convergence_kSEXP, SEXP verboseSEXP, SEXP orderingSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< bool >::type track_elbo(track_elboSEXP);
+    Rcpp::traits::input_parameter< const uword >::type track_elbo_every(track_elbo_everySEXP);
+    Rcpp::traits::input_parameter< const uword >::type track_elbo_mcn(track_elbo_mcnSEXP);
+    Rcpp::traits::input_parameter< const double >::type track_elbo_tol(track_elbo_tolSEXP);
+    Rcpp::traits::input_parameter< const uword >::type track_elbo_max(track_elbo_maxSEXP);
+    Rcpp::traits::input_parameter< const double >::type thresh(threshSEXP);
+    Rcpp::traits::input_parameter< const int >::type l(lSEXP);
+    Rcpp::traits::input_parameter< unsigned int >::type niter(niterSEXP);
+    Rcpp::traits::input_parameter< double >::type tol(tolSEXP);
+    Rcpp::traits::input_parameter< const uvec >::type convergence(convergenceSEXP);
+    Rcpp::traits::input_parameter< const uword >::type convergence_k(convergence_kSEXP);
+    Rcpp::traits::input_parameter< bool >::type verbose(verboseSEXP);
+    Rcpp::traits::input_parameter< const uword >::type ordering(orderingSEXP);
+    rcpp_result_gen = Rcpp::wrap(model_refit(model, track_elbo, track_elbo_every, track_elbo_mcn, track_elbo_tol, track_elbo_max, thresh, l, niter, tol, convergence, convergence_k, verbose, ordering));
+    return rcpp_result_gen;
+END_RCPP
+}
+// block_create
+SEXP block_create(const mat& X, const vec& y, const uvec& groups, const double lambda, const double a0, const double b0, const vec& mu, const vec& s, const vec& g, const bool diag_cov);
+RcppExport SEXP _gsvb_block_create(SEXP XSEXP, SEXP ySEXP, SEXP groupsSEXP, SEXP lambdaSEXP, SEXP a0SEXP, SEXP b0SEXP, SEXP muSEXP, SEXP sSEXP, SEXP gSEXP, SEXP diag_covSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const mat& >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type y(ySEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type groups(groupsSEXP);
+    Rcpp::traits::input_parameter< const double >::type lambda(lambdaSEXP);
+    Rcpp::traits::input_parameter< const double >::type a0(a0SEXP);
+    Rcpp::traits::input_parameter< const double >::type b0(b0SEXP);
+    Rcpp::traits::input_parameter< const vec& >::type mu(muSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type s(sSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type g(gSEXP);
+    Rcpp::traits::input_parameter< const bool >::type diag_cov(diag_covSEXP);
+    rcpp_result_gen = Rcpp::wrap(block_create(X, y, groups, lambda, a0, b0, mu, s, g, diag_cov));
+    return rcpp_result_gen;
+END_RCPP
+}
+// block_contribution
+Rcpp::List block_contribution(SEXP block);
+RcppExport SEXP _gsvb_block_contribution(SEXP blockSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type block(blockSEXP);
+    rcpp_result_gen = Rcpp::wrap(block_contribution(block));
+    return rcpp_result_gen;
+END_RCPP
+}
+// block_sweep
+Rcpp::List block_sweep(SEXP block, const vec& fit, const double e_tau, const uword sweeps, const uword ordering);
+RcppExport SEXP _gsvb_block_sweep(SEXP blockSEXP, SEXP fitSEXP, SEXP e_tauSEXP, SEXP sweepsSEXP, SEXP orderingSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type block(blockSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type fit(fitSEXP);
+    Rcpp::traits::input_parameter< const double >::type e_tau(e_tauSEXP);
+    Rcpp::traits::input_parameter< const uword >::type sweeps(sweepsSEXP);
+    Rcpp::traits::input_parameter< const uword >::type ordering(orderingSEXP);
+    rcpp_result_gen = Rcpp::wrap(block_sweep(block, fit, e_tau, sweeps, ordering));
+    return rcpp_result_gen;
+END_RCPP
+}
+// block_state
+Rcpp::List block_state(SEXP block);
+RcppExport SEXP _gsvb_block_state(SEXP blockSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type block(blockSEXP);
+    rcpp_result_gen = Rcpp::wrap(block_state(block));
+    return rcpp_result_gen;
+END_RCPP
+}
+// linear_tau
+vec linear_tau(const double tau_a0, const double tau_b0, const double R, const double n);
+RcppExport SEXP _gsvb_linear_tau(SEXP tau_a0SEXP, SEXP tau_b0SEXP, SEXP RSEXP, SEXP nSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const double >::type tau_a0(tau_a0SEXP);
+    Rcpp::traits::input_parameter< const double >::type tau_b0(tau_b0SEXP);
+    Rcpp::traits::input_parameter< const double >::type R(RSEXP);
+    Rcpp::traits::input_parameter< const double >::type n(nSEXP);
+    rcpp_result_gen = Rcpp::wrap(linear_tau(tau_a0, tau_b0, R, n));
     return rcpp_result_gen;
 END_RCPP
 }
 // fit_poisson
-Rcpp::List fit_poisson(vec y, mat X, uvec groups, const double lambda, const double a0, const double b0, vec mu, vec s, vec g, const bool diag_cov, bool track_elbo, const uword track_elbo_every, const uword track_elbo_mcn, unsigned int niter, double tol, bool verbose);
-RcppExport SEXP _gsvb_fit_poisson(SEXP ySEXP, SEXP XSEXP, SEXP groupsSEXP, SEXP lambdaSEXP, SEXP a0SEXP, SEXP b0SEXP, SEXP muSEXP, SEXP sSEXP, SEXP gSEXP, SEXP diag_covSEXP, SEXP track_elboSEXP, SEXP track_elbo_everySEXP, SEXP track_elbo_mcnSEXP, SEXP niterSEXP, SEXP tolSEXP, SEXP verboseSEXP) {
+Rcpp::List fit_poisson(vec y, mat X, uvec groups, const double lambda, const double a0, const double b0, vec mu, vec s, vec g, const bool diag_cov, bool track_elbo, const uword track_elbo_every, const uword track_elbo_mcn, const double track_elbo_tol, const uword track_elbo_max, unsigned int niter, double tol, const uvec convergence, const uword convergence_k, bool verbose, const double compact, const Rcpp::List control);
+RcppExport SEXP _gsvb_fit_poisson(SEXP ySEXP, SEXP XSEXP, SEXP groupsSEXP, SEXP lambdaSEXP, SEXP a0SEXP, SEXP b0SEXP, SEXP muSEXP, SEXP sSEXP, SEXP gSEXP, SEXP diag_covSEXP, SEXP track_elboSEXP, SEXP track_elbo_everySEXP, SEXP track_elbo_mcnSEXP, SEXP track_elbo_tolSEXP, SEXP track_elbo_maxSEXP, SEXP niterSEXP, SEXP tolSEXP, SEXP convergenceSEXP, SEXP convergence_kSEXP, SEXP verboseSEXP, SEXP compactSEXP, SEXP controlSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -170,16 +416,22 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< bool >::type track_elbo(track_elboSEXP);
     Rcpp::traits::input_parameter< const uword >::type track_elbo_every(track_elbo_everySEXP);
     Rcpp::traits::input_parameter< const uword >::type track_elbo_mcn(track_elbo_mcnSEXP);
+    Rcpp::traits::input_parameter< const double >::type track_elbo_tol(track_elbo_tolSEXP);
+    Rcpp::traits::input_parameter< const uword >::type track_elbo_max(track_elbo_maxSEXP);
     Rcpp::traits::input_parameter< unsigned int >::type niter(niterSEXP);
     Rcpp::traits::input_parameter< double >::type tol(tolSEXP);
+    Rcpp::traits::input_parameter< const uvec >::type convergence(convergenceSEXP);
+    Rcpp::traits::input_parameter< const uword >::type convergence_k(convergence_kSEXP);
     Rcpp::traits::input_parameter< bool >::type verbose(verboseSEXP);
-    rcpp_result_gen = Rcpp::wrap(fit_poisson(y, X, groups, lambda, a0, b0, mu, s, g, diag_cov, track_elbo, track_elbo_every, track_elbo_mcn, niter, tol, verbose));
+    Rcpp::traits::input_parameter< const double >::type compact(compactSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::List >::type control(controlSEXP);
+    rcpp_result_gen = Rcpp::wrap(fit_poisson(y, X, groups, lambda, a0, b0, mu, s, g, diag_cov, track_elbo, track_elbo_every, track_elbo_mcn, track_elbo_tol, track_elbo_max, niter, tol, convergence, convergence_k, verbose, compact, control));
     return rcpp_result_gen;
 END_RCPP
 }
 // elbo_poisson
-double elbo_poisson(const vec& y, const mat& X, const uvec& groups, const vec& mu, const vec& s, const vec& g, const double lambda, const double w, const uword mcn);
-RcppExport SEXP _gsvb_elbo_poisson(SEXP ySEXP, SEXP XSEXP, SEXP groupsSEXP, SEXP muSEXP, SEXP sSEXP, SEXP gSEXP, SEXP lambdaSEXP, SEXP wSEXP, SEXP mcnSEXP) {
+vec elbo_poisson(const vec& y, const mat& X, const uvec& groups, const vec& mu, const vec& s, const vec& g, const double lambda, const double w, const uword mcn, const double mc_tol, const uword mc_max);
+RcppExport SEXP _gsvb_elbo_poisson(SEXP ySEXP, SEXP XSEXP, SEXP groupsSEXP, SEXP muSEXP, SEXP sSEXP, SEXP gSEXP, SEXP lambdaSEXP, SEXP wSEXP, SEXP mcnSEXP, SEXP mc_tolSEXP, SEXP mc_maxSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -192,7 +444,9 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const double >::type lambda(lambdaSEXP);
     Rcpp::traits::input_parameter< const double >::type w(wSEXP);
     Rcpp::traits::input_parameter< const uword >::type mcn(mcnSEXP);
-    rcpp_result_gen = Rcpp::wrap(elbo_poisson(y, X, groups, mu, s, g, lambda, w, mcn));
+    Rcpp::traits::input_parameter< const double >::type mc_tol(mc_tolSEXP);
+    Rcpp::traits::input_parameter< const uword >::type mc_max(mc_maxSEXP);
+    rcpp_result_gen = Rcpp::wrap(elbo_poisson(y, X, groups, mu, s, g, lambda, w, mcn, mc_tol, mc_max));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -246,8 +500,8 @@ BEGIN_RCPP
 END_RCPP
 }
 // elbo_poisson_S
-double elbo_poisson_S(const vec& y, const mat& X, const uvec& groups, const vec& mu, const std::vector<mat>& Ss, const vec& g, const double lambda, const double w, const uword mcn);
-RcppExport SEXP _gsvb_elbo_poisson_S(SEXP ySEXP, SEXP XSEXP, SEXP groupsSEXP, SEXP muSEXP, SEXP SsSEXP, SEXP gSEXP, SEXP lambdaSEXP, SEXP wSEXP, SEXP mcnSEXP) {
+vec elbo_poisson_S(const vec& y, const mat& X, const uvec& groups, const vec& mu, const std::vector<mat>& Ss, const vec& g, const double lambda, const double w, const uword mcn, const double mc_tol, const uword mc_max);
+RcppExport SEXP _gsvb_elbo_poisson_S(SEXP ySEXP, SEXP XSEXP, SEXP groupsSEXP, SEXP muSEXP, SEXP SsSEXP, SEXP gSEXP, SEXP lambdaSEXP, SEXP wSEXP, SEXP mcnSEXP, SEXP mc_tolSEXP, SEXP mc_maxSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -260,7 +514,117 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const double >::type lambda(lambdaSEXP);
     Rcpp::traits::input_parameter< const double >::type w(wSEXP);
     Rcpp::traits::input_parameter< const uword >::type mcn(mcnSEXP);
-    rcpp_result_gen = Rcpp::wrap(elbo_poisson_S(y, X, groups, mu, Ss, g, lambda, w, mcn));
+    Rcpp::traits::input_parameter< const double >::type mc_tol(mc_tolSEXP);
+    Rcpp::traits::input_parameter< const uword >::type mc_max(mc_maxSEXP);
+    rcpp_result_gen = Rcpp::wrap(elbo_poisson_S(y, X, groups, mu, Ss, g, lambda, w, mcn, mc_tol, mc_max));
+    return rcpp_result_gen;
+END_RCPP
+}
+// predict_stream
+Rcpp::List predict_stream(const mat& X, const vec& mu, const vec& s, const std::vector<mat>& Ss, const vec& g, const uvec& groups, const bool diag_cov, const uword family, const double tau_a, const double tau_b, const uword samples, const vec& probs, const bool keep_samples, const unsigned int seed);
+RcppExport SEXP _gsvb_predict_stream(SEXP XSEXP, SEXP muSEXP, SEXP sSEXP, SEXP SsSEXP, SEXP gSEXP, SEXP groupsSEXP, SEXP diag_covSEXP, SEXP familySEXP, SEXP tau_aSEXP, SEXP tau_bSEXP, SEXP samplesSEXP, SEXP probsSEXP, SEXP keep_samplesSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const mat& >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type mu(muSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type s(sSEXP);
+    Rcpp::traits::input_parameter< const std::vector<mat>& >::type Ss(SsSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type g(gSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type groups(groupsSEXP);
+    Rcpp::traits::input_parameter< const bool >::type diag_cov(diag_covSEXP);
+    Rcpp::traits::input_parameter< const uword >::type family(familySEXP);
+    Rcpp::traits::input_parameter< const double >::type tau_a(tau_aSEXP);
+    Rcpp::traits::input_parameter< const double >::type tau_b(tau_bSEXP);
+    Rcpp::traits::input_parameter< const uword >::type samples(samplesSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type probs(probsSEXP);
+    Rcpp::traits::input_parameter< const bool >::type keep_samples(keep_samplesSEXP);
+    Rcpp::traits::input_parameter< const unsigned int >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(predict_stream(X, mu, s, Ss, g, groups, diag_cov, family, tau_a, tau_b, samples, probs, keep_samples, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// predict_moments
+Rcpp::List predict_moments(const mat& X, const vec& mu, const vec& s, const std::vector<mat>& Ss, const vec& g, const uvec& groups, const bool diag_cov, const uword family, const double tau_a, const double tau_b);
+RcppExport SEXP _gsvb_predict_moments(SEXP XSEXP, SEXP muSEXP, SEXP sSEXP, SEXP SsSEXP, SEXP gSEXP, SEXP groupsSEXP, SEXP diag_covSEXP, SEXP familySEXP, SEXP tau_aSEXP, SEXP tau_bSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const mat& >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type mu(muSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type s(sSEXP);
+    Rcpp::traits::input_parameter< const std::vector<mat>& >::type Ss(SsSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type g(gSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type groups(groupsSEXP);
+    Rcpp::traits::input_parameter< const bool >::type diag_cov(diag_covSEXP);
+    Rcpp::traits::input_parameter< const uword >::type family(familySEXP);
+    Rcpp::traits::input_parameter< const double >::type tau_a(tau_aSEXP);
+    Rcpp::traits::input_parameter< const double >::type tau_b(tau_bSEXP);
+    rcpp_result_gen = Rcpp::wrap(predict_moments(X, mu, s, Ss, g, groups, diag_cov, family, tau_a, tau_b));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sample_beta
+sp_mat sample_beta(const vec& mu, const vec& s, const std::vector<mat>& Ss, const vec& g, const uvec& groups, const bool diag_cov, const uword samples, const unsigned int seed);
+RcppExport SEXP _gsvb_sample_beta(SEXP muSEXP, SEXP sSEXP, SEXP SsSEXP, SEXP gSEXP, SEXP groupsSEXP, SEXP diag_covSEXP, SEXP samplesSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const vec& >::type mu(muSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type s(sSEXP);
+    Rcpp::traits::input_parameter< const std::vector<mat>& >::type Ss(SsSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type g(gSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type groups(groupsSEXP);
+    Rcpp::traits::input_parameter< const bool >::type diag_cov(diag_covSEXP);
+    Rcpp::traits::input_parameter< const uword >::type samples(samplesSEXP);
+    Rcpp::traits::input_parameter< const unsigned int >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(sample_beta(mu, s, Ss, g, groups, diag_cov, samples, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// group_components
+Rcpp::List group_components(const mat& X, const uvec& groups, const uword k);
+RcppExport SEXP _gsvb_group_components(SEXP XSEXP, SEXP groupsSEXP, SEXP kSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const mat& >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type groups(groupsSEXP);
+    Rcpp::traits::input_parameter< const uword >::type k(kSEXP);
+    rcpp_result_gen = Rcpp::wrap(group_components(X, groups, k));
+    return rcpp_result_gen;
+END_RCPP
+}
+// group_score
+vec group_score(const mat& X, const uvec& groups, const uvec& which, const vec& r, const vec& w);
+RcppExport SEXP _gsvb_group_score(SEXP XSEXP, SEXP groupsSEXP, SEXP whichSEXP, SEXP rSEXP, SEXP wSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const mat& >::type X(XSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type groups(groupsSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type which(whichSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type r(rSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type w(wSEXP);
+    rcpp_result_gen = Rcpp::wrap(group_score(X, groups, which, r, w));
+    return rcpp_result_gen;
+END_RCPP
+}
+// posterior_summary
+Rcpp::List posterior_summary(const vec& mu, const vec& s, const std::vector<mat>& Ss, const vec& g, const uvec& groups, const bool diag_cov, const double prob, const double fdr);
+RcppExport SEXP _gsvb_posterior_summary(SEXP muSEXP, SEXP sSEXP, SEXP SsSEXP, SEXP gSEXP, SEXP groupsSEXP, SEXP diag_covSEXP, SEXP probSEXP, SEXP fdrSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const vec& >::type mu(muSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type s(sSEXP);
+    Rcpp::traits::input_parameter< const std::vector<mat>& >::type Ss(SsSEXP);
+    Rcpp::traits::input_parameter< const vec& >::type g(gSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type groups(groupsSEXP);
+    Rcpp::traits::input_parameter< const bool >::type diag_cov(diag_covSEXP);
+    Rcpp::traits::input_parameter< const double >::type prob(probSEXP);
+    Rcpp::traits::input_parameter< const double >::type fdr(fdrSEXP);
+    rcpp_result_gen = Rcpp::wrap(posterior_summary(mu, s, Ss, g, groups, diag_cov, prob, fdr));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -292,17 +656,38 @@ END_RCPP
 }
 
 static const R_CallMethodDef CallEntries[] = {
-    {"_gsvb_fit_linear", (DL_FUNC) &_gsvb_fit_linear, 19},
-    {"_gsvb_elbo_linear_c", (DL_FUNC) &_gsvb_elbo_linear_c, 19},
-    {"_gsvb_elbo_linear_u", (DL_FUNC) &_gsvb_elbo_linear_u, 19},
-    {"_gsvb_fit_logistic", (DL_FUNC) &_gsvb_fit_logistic, 20},
-    {"_gsvb_elbo_logistic", (DL_FUNC) &_gsvb_elbo_logistic, 11},
-    {"_gsvb_fit_poisson", (DL_FUNC) &_gsvb_fit_poisson, 16},
-    {"_gsvb_elbo_poisson", (DL_FUNC) &_gsvb_elbo_poisson, 9},
+    {"_gsvb_bench_kernels", (DL_FUNC) &_gsvb_bench_kernels, 7},
+    {"_gsvb_checkpoint_read", (DL_FUNC) &_gsvb_checkpoint_read, 1},
+    {"_gsvb_model_write", (DL_FUNC) &_gsvb_model_write, 12},
+    {"_gsvb_model_score", (DL_FUNC) &_gsvb_model_score, 2},
+    {"_gsvb_init_mu", (DL_FUNC) &_gsvb_init_mu, 5},
+    {"_gsvb_fit_linear", (DL_FUNC) &_gsvb_fit_linear, 25},
+    {"_gsvb_elbo_linear_c", (DL_FUNC) &_gsvb_elbo_linear_c, 21},
+    {"_gsvb_elbo_linear_u", (DL_FUNC) &_gsvb_elbo_linear_u, 21},
+    {"_gsvb_fit_logistic", (DL_FUNC) &_gsvb_fit_logistic, 26},
+    {"_gsvb_elbo_logistic", (DL_FUNC) &_gsvb_elbo_logistic, 13},
+    {"_gsvb_model_elbo", (DL_FUNC) &_gsvb_model_elbo, 6},
+    {"_gsvb_model_sample", (DL_FUNC) &_gsvb_model_sample, 3},
+    {"_gsvb_model_predict", (DL_FUNC) &_gsvb_model_predict, 7},
+    {"_gsvb_model_free", (DL_FUNC) &_gsvb_model_free, 1},
+    {"_gsvb_model_refit", (DL_FUNC) &_gsvb_model_refit, 14},
+    {"_gsvb_block_create", (DL_FUNC) &_gsvb_block_create, 10},
+    {"_gsvb_block_contribution", (DL_FUNC) &_gsvb_block_contribution, 1},
+    {"_gsvb_block_sweep", (DL_FUNC) &_gsvb_block_sweep, 5},
+    {"_gsvb_block_state", (DL_FUNC) &_gsvb_block_state, 1},
+    {"_gsvb_linear_tau", (DL_FUNC) &_gsvb_linear_tau, 4},
+    {"_gsvb_fit_poisson", (DL_FUNC) &_gsvb_fit_poisson, 22},
+    {"_gsvb_elbo_poisson", (DL_FUNC) &_gsvb_elbo_poisson, 11},
     {"_gsvb_pois_update_mu_S", (DL_FUNC) &_gsvb_pois_update_mu_S, 6},
     {"_gsvb_pois_update_U", (DL_FUNC) &_gsvb_pois_update_U, 5},
     {"_gsvb_pois_update_g_S", (DL_FUNC) &_gsvb_pois_update_g_S, 8},
-    {"_gsvb_elbo_poisson_S", (DL_FUNC) &_gsvb_elbo_poisson_S, 9},
+    {"_gsvb_elbo_poisson_S", (DL_FUNC) &_gsvb_elbo_poisson_S, 11},
+    {"_gsvb_predict_stream", (DL_FUNC) &_gsvb_predict_stream, 14},
+    {"_gsvb_predict_moments", (DL_FUNC) &_gsvb_predict_moments, 10},
+    {"_gsvb_sample_beta", (DL_FUNC) &_gsvb_sample_beta, 8},
+    {"_gsvb_group_components", (DL_FUNC) &_gsvb_group_components, 3},
+    {"_gsvb_group_score", (DL_FUNC) &_gsvb_group_score, 5},
+    {"_gsvb_posterior_summary", (DL_FUNC) &_gsvb_posterior_summary, 8},
     {"_gsvb_mvnMGF", (DL_FUNC) &_gsvb_mvnMGF, 3},
     {"_gsvb_mvnMGF_chol", (DL_FUNC) &_gsvb_mvnMGF_chol, 3},
     {NULL, NULL, 0}
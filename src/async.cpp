@@ -0,0 +1,202 @@
+#include "async.h"
+
+// maximum number of snapshots waiting to be evaluated, if the worker falls
+// behind the fitter waits rather than accumulating copies of the parameters
+#define GSVB_ASYNC_MAXQUEUE 4
+
+
+elbo_worker::elbo_worker(const uvec &groups, const double lambda, 
+	const uword mcn, const double tol, const uword max_n,
+	const uint64_t seed) :
+    lambda(lambda), mcn(mcn), tol(tol), max_n(max_n), rng(seed),
+    busy(0), stop(false), has_latest(false), latest_value(0.0),
+    held_bytes(0.0), peak_held_bytes(0.0)
+{
+    const uvec ugroups = arma::unique(groups);
+    for (uword group : ugroups)
+	Gs.push_back(arma::find(groups == group));
+
+    dirty.assign(Gs.size(), true);
+    est = vec(Gs.size(), arma::fill::zeros);
+    est_var = vec(Gs.size(), arma::fill::zeros);
+    Rs.resize(Gs.size());
+
+    worker = std::thread(&elbo_worker::run, this);
+}
+
+
+elbo_worker::~elbo_worker()
+{
+    {
+	std::lock_guard<std::mutex> lock(m);
+	stop = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+
+// the group of index gi has been updated, called by the fitter
+void elbo_worker::mark(const uword gi)
+{
+    dirty.at(gi) = true;
+}
+
+
+// copy the current parameters of the updated groups, only the covariance 
+// in use is copied
+void elbo_worker::submit(const double det, const vec &mu, const vec &s,
+	const std::vector<mat> &Ss, const vec &g)
+{
+    elbo_snapshot snap;
+    snap.det = det;
+    snap.diag = Ss.empty();
+    for (uword i = 0; i < Gs.size(); ++i) 
+    {
+	if (!dirty.at(i)) continue;
+	const uvec &G = Gs.at(i);
+
+	snap.groups.push_back(i);
+	snap.mu.push_back(vec(mu(G)));
+	if (snap.diag) snap.s.push_back(vec(s(G))); else snap.Ss.push_back(Ss.at(i));
+	snap.g.push_back(g(G(0)));
+	dirty.at(i) = false;
+    }
+
+    const double bytes = snapshot_bytes(snap);
+
+    std::unique_lock<std::mutex> lock(m);
+    cv.wait(lock, [this] { return queue.size() < GSVB_ASYNC_MAXQUEUE; });
+    queue.push_back(std::move(snap));
+    held_bytes += bytes;
+    peak_held_bytes = std::max(peak_held_bytes, held_bytes);
+    lock.unlock();
+    cv.notify_all();
+}
+
+
+// move the finished evaluations into values and se, returns the number of
+// evaluations moved
+uword elbo_worker::collect(std::vector<double> &values, std::vector<double> &se)
+{
+    std::lock_guard<std::mutex> lock(m);
+    const uword k = done_values.size();
+
+    values.insert(values.end(), done_values.begin(), done_values.end());
+    se.insert(se.end(), done_se.begin(), done_se.end());
+    done_values.clear();
+    done_se.clear();
+
+    return k;
+}
+
+
+// wait for all submitted snapshots to be evaluated and collect them
+void elbo_worker::finish(std::vector<double> &values, std::vector<double> &se)
+{
+    {
+	std::unique_lock<std::mutex> lock(m);
+	cv.wait(lock, [this] { return queue.empty() && busy == 0; });
+    }
+    collect(values, se);
+}
+
+
+// peak memory held by the snapshots, in bytes
+double elbo_worker::peak_bytes()
+{
+    std::lock_guard<std::mutex> lock(m);
+    return peak_held_bytes;
+}
+
+
+double elbo_worker::snapshot_bytes(const elbo_snapshot &snap)
+{
+    double n = 2.0 * snap.g.size();
+    for (const vec &m : snap.mu) n += m.n_elem;
+    for (const vec &s : snap.s) n += s.n_elem;
+    for (const mat &S : snap.Ss) n += S.n_elem;
+    return sizeof(double) * n;
+}
+
+
+// the most recently finished evaluation
+bool elbo_worker::latest(double &value)
+{
+    std::lock_guard<std::mutex> lock(m);
+    if (has_latest) value = latest_value;
+    return has_latest;
+}
+
+
+void elbo_worker::run()
+{
+    for (;;) 
+    {
+	elbo_snapshot snap;
+	{
+	    std::unique_lock<std::mutex> lock(m);
+	    cv.wait(lock, [this] { return stop || !queue.empty(); });
+	    if (stop) return;
+
+	    snap = std::move(queue.front());
+	    queue.pop_front();
+	    busy += 1;
+	}
+	cv.notify_all();
+
+	const vec e = evaluate(snap);
+
+	{
+	    std::lock_guard<std::mutex> lock(m);
+	    done_values.push_back(e(0));
+	    done_se.push_back(e(1));
+	    latest_value = e(0);
+	    has_latest = true;
+	    held_bytes -= snapshot_bytes(snap);
+	    busy -= 1;
+	}
+	cv.notify_all();
+    }
+}
+
+
+// re-estimates the groups in the snapshot, the estimates of the others are
+// kept from the previous snapshots
+vec elbo_worker::evaluate(const elbo_snapshot &snap)
+{
+    for (uword j = 0; j < snap.groups.size(); ++j)
+    {
+	const uword i = snap.groups.at(j);
+	const vec &mu = snap.mu.at(j);
+	const double g = snap.g.at(j);
+
+	est(i) = 0.0;
+	est_var(i) = 0.0;
+	if (g == 0.0) continue;
+
+	// square root of the group covariance, if the decomposition fails
+	// the marginal std. devs are used
+	mat &R = Rs.at(i);
+	if (snap.diag) {
+	    R = snap.s.at(j);
+	} else if (!arma::chol(R, snap.Ss.at(j), "lower")) {
+	    R = arma::diagmat(sqrt(abs(arma::diagvec(snap.Ss.at(j)))));
+	}
+
+	const vec mci = mc_integrate([&]() -> double {
+	    vec z = vec(mu.n_elem);
+	    for (uword k = 0; k < mu.n_elem; ++k) z(k) = rnorm(rng);
+
+	    return lambda * g * (snap.diag ?
+		norm(z % R + mu, 2) :
+		norm(R * z + mu, 2));
+	}, mcn, tol, max_n);
+
+	est(i) = mci(0);
+	est_var(i) = mci(1) * mci(1);
+    }
+
+    vec res = { snap.det - accu(est), sqrt(accu(est_var)) };
+    return res;
+}
@@ -0,0 +1,95 @@
+#ifndef GSVB_ASYNC_H
+#define GSVB_ASYNC_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <random>
+#include <cstdint>
+#include <utility>
+
+#include "gsvb_types.h"
+#include "utils.h"
+
+// Snapshot of the variational parameters of the groups updated since the
+// previous snapshot, used to evaluate the ELBO
+struct elbo_snapshot
+{
+    double det;			// terms of the ELBO available in closed form
+    bool diag;			// the covariance is diagonal
+    std::vector<uword> groups;	// indices of the updated groups
+    std::vector<vec> mu;
+    std::vector<vec> s;		// std. devs, used if the covariance is diagonal
+    std::vector<mat> Ss;	// group covariances, used otherwise
+    std::vector<double> g;	// inclusion probabilities
+};
+
+
+// Evaluates the Monte-Carlo part of the ELBO on a background thread.
+//
+// Snapshots are submitted after a sweep and the fitter continues with the
+// next sweep. If Ss is empty the covariance is taken to be diagonal. The 
+// worker estimates E_Q [ lambda * S_k g_k || b_{G_k} || ] group by group 
+// and the results are returned in the order the snapshots were submitted.
+//
+// The fitter marks each group as it is updated and a snapshot only copies
+// the marked groups. The worker keeps the estimate of each group and the
+// square root of its covariance between snapshots and only re-estimates 
+// the groups in the snapshot, each to the relative tolerance tol.
+//
+// Note: the worker does not call the R API, samples are drawn from a
+// std::mt19937_64 stream seeded with seed, drawn by the fitter from the
+// rng of its gsvb_model.
+class elbo_worker
+{
+    public:
+	elbo_worker(const uvec &groups, const double lambda, const uword mcn,
+		const double tol, const uword max_n, const uint64_t seed);
+	~elbo_worker();
+
+	void mark(const uword gi);
+	void submit(const double det, const vec &mu, const vec &s, 
+		const std::vector<mat> &Ss, const vec &g);
+	uword collect(std::vector<double> &values, std::vector<double> &se);
+	void finish(std::vector<double> &values, std::vector<double> &se);
+	bool latest(double &value);
+	double peak_bytes();
+
+    private:
+	void run();
+	vec evaluate(const elbo_snapshot &snap);
+	static double snapshot_bytes(const elbo_snapshot &snap);
+
+	std::vector<uvec> Gs;
+	std::vector<bool> dirty;	// groups updated since the last snapshot
+	const double lambda;
+	const uword mcn;
+	const double tol;
+	const uword max_n;
+
+	// only used by the worker: the estimate of each group, its variance
+	// and the square root of the group covariance
+	vec est;
+	vec est_var;
+	std::vector<mat> Rs;
+	std::mt19937_64 rng;
+	std::normal_distribution<double> rnorm;
+
+	std::mutex m;
+	std::condition_variable cv;
+	std::deque<elbo_snapshot> queue;
+	std::vector<double> done_values;
+	std::vector<double> done_se;
+	uword busy;
+	bool stop;
+	bool has_latest;
+	double latest_value;
+	double held_bytes;		// snapshots queued or being evaluated
+	double peak_held_bytes;
+
+	std::thread worker;
+};
+
+#endif
@@ -0,0 +1,320 @@
+#include "bench.h"
+
+// Microbenchmarks of the numerical kernels on synthetic data, see
+// inst/bench/kernels.R for the driver that sweeps n, p, m and the number
+// of threads and writes the results to a file.
+//
+// Each kernel is called once to warm up and then in batches of `reps`
+// calls until `min_time` seconds have passed. Throughput is reported as
+//
+//	rows_per_sec	observations processed per second
+//	gb_per_sec	bytes of the inputs read per second, counting each
+//			input once per call
+//	evals_per_sec	calls per second or, for the update_* kernels,
+//			evaluations of the objective per second
+//
+// The update_* kernels run L-BFGS on their objective. Their evaluations
+// are counted by the profiler, so the throughput of these kernels is NA
+// unless the package is compiled with -DGSVB_PROFILE, `seconds` is the
+// time per optimization.
+
+typedef std::chrono::steady_clock bench_clock;
+
+#ifdef _OPENMP
+// sets the number of OpenMP threads and restores the previous number when
+// it goes out of scope, including when an interrupt is raised
+struct bench_threads
+{
+    explicit bench_threads(const int threads) : prev(omp_get_max_threads()) {
+	omp_set_num_threads(threads);
+    }
+    ~bench_threads() { omp_set_num_threads(prev); }
+
+    const int prev;
+};
+#endif
+
+// keeps the result of each call live
+static volatile double bench_sink = 0.0;
+
+inline double bench_sum(const vec &x) { return accu(x); }
+inline double bench_sum(const double x) { return x; }
+
+struct bench_table
+{
+    std::vector<std::string> kernel;
+    std::vector<double> calls;
+    std::vector<double> seconds;
+    std::vector<double> rows_per_sec;
+    std::vector<double> gb_per_sec;
+    std::vector<double> evals_per_sec;
+};
+
+
+// Time f, `rows` and `bytes` are the observations and input bytes
+// processed per call, or per evaluation of the objective if `optimizer`.
+// Either is 0 if it does not apply.
+template <typename F>
+void bench_run(bench_table &tab, const std::vector<std::string> &kernels,
+	const std::string &name, F f, const double rows, const double bytes,
+	const uword reps, const double min_time, const bool optimizer=false)
+{
+    if (kernels.size() > 0 &&
+	std::find(kernels.begin(), kernels.end(), name) == kernels.end())
+	return;
+
+    bench_sink = bench_sink + bench_sum(f());
+
+#ifdef GSVB_PROFILE
+    fit_profiler prof;
+#endif
+
+    double calls = 0.0, elapsed = 0.0;
+    const bench_clock::time_point start = bench_clock::now();
+
+    do {
+	for (uword i = 0; i < reps; ++i)
+	    bench_sink = bench_sink + bench_sum(f());
+	calls += reps;
+	elapsed = std::chrono::duration<double>(
+	    bench_clock::now() - start).count();
+	Rcpp::checkUserInterrupt();
+    } while (elapsed < min_time);
+
+    double evals = optimizer ? NA_REAL : calls;
+
+#ifdef GSVB_PROFILE
+    if (optimizer) {
+	const Rcpp::List res = prof.result();
+	evals = Rcpp::sum(Rcpp::as<Rcpp::NumericVector>(res["evals"]));
+    }
+#endif
+
+    const double na = NA_REAL;
+
+    tab.kernel.push_back(name);
+    tab.calls.push_back(calls);
+    tab.seconds.push_back(elapsed / calls);
+    tab.rows_per_sec.push_back(rows > 0 ? rows * evals / elapsed : na);
+    tab.gb_per_sec.push_back(bytes > 0 ? 1e-9 * bytes * evals / elapsed : na);
+    tab.evals_per_sec.push_back(evals / elapsed);
+}
+
+
+// [[Rcpp::export]]
+Rcpp::DataFrame bench_kernels(const uword n, const uword p, const uword m,
+	const uword threads, const uword reps, const double min_time,
+	const Rcpp::CharacterVector kernels)
+{
+    if (m == 0 || p % m != 0)
+	Rcpp::stop("p must be a multiple of the group size");
+    if (n == 0 || reps == 0)
+	Rcpp::stop("n and reps must be positive");
+
+#ifdef _OPENMP
+    const bench_threads omp_threads(threads);
+#endif
+
+    const double d = sizeof(double);
+    const uword M = p / m;
+    const double lambda = 1.0, thresh = 0.02, e_tau = 1.0;
+    const int l = 5;
+
+    // synthetic data, drawn with R's RNG so set.seed applies
+    const mat X = arma::randn(n, p);
+    const mat XX = X % X;
+    uvec groups(p);
+    for (uword j = 0; j < p; ++j) groups(j) = j / m + 1;
+    const uvec ugroups = arma::regspace<uvec>(1, M);
+
+    const vec mu = 0.1 * arma::randn(p);
+    const vec s = 0.1 + 0.4 * arma::randu(p);
+
+    // a few large groups, five in (thresh, 1-thresh) enumerated by ell and
+    // the remaining groups close to 0
+    vec ug = 0.5 * thresh * arma::randu(M);
+    for (uword k = 0; k < M && k < 8; ++k) ug(k) = k < 3 ? 0.99 : 0.5;
+    vec g(p);
+    for (uword j = 0; j < p; ++j) g(j) = ug(groups(j) - 1);
+
+    std::vector<mat> Ss, Us;
+    for (uword k = 0; k < M; ++k) {
+	const mat A = arma::randn(m, m);
+	Ss.push_back(0.01 * (A.t() * A) / m + 0.01 * arma::eye(m, m));
+	Us.push_back(arma::chol(Ss.back()));
+    }
+
+    // the first group
+    const uvec G = arma::regspace<uvec>(0, m - 1);
+    const uvec Gc = arma::find(groups != groups(0));
+    const mat X_G = X.cols(G), XX_G = XX.cols(G);
+    const vec mu_G = mu(G), s_G = s(G);
+    const mat &S = Ss.at(0), &U = Us.at(0);
+
+    // responses and sufficient statistics
+    const vec eta = X * (g % mu);
+    vec y_bin(n), y_pois(n);
+    for (uword i = 0; i < n; ++i) {
+	y_bin(i) = R::rbinom(1, sigmoid(eta(i)));
+	y_pois(i) = R::rpois(exp(std::min(eta(i), 5.0)));
+    }
+    const vec y = eta + arma::randn(n);
+    const mat xtx = X.t() * X;
+    const vec yx = X.t() * y;
+
+    // the block of the first group and its cross terms, as maintained by
+    // the linear fitter, see gram.h
+    const vec gm = g % mu;
+    gram_dense gram(xtx, gm);
+    const mat xtx_GG = gram.block(G);
+    const vec yx_G = yx(G), gm_G = gm(G);
+    const vec cross = gram.cross(G, xtx_GG, gm_G);
+
+    const vec yX_bin = X.t() * (y_bin - 0.5);
+    const vec yX_pois = X.t() * y_pois;
+
+    const vec P = compute_P(X, XX, mu, s, g, groups) /
+	compute_P_G(X, XX, mu, s, g, G);
+    const mat XAX = X.t() * arma::diagmat(a(jaak_update_l(X, mu, s, g))) * X;
+
+    mat Xm(n, M), Xs(n, M);
+    for (uword k = 0; k < M; ++k) {
+	const uvec Gk = arma::find(groups == ugroups(k));
+	Xm.col(k) = X.cols(Gk) * mu(Gk);
+	Xs.col(k) = XX.cols(Gk) * (s(Gk) % s(Gk));
+    }
+    // linear predictor of the large groups, used by tll
+    const uword last = std::min<uword>(M, 3) - 1;
+    const vec eta_mu = sum(Xm.cols(0, last), 1);
+    const vec eta_sig = sqrt(sum(Xs.cols(0, last), 1));
+
+    // the nb_ updates refresh the column of their group in Xm and Xs
+    mat Xm_w = Xm, Xs_w = Xs;
+
+    const std::vector<std::string> names =
+	Rcpp::as<std::vector<std::string>>(kernels);
+
+    bench_table tab;
+    auto run = [&](const std::string &name, std::function<vec()> f,
+	    const double rows, const double bytes, const bool opt) -> void {
+	bench_run(tab, names, name, f, rows, bytes, reps, min_time, opt);
+    };
+    auto scalar = [](std::function<double()> f) -> std::function<vec()> {
+	return [f]() -> vec { vec r = { f() }; return r; };
+    };
+
+    // moment generating functions and the products P
+    run("mvnMGF", [&]() -> vec { return mvnMGF(X_G, XX_G, mu_G, s_G); },
+	n, d * 2 * n * m, false);
+    run("mvnMGF_S", [&]() -> vec { return mvnMGF(X_G, mu_G, S); },
+	n, d * (n * m + m * m), false);
+    run("mvnMGF_chol", [&]() -> vec { return mvnMGF_chol(X_G, mu_G, U); },
+	n, d * (n * m + m * m), false);
+    run("compute_P", [&]() -> vec {
+	return compute_P(X, XX, mu, s, g, groups); },
+	n, d * 2 * n * p, false);
+    run("compute_P_S", [&]() -> vec {
+	return compute_P(X, mu, Ss, g, groups); },
+	n, d * (n * p + M * m * m), false);
+
+    // the per group terms of the linear model: the cross terms and the
+    // refresh of xtx (g o mu) by gram_dense, and the within group terms of
+    // the expected residuals. gram_update adds a zero change so that the
+    // state stays put across repetitions
+    const vec d_G = arma::zeros(m);
+    run("gram_cross", [&]() -> vec {
+	return gram.cross(G, xtx_GG, gm_G); },
+	0, d * m * m, false);
+    run("gram_update", [&]() -> vec {
+	gram.update(G, d_G); vec r = { gram.quad(gm) }; return r; },
+	0, d * (p * m + 2 * p), false);
+    run("compute_r_k", scalar([&]() -> double {
+	return compute_r_k(xtx_GG, mu_G, s_G, g(0)); }),
+	0, d * m * m, false);
+    run("compute_r_k_S", scalar([&]() -> double {
+	return compute_r_k(xtx_GG, mu_G, S, g(0)); }),
+	0, d * 2 * m * m, false);
+
+    // refined binomial bound
+    run("tll", scalar([&]() -> double {
+	return tll(eta_mu, eta_sig, l); }),
+	n, d * 2 * n, false);
+    run("dt_dm", [&]() -> vec {
+	return dt_dm(X, eta_mu, eta_sig, G, l); },
+	n, d * (n * m + 2 * n), false);
+    run("dt_ds", [&]() -> vec {
+	return dt_ds(X, s, eta_mu, eta_sig, G, l); },
+	n, d * (n * m + 2 * n), false);
+    run("ell", scalar([&]() -> double {
+	return ell(Xm, Xs, ug, thresh, l); }),
+	n, d * 2 * n * std::min<uword>(M, 8), false);
+
+    // Jaakkola's bound
+    run("jaak_update_l", [&]() -> vec {
+	return jaak_update_l(X, mu, s, g); },
+	n, d * n * p, false);
+    run("jaak_update_l_S", [&]() -> vec {
+	return jaak_update_l(X, mu, Ss, g, groups, ugroups); },
+	n, d * (n * p + M * m * m), false);
+
+    // the update_*_fn objectives, optimized for the first group with the
+    // block signatures run by the linear fitter
+    run("update_mu", [&]() -> vec {
+	return update_mu(xtx_GG, cross, yx_G, mu_G, s_G, e_tau, lambda); },
+	0, d * m * m, true);
+    run("update_s", [&]() -> vec {
+	return update_s(xtx_GG, mu_G, s_G, e_tau, lambda); },
+	0, d * m * m, true);
+    run("update_S", scalar([&]() -> double {
+	mat S_w = S;
+	return update_S(xtx_GG, mu_G, S_w, 1.0, e_tau, lambda,
+	    group_spectrum()); }),
+	0, d * m * m, true);
+    run("jen_update_mu", [&]() -> vec {
+	return jen_update_mu(yX_bin(G), X_G, XX_G, mu_G, s_G, lambda, P); },
+	n, d * 2 * n * m, true);
+    run("jen_update_s", [&]() -> vec {
+	return jen_update_s(X_G, XX_G, mu_G, s_G, lambda, P); },
+	n, d * 2 * n * m, true);
+    run("jaak_update_mu", [&]() -> vec {
+	return jaak_update_mu(y_bin, X, XAX, mu, s_G, g, lambda, G, Gc); },
+	0, d * p * m, true);
+    run("jaak_update_s", [&]() -> vec {
+	return jaak_update_s(XAX, mu, s, lambda, G); },
+	0, d * m * m, true);
+    run("nb_update_m", [&]() -> vec {
+	return nb_update_m(y_bin, X, mu, s, ug, lambda, 0, G, Xm_w, Xs,
+	    thresh, l); },
+	n, d * (n * m + 2 * n * M), true);
+    run("nb_update_s", [&]() -> vec {
+	return nb_update_s(y_bin, X, mu, s, ug, lambda, 0, G, Xm, Xs_w,
+	    thresh, l); },
+	n, d * (n * m + 2 * n * M), true);
+    run("pois_update_mu", [&]() -> vec {
+	return pois_update_mu(yX_pois, X, XX, mu, s, lambda, G, P); },
+	n, d * 2 * n * m, true);
+    run("pois_update_s", [&]() -> vec {
+	return pois_update_s(X, XX, mu, s, lambda, G, P); },
+	n, d * 2 * n * m, true);
+    run("pois_update_mu_S", [&]() -> vec {
+	return pois_update_mu_S(yX_pois(G), X_G, mu_G, U, lambda, P); },
+	n, d * n * m, true);
+    run("pois_update_U", [&]() -> vec {
+	return pois_update_U(X_G, mu_G, U, lambda, P); },
+	n, d * n * m, true);
+
+    const uword k = tab.kernel.size();
+    return Rcpp::DataFrame::create(
+	Rcpp::Named("kernel") = tab.kernel,
+	Rcpp::Named("n") = std::vector<double>(k, n),
+	Rcpp::Named("p") = std::vector<double>(k, p),
+	Rcpp::Named("m") = std::vector<double>(k, m),
+	Rcpp::Named("threads") = std::vector<double>(k, threads),
+	Rcpp::Named("calls") = tab.calls,
+	Rcpp::Named("seconds") = tab.seconds,
+	Rcpp::Named("rows_per_sec") = tab.rows_per_sec,
+	Rcpp::Named("gb_per_sec") = tab.gb_per_sec,
+	Rcpp::Named("evals_per_sec") = tab.evals_per_sec,
+	Rcpp::Named("stringsAsFactors") = false
+    );
+}
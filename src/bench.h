@@ -0,0 +1,24 @@
+#ifndef GSVB_BENCH_H
+#define GSVB_BENCH_H
+
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "gsvb_types.h"
+#include "utils.h"
+#include "linear.h"
+#include "logistic.h"
+#include "poisson.h"
+
+Rcpp::DataFrame bench_kernels(const uword n, const uword p, const uword m,
+	const uword threads, const uword reps, const double min_time,
+	const Rcpp::CharacterVector kernels);
+
+#endif
@@ -0,0 +1,173 @@
+#include "checkpoint.h"
+
+static const char checkpoint_magic[8] = { 'G', 'S', 'V', 'B', 'C', 'K', 'P', 0 };
+
+
+static void put(std::ostream &out, const uint64_t x)
+{
+    out.write(reinterpret_cast<const char *>(&x), sizeof(x));
+}
+
+
+static void put(std::ostream &out, const double x)
+{
+    out.write(reinterpret_cast<const char *>(&x), sizeof(x));
+}
+
+
+static void put(std::ostream &out, const double *x, const uword n)
+{
+    put(out, static_cast<uint64_t>(n));
+    if (n > 0)
+	out.write(reinterpret_cast<const char *>(x), n * sizeof(double));
+}
+
+
+static uint64_t get_u64(std::istream &in)
+{
+    uint64_t x = 0;
+    if (!in.read(reinterpret_cast<char *>(&x), sizeof(x)))
+	Rcpp::stop("checkpoint is truncated");
+    return x;
+}
+
+
+static double get_double(std::istream &in)
+{
+    double x = 0.0;
+    if (!in.read(reinterpret_cast<char *>(&x), sizeof(x)))
+	Rcpp::stop("checkpoint is truncated");
+    return x;
+}
+
+
+static std::vector<double> get_doubles(std::istream &in)
+{
+    const uint64_t n = get_u64(in);
+    std::vector<double> x(n);
+    if (n > 0 && !in.read(reinterpret_cast<char *>(x.data()),
+		n * sizeof(double)))
+	Rcpp::stop("checkpoint is truncated");
+    return x;
+}
+
+
+static vec get_vec(std::istream &in)
+{
+    const std::vector<double> x = get_doubles(in);
+    return vec(x);
+}
+
+
+// written to path.tmp and renamed, so the previous checkpoint is kept
+// until the new one is complete
+void checkpoint_write(const std::string &path, const fit_checkpoint &c)
+{
+    const std::string tmp = path + ".tmp";
+    {
+	std::ofstream out(tmp.c_str(), std::ios::binary | std::ios::trunc);
+	if (!out)
+	    Rcpp::stop("cannot write checkpoint to " + path);
+
+	out.write(checkpoint_magic, sizeof(checkpoint_magic));
+	put(out, static_cast<uint64_t>(GSVB_CHECKPOINT_VERSION));
+	put(out, static_cast<uint64_t>(c.family));
+	put(out, static_cast<uint64_t>(c.stage));
+	put(out, static_cast<uint64_t>(c.iter));
+	put(out, c.tau_a);
+	put(out, c.tau_b);
+
+	put(out, c.mu.memptr(), c.mu.n_elem);
+	put(out, c.s.memptr(), c.s.n_elem);
+	put(out, c.g.memptr(), c.g.n_elem);
+	put(out, c.v.memptr(), c.v.n_elem);
+
+	put(out, static_cast<uint64_t>(c.Ss.size()));
+	for (const mat &S : c.Ss) {
+	    put(out, static_cast<uint64_t>(S.n_rows));
+	    put(out, S.memptr(), S.n_elem);
+	}
+
+	put(out, c.elbo.data(), c.elbo.size());
+	put(out, c.elbo_se.data(), c.elbo_se.size());
+
+	const std::vector<double> rng(c.rng.begin(), c.rng.end());
+	put(out, rng.data(), rng.size());
+
+	if (!out)
+	    Rcpp::stop("cannot write checkpoint to " + path);
+    }
+
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+	std::remove(path.c_str());
+	if (std::rename(tmp.c_str(), path.c_str()) != 0)
+	    Rcpp::stop("cannot write checkpoint to " + path);
+    }
+}
+
+
+fit_checkpoint checkpoint_load(const std::string &path)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in)
+	Rcpp::stop("cannot open checkpoint " + path);
+
+    char magic[sizeof(checkpoint_magic)];
+    if (!in.read(magic, sizeof(magic)) ||
+	    !std::equal(magic, magic + sizeof(magic), checkpoint_magic))
+	Rcpp::stop(path + " is not a gsvb checkpoint");
+    if (get_u64(in) != GSVB_CHECKPOINT_VERSION)
+	Rcpp::stop("unsupported checkpoint version");
+
+    fit_checkpoint c;
+    c.family = get_u64(in);
+    c.stage = get_u64(in);
+    c.iter = get_u64(in);
+    c.tau_a = get_double(in);
+    c.tau_b = get_double(in);
+
+    c.mu = get_vec(in);
+    c.s = get_vec(in);
+    c.g = get_vec(in);
+    c.v = get_vec(in);
+
+    const uint64_t k = get_u64(in);
+    for (uint64_t i = 0; i < k; ++i) {
+	const uword m = get_u64(in);
+	const vec x = get_vec(in);
+	if (x.n_elem != m * m)
+	    Rcpp::stop("checkpoint is corrupt");
+	c.Ss.push_back(mat(x.memptr(), m, m));
+    }
+
+    c.elbo = get_doubles(in);
+    c.elbo_se = get_doubles(in);
+
+    const std::vector<double> rng = get_doubles(in);
+    c.rng.assign(rng.begin(), rng.end());
+
+    return c;
+}
+
+
+// [[Rcpp::export]]
+Rcpp::List checkpoint_read(const std::string &path)
+{
+    const fit_checkpoint c = checkpoint_load(path);
+
+    return Rcpp::List::create(
+	Rcpp::Named("family") = c.family,
+	Rcpp::Named("stage") = c.stage,
+	Rcpp::Named("iter") = c.iter,
+	Rcpp::Named("mu") = c.mu,
+	Rcpp::Named("s") = c.s,
+	Rcpp::Named("g") = c.g,
+	Rcpp::Named("S") = c.Ss,
+	Rcpp::Named("v") = c.v,
+	Rcpp::Named("tau_a") = c.tau_a,
+	Rcpp::Named("tau_b") = c.tau_b,
+	Rcpp::Named("elbo") = c.elbo,
+	Rcpp::Named("elbo_se") = c.elbo_se,
+	Rcpp::Named("rng") = c.rng
+    );
+}
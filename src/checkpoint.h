@@ -0,0 +1,49 @@
+#ifndef GSVB_CHECKPOINT_H
+#define GSVB_CHECKPOINT_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+
+#include "gsvb_types.h"
+
+// Checkpoints of the state of a fit, written by the fitters every
+// checkpoint_every iterations and before an interrupt is raised, so a
+// long fit can be resumed, see resume in gsvb.fit.
+//
+// The file stores the variational parameters at the end of an iteration,
+// the ELBO trace so far and the state of R's RNG. The cached terms of the
+// bounds, i.e. P, Xm, Xs, XAX and the Cholesky factors Us, are functions
+// of these and are recomputed when the fit is resumed. Files use the
+// native byte order and are replaced atomically, so a fit that is killed
+// while writing leaves the previous checkpoint intact.
+
+#define GSVB_CHECKPOINT_VERSION 1
+
+struct fit_checkpoint
+{
+    uword family;		// family code of gsvb.fit
+    uword stage;		// 1, or 2 for the refined stage of family 4
+    uword iter;			// iterations completed
+    vec mu;
+    vec s;
+    vec g;
+    std::vector<mat> Ss;	// group covariances, if not diag_cov
+    vec v;			// per group scale of the linear model
+    double tau_a;
+    double tau_b;
+    std::vector<double> elbo;
+    std::vector<double> elbo_se;
+    std::vector<int> rng;	// .Random.seed
+};
+
+void checkpoint_write(const std::string &path, const fit_checkpoint &c);
+
+fit_checkpoint checkpoint_load(const std::string &path);
+
+Rcpp::List checkpoint_read(const std::string &path);
+
+#endif
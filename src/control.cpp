@@ -0,0 +1,116 @@
+#include "control.h"
+
+
+fit_control::fit_control(const Rcpp::List &control) :
+    start(0), tau_a(NAN), tau_b(NAN), gram(GSVB_GRAM_DENSE), model(false),
+    family(0), every(0), stage(1), budget(INFINITY), begin(clock::now()), 
+    callback_every(1)
+{
+    auto has = [&](const char *name) -> bool {
+	return control.containsElementNamed(name) &&
+	    !Rf_isNull(control[name]);
+    };
+
+    if (has("checkpoint"))
+	path = Rcpp::as<std::string>(control["checkpoint"]);
+    if (has("checkpoint_every"))
+	every = Rcpp::as<uword>(control["checkpoint_every"]);
+    if (has("family"))
+	family = Rcpp::as<uword>(control["family"]);
+    if (has("stage"))
+	stage = Rcpp::as<uword>(control["stage"]);
+
+    if (has("iter"))
+	start = Rcpp::as<uword>(control["iter"]);
+    if (has("S"))
+	Ss = Rcpp::as< std::vector<mat> >(control["S"]);
+    if (has("v"))
+	v = Rcpp::as<vec>(control["v"]);
+    if (has("tau_a"))
+	tau_a = Rcpp::as<double>(control["tau_a"]);
+    if (has("tau_b"))
+	tau_b = Rcpp::as<double>(control["tau_b"]);
+    if (has("elbo"))
+	elbo = Rcpp::as< std::vector<double> >(control["elbo"]);
+    if (has("elbo_se"))
+	elbo_se = Rcpp::as< std::vector<double> >(control["elbo_se"]);
+
+    if (has("time_budget"))
+	budget = Rcpp::as<double>(control["time_budget"]);
+    if (has("progress")) {
+	callback = control["progress"];
+	if (!Rf_isFunction(callback) && TYPEOF(callback) != EXTPTRSXP)
+	    Rcpp::stop("progress must be a function or an external pointer");
+    }
+    if (has("spectral")) {
+	const Rcpp::List o = control["spectral"];
+	spectral.min_size = Rcpp::as<uword>(o["min_size"]);
+    }
+    if (has("gram"))
+	gram = Rcpp::as<uword>(control["gram"]);
+    if (has("model"))
+	model = Rcpp::as<bool>(control["model"]);
+    if (has("progress_every"))
+	callback_every = std::max<uword>(1, 
+		Rcpp::as<uword>(control["progress_every"]));
+}
+
+
+void fit_control::write(fit_checkpoint c, const uword iter) const
+{
+    c.family = family;
+    c.stage = stage;
+    c.iter = iter;
+
+    // the state of R's RNG, e.g. of the random ordering of the groups
+    PutRNGstate();
+    Rcpp::Environment env = Rcpp::Environment::global_env();
+    if (env.exists(".Random.seed"))
+	c.rng = Rcpp::as< std::vector<int> >(env[".Random.seed"]);
+
+    checkpoint_write(path, c);
+}
+
+
+double fit_control::elapsed() const
+{
+    return std::chrono::duration<double>(clock::now() - begin).count();
+}
+
+
+// calls the R function with a list of the fields of info, or the compiled
+// callback, returns true if the fit should stop
+bool fit_control::report(fit_progress info) const
+{
+    info.stage = stage;
+    info.elapsed = elapsed();
+
+    if (TYPEOF(callback) == EXTPTRSXP) {
+	Rcpp::XPtr<fit_progress_callback> cb(callback);
+	return cb->fn(info, cb->data);
+    }
+
+    Rcpp::Function f(callback);
+    Rcpp::RObject res = f(Rcpp::List::create(
+	Rcpp::Named("stage") = info.stage,
+	Rcpp::Named("iter") = info.iter,
+	Rcpp::Named("elbo") = info.elbo,
+	Rcpp::Named("active") = info.active,
+	Rcpp::Named("elapsed") = info.elapsed
+    ));
+
+    // only an explicit TRUE stops the fit
+    return Rf_isLogical(res) && Rf_length(res) == 1 && 
+	LOGICAL(res)[0] == TRUE;
+}
+
+
+uword count_active(const vec &g, const uvec &groups)
+{
+    uword active = 0;
+    for (uword j = 0; j < g.n_elem; ++j) {
+	if (j > 0 && groups(j) == groups(j - 1)) continue;
+	if (g(j) >= 0.5) ++active;
+    }
+    return active;
+}
@@ -0,0 +1,143 @@
+#ifndef GSVB_CONTROL_H
+#define GSVB_CONTROL_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+
+#include "gsvb_types.h"
+#include "checkpoint.h"
+#include "spectrum.h"
+
+// Options of the main loop of the fitters, passed from R as a list. Every
+// element is optional, an empty list runs the fit from the initial values
+// without checkpoints, time limit or progress reports:
+//   checkpoint, checkpoint_every	path and period of the checkpoints
+//   family, stage			recorded in the checkpoints
+//   iter, S, v, tau_a, tau_b,		state of a resumed fit, see
+//   elbo, elbo_se			fit_checkpoint
+//   time_budget			seconds the main loop may run for
+//   progress, progress_every		callback and its period in sweeps
+//   spectral				list of min_size, see 
+//					spectral_options
+//   gram				representation of X'X in the linear
+//					fit, GSVB_GRAM_DENSE or GSVB_GRAM_SVD
+//   model				return the gsvb_model of the fit as
+//					the element model of the result
+
+// reasons a fit stops before it converges or reaches niter, returned by
+// the fitters as stopped_by
+#define GSVB_STOP_TIME 1
+#define GSVB_STOP_CALLBACK 2
+
+// representations of the Gram matrix of the linear fit, see gram.h
+#define GSVB_GRAM_DENSE 1
+#define GSVB_GRAM_SVD 2
+
+// Passed to the progress callbacks. elbo is the most recent estimate of
+// the ELBO, NA if it is not tracked or not yet evaluated, and active the
+// number of groups with an inclusion probability of at least 0.5.
+struct fit_progress
+{
+    uword stage;
+    uword iter;
+    double elbo;
+    uword active;
+    double elapsed;		// seconds since the start of the main loop
+};
+
+// A callback in compiled code, passed as an external pointer to a
+// fit_progress_callback. Returns true to stop the fit.
+typedef bool (*fit_progress_fn)(const fit_progress &info, void *data);
+
+struct fit_progress_callback
+{
+    fit_progress_fn fn;
+    void *data;
+};
+
+class fit_control
+{
+    public:
+	explicit fit_control(const Rcpp::List &control);
+
+	bool checkpointing() const { return !path.empty(); }
+
+	// Called at the end of each sweep. Reports the progress if a report
+	// is due, writes a checkpoint if one is due or the fit is stopped,
+	// and checks for an interrupt, writing a checkpoint before it is
+	// raised. `state` returns the state of the fit and `progress` the
+	// elbo and active fields of the report. Returns GSVB_STOP_TIME or
+	// GSVB_STOP_CALLBACK if the fit should stop, 0 otherwise.
+	template <typename F, typename G>
+	uword end_sweep(const uword iter, F state, G progress);
+
+	// state of a resumed fit, the fit continues from iteration start + 1
+	uword start;
+	std::vector<mat> Ss;
+	vec v;
+	double tau_a;		// NaN if not resumed
+	double tau_b;
+	std::vector<double> elbo;
+	std::vector<double> elbo_se;
+
+	// spectra of the Gram blocks of large groups
+	spectral_options spectral;
+
+	uword gram;
+	bool model;
+
+	// family of the fit, 0 if not given
+	uword family;
+
+    private:
+	typedef std::chrono::steady_clock clock;
+
+	void write(fit_checkpoint c, const uword iter) const;
+	bool report(fit_progress info) const;
+	double elapsed() const;
+
+	std::string path;
+	uword every;
+	uword stage;
+
+	double budget;		// Inf if not limited
+	clock::time_point begin;
+	Rcpp::RObject callback;
+	uword callback_every;
+};
+
+
+// number of groups with g >= 0.5, groups are ordered
+uword count_active(const vec &g, const uvec &groups);
+
+
+template <typename F, typename G>
+uword fit_control::end_sweep(const uword iter, F state, G progress)
+{
+    uword stop = 0;
+
+    if (!callback.isNULL() && iter % callback_every == 0) {
+	fit_progress info = progress();
+	info.iter = iter;
+	if (report(info)) stop = GSVB_STOP_CALLBACK;
+    }
+    if (!stop && elapsed() >= budget) 
+	stop = GSVB_STOP_TIME;
+
+    const bool due = checkpointing() && 
+	(stop || (every > 0 && iter % every == 0));
+    if (due) write(state(), iter);
+
+    try {
+	Rcpp::checkUserInterrupt();
+    } catch (Rcpp::internal::InterruptedException &) {
+	if (checkpointing() && !due) write(state(), iter);
+	throw;
+    }
+
+    return stop;
+}
+
+#endif
@@ -0,0 +1,74 @@
+#include "convergence.h"
+
+
+convergence_monitor::convergence_monitor(const uvec &criteria, 
+	const double tol, const uword k) :
+    criteria(criteria), tol(tol), k(k), 
+    has_elbo(false), elbo_old(0.0), stable_iters(0)
+{
+}
+
+
+bool convergence_monitor::needs_elbo() const
+{
+    return any(criteria == GSVB_CONV_ELBO);
+}
+
+
+uword convergence_monitor::check(const vec &mu_old, const vec &mu, 
+	const vec &s_old, const vec &s, const vec &g_old, const vec &g, 
+	const double elbo)
+{
+    // state is updated every iteration regardless of which test fires
+    const bool crossed = any((g_old > GSVB_CONV_GAMMA_THRESH) != 
+	    (g > GSVB_CONV_GAMMA_THRESH));
+    stable_iters = crossed ? 0 : stable_iters + 1;
+
+    const bool elbo_conv = has_elbo && 
+	std::abs(elbo - elbo_old) < tol * std::abs(elbo_old);
+    has_elbo = true;
+    elbo_old = elbo;
+
+    for (uword criterion : criteria) 
+    {
+	switch (criterion) {
+	    case GSVB_CONV_ELBO:
+		if (elbo_conv) return criterion;
+		break;
+	    case GSVB_CONV_GAMMA:
+		if (stable_iters >= k) return criterion;
+		break;
+	    default:
+		if (blocks_converged(criterion, mu_old, mu, s_old, s, g_old, g))
+		    return criterion;
+	}
+    }
+
+    return 0;
+}
+
+
+// the change of a block of parameters
+static double block_change(const uword criterion, const vec &old, 
+	const vec &cur)
+{
+    const vec d = abs(old - cur);
+
+    if (criterion == GSVB_CONV_MAX)
+	return d.n_elem ? d.max() : 0.0;
+
+    if (criterion == GSVB_CONV_RELATIVE)
+	return accu(d) / (d.n_elem + accu(abs(old)));
+
+    return accu(d);
+}
+
+
+bool convergence_monitor::blocks_converged(const uword criterion, 
+	const vec &mu_old, const vec &mu, const vec &s_old, const vec &s, 
+	const vec &g_old, const vec &g) const
+{
+    return block_change(criterion, mu_old, mu) < tol &&
+	block_change(criterion, s_old, s) < tol &&
+	block_change(criterion, g_old, g) < tol;
+}
@@ -0,0 +1,48 @@
+#ifndef GSVB_CONVERGENCE_H
+#define GSVB_CONVERGENCE_H
+
+#include "gsvb_types.h"
+
+// convergence criteria, codes match the order of the criteria in gsvb.fit
+#define GSVB_CONV_L1 1		// sum |theta_old - theta| < tol
+#define GSVB_CONV_RELATIVE 2	// sum |theta_old - theta| / (d + sum |theta_old|)
+#define GSVB_CONV_MAX 3		// max |theta_old - theta| < tol
+#define GSVB_CONV_ELBO 4	// relative improvement of the ELBO < tol
+#define GSVB_CONV_GAMMA 5	// no group crossed g = 0.5 in k iterations
+
+#define GSVB_CONV_GAMMA_THRESH 0.5
+
+
+// Checks the selected convergence criteria after each iteration. The 
+// parameter blocks are tested separately, i.e. the change of mu, s and g 
+// must each be below tol. For GSVB_CONV_ELBO the fitter supplies a 
+// deterministic lower bound of the ELBO, see needs_elbo().
+//
+// check() returns the code of the first criterion that is satisfied, or 0
+class convergence_monitor
+{
+    public:
+	convergence_monitor(const uvec &criteria, const double tol, 
+		const uword k);
+
+	bool needs_elbo() const;
+
+	uword check(const vec &mu_old, const vec &mu, const vec &s_old, 
+		const vec &s, const vec &g_old, const vec &g, 
+		const double elbo = 0.0);
+
+    private:
+	bool blocks_converged(const uword criterion, const vec &mu_old, 
+		const vec &mu, const vec &s_old, const vec &s, const vec &g_old, 
+		const vec &g) const;
+
+	const uvec criteria;
+	const double tol;
+	const uword k;
+
+	bool has_elbo;
+	double elbo_old;
+	uword stable_iters;
+};
+
+#endif
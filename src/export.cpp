@@ -0,0 +1,120 @@
+#include "export.h"
+
+
+// Write the groups with inclusion probability >= min_g to a binary model
+// file, see inst/include/gsvb_scorer.h for the layout. Full covariances 
+// are stored as their lower Cholesky factor, falling back to the diagonal
+// if S is not numerically positive definite.
+//
+// Returns the mass of the inclusion probabilities that was dropped.
+//
+// [[Rcpp::export]]
+double model_write(const std::string &path, const vec &mu, const vec &s,
+	const std::vector<mat> &Ss, const vec &g, const uvec &groups, 
+	const bool diag_cov, const uword family, const double tau_a, 
+	const double tau_b, const bool intercept, const double min_g)
+{
+    const uvec ugroups = arma::unique(groups);
+
+    std::vector<gsvb::group_record> records;
+    std::vector<double> g_out, mu_out, f_out;
+    double dropped = 0.0;
+
+    for (uword k = 0; k < ugroups.n_elem; ++k)
+    {
+	if (g(k) < min_g || g(k) == 0.0) {
+	    dropped += g(k);
+	    continue;
+	}
+
+	const uvec G = arma::find(groups == ugroups(k));
+
+	gsvb::group_record r;
+	r.col = G(0);
+	r.size = G.n_elem;
+	r.coef = mu_out.size();
+	r.factor = f_out.size();
+	records.push_back(r);
+
+	g_out.push_back(g(k));
+	for (uword j : G) mu_out.push_back(mu(j));
+
+	if (diag_cov) {
+	    for (uword j : G) f_out.push_back(s(j));
+	} else {
+	    mat L;
+	    if (!arma::chol(L, Ss.at(k), "lower"))
+		L = arma::diagmat(sqrt(Ss.at(k).diag()));
+	    f_out.insert(f_out.end(), L.begin(), L.end());
+	}
+    }
+
+    gsvb::file_header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, "GSVBMDL", 8);
+    h.version = GSVB_FILE_VERSION;
+    h.endian = GSVB_FILE_ENDIAN;
+    h.family = family;
+    h.flags = (diag_cov ? GSVB_FILE_DIAG_COV : 0u) | 
+	(intercept ? GSVB_FILE_INTERCEPT : 0u);
+    h.p = mu.n_elem - (intercept ? 1 : 0);
+    h.n_groups = records.size();
+    h.n_coef = mu_out.size();
+    h.n_factor = f_out.size();
+    h.tau_a = tau_a;
+    h.tau_b = tau_b;
+    gsvb::file_layout(h);
+
+    // write each section at its offset, the gaps are zero filled
+    std::vector<char> buf(h.size, 0);
+    std::memcpy(buf.data(), &h, sizeof(h));
+    if (h.n_groups) {
+	std::memcpy(buf.data() + h.off_groups, records.data(), 
+		records.size() * sizeof(gsvb::group_record));
+	std::memcpy(buf.data() + h.off_g, g_out.data(), 
+		g_out.size() * sizeof(double));
+	std::memcpy(buf.data() + h.off_mu, mu_out.data(), 
+		mu_out.size() * sizeof(double));
+	std::memcpy(buf.data() + h.off_factor, f_out.data(), 
+		f_out.size() * sizeof(double));
+    }
+
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out) 
+	Rcpp::stop("cannot open " + path);
+    out.write(buf.data(), buf.size());
+    if (!out)
+	Rcpp::stop("failed to write " + path);
+
+    return dropped;
+}
+
+
+// Score the rows of X with a model file using the header-only scorer
+//
+// [[Rcpp::export]]
+Rcpp::List model_score(const std::string &path, const mat &X)
+{
+    const uword n = X.n_rows;
+    vec y_mean = vec(n), y_var = vec(n);
+    vec eta_mean = vec(n), eta_var = vec(n);
+
+    try {
+	gsvb::scorer sc(path);
+	if (sc.ncol() != X.n_cols)
+	    Rcpp::stop("newdata must have %d columns", (int) sc.ncol());
+
+	// armadillo matrices are column major
+	sc.score(X.memptr(), n, 1, n, y_mean.memptr(), y_var.memptr(),
+		eta_mean.memptr(), eta_var.memptr());
+    } catch (const std::runtime_error &e) {
+	Rcpp::stop(e.what());
+    }
+
+    return Rcpp::List::create(
+	Rcpp::Named("mean") = y_mean,
+	Rcpp::Named("var") = y_var,
+	Rcpp::Named("eta_mean") = eta_mean,
+	Rcpp::Named("eta_var") = eta_var
+    );
+}
@@ -0,0 +1,17 @@
+#ifndef GSVB_EXPORT_H
+#define GSVB_EXPORT_H
+
+#include <vector>
+#include <fstream>
+
+#include "gsvb_types.h"
+#include "gsvb_scorer.h"
+
+double model_write(const std::string &path, const vec &mu, const vec &s,
+	const std::vector<mat> &Ss, const vec &g, const uvec &groups, 
+	const bool diag_cov, const uword family, const double tau_a, 
+	const double tau_b, const bool intercept, const double min_g);
+
+Rcpp::List model_score(const std::string &path, const mat &X);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef GSVB_GRAM_H
+#define GSVB_GRAM_H
+
+#include "gsvb_types.h"
+#include "memory.h"
+
+// Representations of the Gram matrix xtx := X'X used by the linear fitter.
+//
+// Each keeps xtx (g o mu) current as the groups are updated, so that the
+// cross terms of a group with the others, xtx(G, Gc) (g o mu)(Gc), are
+// formed from the group's rows alone:
+//   block(G)		xtx(G, G)
+//   cross(G, ...)	xtx(G, Gc) (g o mu)(Gc), given xtx(G, G) and the
+//			current (g o mu)(G)
+//   update(G, d)	(g o mu)(G) has changed by d
+//   quad(gm)		gm' xtx gm for the current gm = g o mu
+//
+// gram_dense holds xtx, p x p. When n < p, xtx = V D^2 V' exactly for the
+// thin SVD X = U D V', and gram_svd holds V, p x r with r = min(n, p), and
+// z := V' (g o mu) in place of xtx (g o mu), reducing the memory by p / r.
+// A block then costs O(|G|^2 r) and the cross terms O(|G| r).
+class gram_dense
+{
+    public:
+	gram_dense(const mat &xtx, const vec &gm) : 
+	    xtx(xtx), xgm(xtx * gm) { }
+
+	mat block(const uvec &G) const { return xtx(G, G); }
+
+	vec cross(const uvec &G, const mat &xtx_GG, const vec &gm_G) const {
+	    return xgm(G) - xtx_GG * gm_G;
+	}
+
+	void update(const uvec &G, const vec &d) { xgm += xtx.cols(G) * d; }
+
+	double quad(const vec &gm) const { return dot(gm, xgm); }
+
+	void record(memory_tracker &m) const { m.record("xtx", xtx); }
+
+    private:
+	const mat &xtx;
+	vec xgm;
+};
+
+
+class gram_svd
+{
+    public:
+	gram_svd(const mat &V, const vec &d2, const vec &gm) : 
+	    V(V), d2(d2), z(V.t() * gm) { }
+
+	mat block(const uvec &G) const {
+	    const mat VG = V.rows(G);
+	    return VG * arma::diagmat(d2) * VG.t();
+	}
+
+	vec cross(const uvec &G, const mat &xtx_GG, const vec &gm_G) const {
+	    return V.rows(G) * (d2 % z) - xtx_GG * gm_G;
+	}
+
+	void update(const uvec &G, const vec &d) { z += V.rows(G).t() * d; }
+
+	double quad(const vec &) const { return dot(z, d2 % z); }
+
+	void record(memory_tracker &m) const { m.record("V", V); }
+
+    private:
+	const mat &V;
+	const vec &d2;
+	vec z;
+};
+
+#endif
@@ -7,5 +7,6 @@ typedef arma::vec vec;
 typedef arma::uvec uvec;
 typedef arma::uword uword;
 typedef arma::mat mat;
+typedef arma::sp_mat sp_mat;
 
 #endif
@@ -0,0 +1,181 @@
+#include "init.h"
+
+
+// Native initialization of mu, replacing the calls to gglasso and glmnet.
+// X is used in place, no copies of the data are made.
+//
+// The amount of regularization is set relative to the data as in gglasso, 
+// ratio = 1e-3 if n >= p and 0.05 otherwise.
+//
+// [[Rcpp::export]]
+vec init_mu(const vec &y, const mat &X, const uvec &groups, 
+	const uword family, const uword method)
+{
+    const double ratio = X.n_rows >= X.n_cols ? 1e-3 : 0.05;
+
+    if (method == GSVB_INIT_RIDGE)
+	return init_ridge(y, X, family, ratio);
+
+    return init_gcd(y, X, groups, family, ratio);
+}
+
+
+// ---------- negative log-likelihood of each family -----------
+// gaussian: 0.5 || y - eta ||^2
+// binomial: sum log(1 + exp(eta)) - y eta
+// poisson:  sum exp(eta) - y eta
+static double init_loss(const vec &y, const vec &eta, const uword family)
+{
+    if (family == 1)
+	return 0.5 * accu(square(y - eta));
+    if (family == 5)
+	return accu(exp(eta) - y % eta);
+
+    // log(1 + exp(x)) computed stably
+    return accu(arma::max(eta, vec(eta.n_rows, arma::fill::zeros)) + 
+	    log1p(exp(-abs(eta))) - y % eta);
+}
+
+
+// mean of the response given the linear predictor
+static vec init_mean(const vec &eta, const uword family)
+{
+    if (family == 1) return eta;
+    if (family == 5) return exp(eta);
+    return sigmoid(eta);
+}
+
+
+// Group coordinate descent for the group LASSO
+//
+//	min_b loss(b) + alpha sum_k sqrt(m_k) || b_{G_k} ||
+//
+// along a geometric path of GSVB_INIT_NLAMBDA values of alpha, from 
+// alpha_max, the smallest value at which all groups are zero, to 
+// ratio * alpha_max. Each value is warm started from the last and
+// GSVB_INIT_PASSES sweeps over the groups are run.
+//
+// Each group takes a proximal gradient step using an upper bound, H_k, of 
+// the curvature of the loss in the group: || X_G ||_F^2 for the gaussian, 
+// || X_G ||_F^2 / 4 for the binomial. For the poisson the curvature is
+// unbounded, H_k is computed at the current linear predictor and doubled 
+// until the step decreases the objective.
+vec init_gcd(const vec &y, const mat &X, const uvec &groups, 
+	const uword family, const double ratio)
+{
+    const uvec ugroups = arma::unique(groups);
+    const uword M = ugroups.n_elem;
+
+    std::vector<uvec> Gs;
+    vec Fk = vec(M);
+    for (uword k = 0; k < M; ++k) {
+	Gs.push_back(arma::find(groups == ugroups(k)));
+	Fk(k) = accu(square(X.cols(Gs.back())));
+    }
+
+    vec b = vec(X.n_cols, arma::fill::zeros);
+    vec eta = vec(X.n_rows, arma::fill::zeros);
+
+    // smallest alpha for which b = 0
+    double alpha_max = 0.0;
+    const vec r0 = y - init_mean(eta, family);
+    for (uword k = 0; k < M; ++k)
+	alpha_max = std::max(alpha_max, 
+		norm(X.cols(Gs.at(k)).t() * r0) / sqrt(Gs.at(k).n_elem));
+
+    if (alpha_max <= 0.0) return b;
+
+    for (uword l = 0; l < GSVB_INIT_NLAMBDA; ++l)
+    {
+	const double alpha = alpha_max * 
+	    pow(ratio, (l + 1.0) / GSVB_INIT_NLAMBDA);
+
+	for (uword pass = 0; pass < GSVB_INIT_PASSES; ++pass)
+	{
+	    for (uword k = 0; k < M; ++k)
+	    {
+		const uvec &G = Gs.at(k);
+		const mat X_G = X.cols(G);
+		const double pen = alpha * sqrt(G.n_elem);
+
+		const vec m = init_mean(eta, family);
+		const vec grad = X_G.t() * (m - y);
+		const vec b_G = b(G);
+
+		double H = family == 1 ? Fk(k) : 
+		    family == 5 ? accu(square(X_G).t() * m) : 0.25 * Fk(k);
+		if (H <= 0.0) continue;
+
+		const double f_old = family == 5 ? 
+		    init_loss(y, eta, family) + pen * norm(b_G) : 0.0;
+
+		vec b_new, eta_new;
+		for (uword t = 0; t < 30; ++t) 
+		{
+		    const vec z = b_G - grad / H;
+		    const double nz = norm(z);
+		    b_new = nz > 0 ? vec(std::max(0.0, 1.0 - pen / (H * nz)) * z) :
+			vec(z);
+		    eta_new = eta + X_G * (b_new - b_G);
+
+		    if (family != 5 || init_loss(y, eta_new, family) + 
+			    pen * norm(b_new) <= f_old)
+			break;
+		    H *= 2.0;
+		}
+
+		b(G) = b_new;
+		eta = eta_new;
+	    }
+	}
+    }
+
+    return b;
+}
+
+
+// Ridge regression with penalty nu = ratio * mean_j || x_j ||^2, solved by 
+// GSVB_INIT_PASSES IRLS steps for the binomial and poisson families.
+//
+// If p > n the dual form is used,
+//	(X'WX + nu I)^{-1} X'Wz = X' (W XX' + nu I)^{-1} Wz,
+// so only the n x n Gram matrix is formed.
+vec init_ridge(const vec &y, const mat &X, const uword family, 
+	const double ratio)
+{
+    const uword n = X.n_rows;
+    const uword p = X.n_cols;
+    const bool dual = p > n;
+    const double nu = std::max(ratio * accu(square(X)) / p, 1e-8);
+
+    const mat K = dual ? mat(X * X.t()) : mat(X.t() * X);
+    const mat I = arma::eye(K.n_rows, K.n_cols);
+
+    vec b = vec(p, arma::fill::zeros);
+    vec eta = vec(n, arma::fill::zeros);
+    const uword steps = family == 1 ? 1 : GSVB_INIT_PASSES;
+
+    for (uword t = 0; t < steps; ++t)
+    {
+	// working weights and response
+	vec w = vec(n, arma::fill::ones);
+	vec z = y;
+	if (family != 1) {
+	    const vec m = init_mean(eta, family);
+	    w = family == 5 ? m : vec(m % (1.0 - m));
+	    w = arma::clamp(w, 1e-5, arma::datum::inf);
+	    z = eta + (y - m) / w;
+	}
+
+	if (dual) {
+	    const vec a = arma::solve(mat(K.each_col() % w) + nu * I, w % z);
+	    b = X.t() * a;
+	} else {
+	    b = arma::solve(X.t() * (X.each_col() % w) + nu * I, 
+		    X.t() * (w % z));
+	}
+	eta = X * b;
+    }
+
+    return b;
+}
@@ -0,0 +1,26 @@
+#ifndef GSVB_INIT_H
+#define GSVB_INIT_H
+
+#include <vector>
+#include <algorithm>
+
+#include "gsvb_types.h"
+#include "utils.h"
+
+// initialization methods, codes match the order of init_method in gsvb.fit
+#define GSVB_INIT_RIDGE 3	// ridge regression, IRLS for glms
+#define GSVB_INIT_GCD 4		// group coordinate descent for the group LASSO
+
+#define GSVB_INIT_NLAMBDA 10	// length of the regularization path
+#define GSVB_INIT_PASSES 5	// sweeps (gcd) or IRLS steps (ridge)
+
+vec init_mu(const vec &y, const mat &X, const uvec &groups, 
+	const uword family, const uword method);
+
+vec init_gcd(const vec &y, const mat &X, const uvec &groups, 
+	const uword family, const double ratio);
+
+vec init_ridge(const vec &y, const mat &X, const uword family, 
+	const double ratio);
+
+#endif
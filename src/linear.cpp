@@ -1,44 +1,150 @@
 #include "linear.h"
+#include "model.h"
 
 
-// [[Rcpp::export]]
-Rcpp::List fit_linear(vec y, mat X, uvec groups, const double lambda, const double a0,
-    const double b0, const double tau_a0, const double tau_b0, vec mu, vec s, 
-    vec g, bool diag_cov, bool track_elbo, const uword track_elbo_every, 
-    const uword track_elbo_mcn, unsigned int niter, double tol, bool verbose, 
-	const uword ordering)
+// log det S for S = (e_tau xtx(G, G) + v I)^-1, from the spectrum of 
+// xtx(G, G) if the group has one
+static double cov_log_det(const mat &S, const group_spectrum &spec,
+	const double e_tau, const double v)
 {
-    const uword n = X.n_rows;
-    const uword p = X.n_cols;
-    const double w = a0 / (a0 + b0);
-    
-    // compute commonly used expressions
-    const mat xtx = X.t() * X;
-    const double yty = dot(y, y);
-    const vec yx = (y.t() * X).t();
+    if (spec.empty())
+	return log_det_cov(S);
+    return -spec.trace([&](double t) -> double { return log(e_tau * t + v); });
+}
+
+
+// The linear fitter, generic over the representation of the Gram matrix
+// xtx := X'X, see gram.h. gram holds xtx (g o mu) for the initial g and mu
+// and refers to the Gram matrix held by m, which also holds the model
+// specification, yx and yty.
+template <typename Gram>
+static Rcpp::List fit_linear_core(gsvb_model &m, Gram &gram, vec mu, vec s,
+    vec g, bool track_elbo, const uword track_elbo_every, 
+    const uword track_elbo_mcn, const double track_elbo_tol,
+    const uword track_elbo_max, unsigned int niter, double tol, 
+    const uvec convergence, const uword convergence_k, bool verbose, 
+	const uword ordering, const double compact, const Rcpp::List &control)
+{
+    GSVB_PROFILE_FIT();
+    GSVB_PROFILE_SETUP();
+    GSVB_MEMORY_FIT();
+
+    const uvec &groups = m.groups;
+    const vec &yx = m.yx;
+    const double yty = m.yty;
+    const uword n = m.n;
+    const bool diag_cov = m.diag_cov;
+    const double lambda = m.lambda;
+    const double tau_a0 = m.tau_a0;
+    const double tau_b0 = m.tau_b0;
+
+    const double w = m.a0 / (m.a0 + m.b0);
+    fit_control ctl(control);
     
     // init
     const uvec ugroups = arma::unique(groups);
 	uvec g_order = ugroups;
+    const uword M = ugroups.size();
+
+    // the indices of each group, ugroups is sorted
+    std::vector<uvec> Gs;
+    for (uword group : ugroups)
+		Gs.push_back(arma::find(groups == group));
 
     // if not constrained we are using a full covariance for S
     std::vector<mat> Ss;
-    if (!diag_cov) {
+    if (!diag_cov && !ctl.Ss.empty()) {
+		Ss = ctl.Ss;
+    } else if (!diag_cov) {
 		for (uword group : ugroups) {
 			uvec G = find(groups == group);	
 			Ss.push_back(arma::diagmat(s(G)));
 		}
     }
-    vec v = vec(ugroups.size(), arma::fill::ones);
+    vec v = ctl.v.n_elem == M ? ctl.v : vec(M, arma::fill::ones);
+
+    // bookkeeping for the expected residuals, R, and the ELBO
+    //   gram: xtx * (g o mu), updated as each group is updated
+    //   r_k: within group terms of R
+    //   elbo_k: closed form contribution of each group to the ELBO
+    //   bound_k: Jensen's bound of the Monte-Carlo part of the ELBO
+    convergence_monitor conv(convergence, tol, convergence_k);
+    const bool track_elbo_k = track_elbo || conv.needs_elbo();
+
+    vec r_k = vec(M, arma::fill::zeros);
+    vec elbo_k = vec(M, arma::fill::zeros);
+    vec bound_k = vec(M, arma::fill::zeros);
+    std::vector<group_spectrum> spec(M);
+
+    // the Monte-Carlo part of the ELBO is evaluated off the main thread
+    std::unique_ptr<elbo_worker> elbo_eval;
+    if (track_elbo)
+		elbo_eval.reset(new elbo_worker(groups, lambda, track_elbo_mcn, 
+			track_elbo_tol, track_elbo_max, m.rng()));
+
+    for (uword gi = 0; gi < M; ++gi) {
+		const uvec &G = Gs.at(gi);
+		const mat xtx_GG = gram.block(G);
+		if (diag_cov) {
+			r_k(gi) = compute_r_k(xtx_GG, mu(G), s(G), g(G(0)));
+			if (track_elbo_k)
+			elbo_group_refresh(elbo_k, bound_k, gi, mu(G), s(G), g(G(0)), w, 
+				lambda);
+		} else {
+			r_k(gi) = compute_r_k(xtx_GG, mu(G), Ss.at(gi), g(G(0)));
+			if (track_elbo_k)
+			elbo_group_refresh(elbo_k, bound_k, gi, mu(G), Ss.at(gi), g(G(0)), 
+				w, lambda);
+			// spectra of xtx(G, G) for the covariance updates of large
+			// groups, xtx is fixed so they are computed once
+			if (ctl.spectral.use(G.n_elem))
+				spec.at(gi) = group_spectrum(xtx_GG);
+		}
+    }
+
+    // mu, s, g, their previous values, yx and xgm
+    gram.record(gsvb_memory_);
+    gsvb_memory_.record("Ss", Ss);
+    double spec_bytes = 0.0;
+    for (const group_spectrum &sp : spec) spec_bytes += sp.bytes();
+    if (spec_bytes > 0)
+		gsvb_memory_.record("spectra", spec_bytes);
+    gsvb_memory_.record("state", 8.0 * sizeof(double) * mu.n_elem);
+
+    GSVB_PROFILE_SETUP_END();
 
     vec mu_old, s_old, g_old, v_old;
-    double tau_a = tau_a0, tau_b = tau_b0, e_tau = tau_a0 / tau_b0;
+    double tau_a = std::isnan(ctl.tau_a) ? tau_a0 : ctl.tau_a;
+    double tau_b = std::isnan(ctl.tau_b) ? tau_b0 : ctl.tau_b;
+    double e_tau = tau_a / tau_b;
 
     uword num_iter = niter;
     bool converged = false;
-    std::vector<double> elbo_values;
-
-    for (unsigned int iter = 1; iter <= niter; ++iter)
+    uword converged_by = 0;
+    uword stopped_by = 0;
+    std::vector<double> elbo_values = ctl.elbo;
+    std::vector<double> elbo_se = ctl.elbo_se;
+
+    // state written to the checkpoints
+    auto state = [&]() -> fit_checkpoint {
+		fit_checkpoint c;
+		if (track_elbo) elbo_eval->finish(elbo_values, elbo_se);
+		c.mu = mu; c.s = s; c.g = g; c.Ss = Ss; c.v = v;
+		c.tau_a = tau_a; c.tau_b = tau_b;
+		c.elbo = elbo_values; c.elbo_se = elbo_se;
+		return c;
+    };
+
+    // elbo and active set reported to the progress callback
+    auto progress = [&]() -> fit_progress {
+		fit_progress info;
+		info.elbo = NA_REAL;
+		if (track_elbo) elbo_eval->latest(info.elbo);
+		info.active = count_active(g, groups);
+		return info;
+    };
+
+    for (unsigned int iter = ctl.start + 1; iter <= niter; ++iter)
     {
 		mu_old = mu; g_old = g;
 		if (diag_cov) {
@@ -60,10 +166,7 @@ Rcpp::List fit_linear(vec y, mat X, uvec groups, const double lambda, const doub
 			// sort by magnitude of mu
 			vec beta_mag = vec(ugroups.size(), arma::fill::zeros);
 			for (uword i = 0; i < ugroups.size(); ++i) 
-			{
-				uvec G = find(groups == ugroups(i));
-				beta_mag(i) = arma::norm(mu(G), 2);
-			}
+				beta_mag(i) = arma::norm(mu(Gs.at(i)), 2);
 			g_order = ugroups(sort_index(beta_mag, "descend"));
 		}	
 
@@ -74,57 +177,84 @@ Rcpp::List fit_linear(vec y, mat X, uvec groups, const double lambda, const doub
 		// update mu, sigma, gamma
 		for (uword group : g_order)
 		{
-			uvec G  = arma::find(groups == group);
-			uvec Gc = arma::find(groups != group);
+			// get the index of the group
+			const uword gi = std::lower_bound(ugroups.begin(), ugroups.end(),
+				group) - ugroups.begin();
+			const uvec &G = Gs.at(gi);
+			GSVB_PROFILE_GROUP(gi);
+
+			// the group's block of xtx and its cross terms with the others
+			const vec gm_G_old = g(G) % mu(G);
+			const vec yx_G = yx(G);
+			const mat xtx_GG = gram.block(G);
+			const vec cross = gram.cross(G, xtx_GG, gm_G_old);
 			
 			if (diag_cov)
 			{
-				mu(G) = update_mu(G, Gc, xtx, yx, mu, s(G), g, e_tau, lambda);
-				s(G)  = update_s(G, xtx, mu, s, e_tau, lambda);
-				double tg = update_g(G, Gc, xtx, yx, mu, s, g, e_tau, lambda, w);
+				mu(G) = update_mu(xtx_GG, cross, yx_G, vec(mu(G)), vec(s(G)), 
+					e_tau, lambda);
+				s(G)  = update_s(xtx_GG, vec(mu(G)), vec(s(G)), e_tau, lambda);
+				double tg = update_g(xtx_GG, cross, yx_G, vec(mu(G)), 
+					vec(s(G)), e_tau, lambda, w);
 				for (uword j : G) g(j) = tg;
+
+				r_k(gi) = compute_r_k(xtx_GG, mu(G), s(G), tg);
+				if (track_elbo_k)
+				elbo_group_refresh(elbo_k, bound_k, gi, mu(G), s(G), tg, w, lambda);
 			} 
 			else 
 			{
-				// get the index of the group
-				uword gi = arma::find(ugroups == group).eval().at(0);
 				mat &S = Ss.at(gi);
 
-				mu(G) = update_mu(G, Gc, xtx, yx, mu, sqrt(diagvec(S)), g, e_tau, lambda);
-				v(gi)  = update_S(G, xtx, mu, S, v(gi), e_tau, lambda);
-				double tg = update_g(G, Gc, xtx, yx, mu, S, g, e_tau, lambda, w);
+				mu(G) = update_mu(xtx_GG, cross, yx_G, vec(mu(G)), 
+					vec(sqrt(diagvec(S))), e_tau, lambda);
+				v(gi)  = update_S(xtx_GG, vec(mu(G)), S, v(gi), e_tau, lambda, 
+					spec.at(gi));
+				const double ldet = cov_log_det(S, spec.at(gi), e_tau, v(gi));
+				double tg = update_g(xtx_GG, cross, yx_G, vec(mu(G)), S, 
+					ldet, e_tau, lambda, w);
 				for (uword j : G) g(j) = tg;
+
+				r_k(gi) = compute_r_k(xtx_GG, mu(G), S, tg);
+				if (track_elbo_k)
+				elbo_group_refresh(elbo_k, bound_k, gi, mu(G), S, ldet, tg, w, 
+					lambda);
 			}
+
+			gram.update(G, g(G) % mu(G) - gm_G_old);
+			if (track_elbo) elbo_eval->mark(gi);
 		}
 		
 		// update tau_a, tau_b
-		double R = diag_cov ?
-			compute_R(yty, yx, xtx, groups, mu, s, g, p, false) :
-			compute_R(yty, yx, xtx, groups, mu, Ss, g, p, false);
+		const vec gm = g % mu;
+		const double yx_gm = dot(yx, gm);
+		double R = yty - 2.0 * yx_gm + gram.quad(gm) + accu(r_k);
 
 		update_a_b(tau_a, tau_b, tau_a0, tau_b0, R, n);
 
-		// check for break, print iter
-		Rcpp::checkUserInterrupt();
-		if (verbose) Rcpp::Rcout << iter;
-		
-		// compute the ELBO if option enabled
-		if (track_elbo && (iter % track_elbo_every == 0)) {
-			double e = diag_cov ?
-			elbo_linear_c(yty, yx, xtx, groups, n, p, mu, s, g, tau_a, tau_b,
-				lambda, a0, b0, tau_a0, tau_b0, track_elbo_mcn, false) :
-			elbo_linear_u(yty, yx, xtx, groups, n, p, mu, Ss, g, tau_a, tau_b,
-				lambda, a0, b0, tau_a0, tau_b0, track_elbo_mcn, false);
+		// closed form terms of the ELBO
+		const double elbo_det = track_elbo_k ? accu(elbo_k) + 
+			elbo_linear_lik(n, yty, R, yx_gm, tau_a, tau_b, tau_a0, tau_b0) : 
+			0.0;
 
-			elbo_values.push_back(e);
+		// record the ELBO if option enabled
+		if (track_elbo && (iter % track_elbo_every == 0)) {
+			GSVB_PROFILE_SCOPE(GSVB_PHASE_ELBO);
+			elbo_eval->submit(elbo_det, mu, s, Ss, g);
 		}
 
+		GSVB_PROFILE_SWEEP();
+
+		// progress, checkpoint, check for break, print iter
+		stopped_by = ctl.end_sweep(iter, state, progress);
+		if (verbose) Rcpp::Rcout << iter;
+
 		// check convergence
-		bool var_conv = diag_cov ? sum(abs(s_old - s)) < tol : sum(abs(v_old - v)) < tol; 
+		converged_by = diag_cov ?
+			conv.check(mu_old, mu, s_old, s, g_old, g, elbo_det - accu(bound_k)) :
+			conv.check(mu_old, mu, v_old, v, g_old, g, elbo_det - accu(bound_k));
 
-		if (sum(abs(mu_old - mu)) < tol &&
-			var_conv &&
-			sum(abs(g_old - g)) < tol) 
+		if (converged_by) 
 		{
 			if (verbose)
 			Rcpp::Rcout << "\nConverged in " << iter << " iterations\n";
@@ -133,86 +263,209 @@ Rcpp::List fit_linear(vec y, mat X, uvec groups, const double lambda, const doub
 			converged = true;
 			break;
 		}
+
+		if (stopped_by)
+		{
+			if (verbose)
+				Rcpp::Rcout << "\nStopped after " << iter << " iterations\n";
+
+			num_iter = iter;
+			break;
+		}
     }
     
-    // compute elbo for final eval
+    // record the elbo for final eval
     if (track_elbo) {
-		double e = diag_cov ?
-			elbo_linear_c(yty, yx, xtx, groups, n, p, mu, s, g, tau_a, tau_b,
-			lambda, a0, b0, tau_a0, tau_b0, track_elbo_mcn, false) :
-			elbo_linear_u(yty, yx, xtx, groups, n, p, mu, Ss, g, tau_a, tau_b,
-			lambda, a0, b0, tau_a0, tau_b0, track_elbo_mcn, false);
-		elbo_values.push_back(e);
+		GSVB_PROFILE_SCOPE(GSVB_PHASE_ELBO);
+		const vec gm = g % mu;
+		const double yx_gm = dot(yx, gm);
+		const double R = yty - 2.0 * yx_gm + gram.quad(gm) + accu(r_k);
+
+		elbo_eval->submit(accu(elbo_k) + 
+			elbo_linear_lik(n, yty, R, yx_gm, tau_a, tau_b, tau_a0, tau_b0),
+			mu, s, Ss, g);
+		elbo_eval->finish(elbo_values, elbo_se);
+		gsvb_memory_.record("elbo_queue", elbo_eval->peak_bytes());
     }
+
+    if (ctl.model)
+		m.set_state(mu, s, Ss, v, g, tau_a, tau_b);
+
+    // drop the inactive groups
+    uvec active = ugroups;
+    if (compact > 0)
+		active = compact_state(mu, s, Ss, g, groups, compact);
     
     return Rcpp::List::create(
+		Rcpp::Named("active") = active,
 		Rcpp::Named("mu") = mu,
 		Rcpp::Named("sigma") = s,
 		Rcpp::Named("S") = Ss,
+		Rcpp::Named("v") = v,
 		Rcpp::Named("gamma") = g,
 		Rcpp::Named("tau_a") = tau_a,
 		Rcpp::Named("tau_b") = tau_b,
 		Rcpp::Named("converged") = converged,
+		Rcpp::Named("converged_by") = converged_by,
+		Rcpp::Named("stopped_by") = stopped_by,
 		Rcpp::Named("iterations") = num_iter,
-		Rcpp::Named("elbo") = elbo_values
+		Rcpp::Named("elbo") = elbo_values,
+		Rcpp::Named("elbo_se") = elbo_se,
+		Rcpp::Named("profile") = GSVB_PROFILE_RESULT(),
+		Rcpp::Named("memory") = gsvb_memory_.result()
     );
 }
 
+// [[Rcpp::export]]
+Rcpp::List fit_linear(vec y, mat X, uvec groups, const double lambda, const double a0,
+    const double b0, const double tau_a0, const double tau_b0, vec mu, vec s, 
+    vec g, bool diag_cov, bool track_elbo, const uword track_elbo_every, 
+    const uword track_elbo_mcn, const double track_elbo_tol,
+    const uword track_elbo_max, unsigned int niter, double tol, 
+    const uvec convergence, const uword convergence_k, bool verbose, 
+	const uword ordering, const double compact, const Rcpp::List control)
+{
+    GSVB_PROFILE_FIT();
+    GSVB_PROFILE_SETUP();
+    GSVB_MEMORY_FIT();
+
+    // the model holds the commonly used expressions
+    const fit_control ctl(control);
+    std::unique_ptr<gsvb_model> m(new gsvb_model(groups, 1, diag_cov, lambda,
+	    a0, b0, tau_a0, tau_b0, X.n_rows));
+    m->yty = dot(y, y);
+    m->yx = (y.t() * X).t();
+    m->gram = ctl.gram;
+    gsvb_memory_.record("X", X);
+
+    // xtx from the thin SVD X = U D V', X is not needed after
+    if (m->gram == GSVB_GRAM_SVD)
+    {
+	mat U;
+	vec d;
+	if (!arma::svd_econ(U, d, m->V, X, "right"))
+	    Rcpp::stop("SVD of X failed");
+	// svd_econ works on a copy of X and forms V from V'
+	gsvb_memory_.record("V", m->V);
+	gsvb_memory_.temporary("svd", bytes_of(X) + bytes_of(m->V));
+	U.reset();
+	X.reset();
+	gsvb_memory_.record("X", 0.0);
+	m->d2 = d % d;
+    } else {
+	m->xtx = X.t() * X;
+	gsvb_memory_.record("xtx", m->xtx);
+    }
+
+    GSVB_PROFILE_SETUP_END();
+
+    Rcpp::List f = fit_linear_model(*m, mu, s, g, track_elbo, 
+	    track_elbo_every, track_elbo_mcn, track_elbo_tol, track_elbo_max, 
+	    niter, tol, convergence, convergence_k, verbose, ordering, compact, 
+	    control);
+
+    if (ctl.model)
+	f.push_back(Rcpp::XPtr<gsvb_model>(m.release(), true), "model");
+    return f;
+}
+
+
+// Fit the linear model from the data held by m, in the representation of
+// X'X of the fit that built m, used to warm restart a fit
+Rcpp::List fit_linear_model(gsvb_model &m, vec mu, vec s, vec g, 
+    bool track_elbo, const uword track_elbo_every, 
+    const uword track_elbo_mcn, const double track_elbo_tol,
+    const uword track_elbo_max, unsigned int niter, double tol, 
+    const uvec convergence, const uword convergence_k, bool verbose, 
+	const uword ordering, const double compact, const Rcpp::List &control)
+{
+    GSVB_PROFILE_FIT();
+    GSVB_PROFILE_SETUP();
+    GSVB_MEMORY_FIT();
+
+    if (m.gram == GSVB_GRAM_SVD) {
+	gram_svd gram(m.V, m.d2, g % mu);
+
+	GSVB_PROFILE_SETUP_END();
+
+	return fit_linear_core(m, gram, mu, s, g, track_elbo, 
+		track_elbo_every, track_elbo_mcn, track_elbo_tol, 
+		track_elbo_max, niter, tol, convergence, convergence_k, verbose,
+		ordering, compact, control);
+    }
+
+    gram_dense gram(m.xtx, g % mu);
+
+    GSVB_PROFILE_SETUP_END();
+
+    return fit_linear_core(m, gram, mu, s, g, track_elbo, track_elbo_every,
+	    track_elbo_mcn, track_elbo_tol, track_elbo_max, niter, tol, 
+	    convergence, convergence_k, verbose, ordering, compact, control);
+}
+
 
 // ----------------- mu -------------------
+//   cross: xtx(G, Gc) * (g(Gc) % mu(Gc)), the cross terms with the other
+//   groups, fixed while the group is updated
 class update_mu_fn
 {
     public:
-	update_mu_fn(const uvec &G, const uvec &Gc, const mat &xtx, 
-		const vec &yx, const vec &mu, const vec &s, const vec &g, 
-		const double e_tau, const double lambda) :
-	    G(G), Gc(Gc), xtx(xtx), yx(yx), mu(mu), s(s), g(g), 
+	update_mu_fn(const mat &xtx_GG, const vec &cross, const vec &yx_G, 
+		const vec &s, const double e_tau, const double lambda) :
+	    xtx_GG(xtx_GG), cross(cross), yx_G(yx_G), s(s), 
 	    e_tau(e_tau), lambda(lambda)
 	    { }
 
 	double EvaluateWithGradient(const arma::mat &m, arma::mat &grad) {
 
-	    const double res = 0.5 * e_tau * dot(m.t() * xtx(G, G), m) + 
-		e_tau * dot(m.t() * xtx(G, Gc), (g(Gc) % mu(Gc))) -
-		e_tau * dot(yx(G), m) +
+	    const double res = 0.5 * e_tau * dot(m.t() * xtx_GG, m) + 
+		e_tau * dot(m, cross) -
+		e_tau * dot(yx_G, m) +
 		lambda * pow(dot(s, s) + dot(m, m), 0.5);
 
-	    grad = e_tau * xtx(G, G) * m + 
-		e_tau * xtx(G, Gc) * (g(Gc) % mu(Gc)) -
-		e_tau * yx(G) +
+	    grad = e_tau * xtx_GG * m + 
+		e_tau * cross -
+		e_tau * yx_G +
 		lambda * m * pow(dot(s, s) + dot(m, m), -0.5);
 
 	    return res;
 	}
 
     private:
-	const uvec &G;
-	const uvec &Gc;
-	const mat &xtx;
-	const vec &yx;
-	const vec &mu;
+	const mat &xtx_GG;
+	const vec &cross;
+	const vec &yx_G;
 	const vec &s;
-	const vec &g;
 	const double e_tau;
 	const double lambda;
 };
 
 
-vec update_mu(const uvec &G, const uvec &Gc, const mat &xtx, 
-	const vec &yx, const vec &mu, const vec &s, const vec &g, 
-	const double e_tau, const double lambda)
+vec update_mu(const mat &xtx_GG, const vec &cross, const vec &yx_G,
+	const vec &mu_G, const vec &s, const double e_tau, 
+	const double lambda)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_MU);
     ens::L_BFGS opt;
     opt.MaxIterations() = 8;
-    update_mu_fn fn(G, Gc, xtx, yx, mu, s, g, e_tau, lambda);
+    update_mu_fn fn(xtx_GG, cross, yx_G, s, e_tau, lambda);
 
-    vec m = mu(G);
-    opt.Optimize(fn, m);
+    vec m = mu_G;
+    GSVB_OPTIMIZE(opt, fn, m);
 
     return m;
 }
 
 
+vec update_mu(const uvec &G, const uvec &Gc, const mat &xtx, 
+	const vec &yx, const vec &mu, const vec &s, const vec &g, 
+	const double e_tau, const double lambda)
+{
+    return update_mu(xtx(G, G), xtx(G, Gc) * (g(Gc) % mu(Gc)), yx(G), 
+	    mu(G), s, e_tau, lambda);
+}
+
+
 // Update mu using monte carlo integration to estimate the intractable integral 
 // the function is slower than update_mu_fn and gives similar results.
 // This function is not used within the main
@@ -241,71 +494,78 @@ vec update_mu(const uvec &G, const uvec &Gc, const mat &xtx,
 class update_s_fn
 {
     public:
-	update_s_fn(const uvec &G, const mat &xtx, const vec &mu, 
-		const double e_tau, const double lambda) :
-	    G(G), xtx(xtx), mu(mu), e_tau(e_tau), lambda(lambda) { }
+	update_s_fn(const vec &d, const vec &mu_G, const double e_tau, 
+		const double lambda) :
+	    d(d), mm(dot(mu_G, mu_G)), e_tau(e_tau), lambda(lambda) { }
 
 	double EvaluateWithGradient(const arma::mat &u, arma::mat &grad) {
 	    mat s = exp(u); // we need to force s to be positive everywhere
 
-	    const double res = 0.5 * e_tau * dot(diagvec(xtx(G, G)), s % s) -
-		accu(log(s)) + lambda * pow(dot(s, s) + dot(mu(G), mu(G)), 0.5);
+	    const double res = 0.5 * e_tau * dot(d, s % s) -
+		accu(log(s)) + lambda * pow(dot(s, s) + mm, 0.5);
 
 	    // since we're optimzing over u, we need to return the gradient with
 	    // respect to u. By the chain rule the grad is:
 	    // 
 	    // d / du = d / ds * ds / du
-	    grad = (e_tau * diagvec(xtx(G, G)) % s -
-		1/s + lambda * s * pow(dot(s, s) + dot(mu(G), mu(G)), -0.5)) % s;
+	    grad = (e_tau * d % s -
+		1/s + lambda * s * pow(dot(s, s) + mm, -0.5)) % s;
 
 	    return res;
 	}
 
     private:
-	const uvec &G;
-	const mat &xtx;
-	const vec &mu;
+	const vec &d;		// diagvec(xtx(G, G))
+	const double mm;	// dot(mu(G), mu(G))
 	const double e_tau;
 	const double lambda;
 };
 
 
-vec update_s(const uvec &G, const mat &xtx, const vec &mu, 
-	const vec &s, const double e_tau, const double lambda)
+vec update_s(const mat &xtx_GG, const vec &mu_G, const vec &s_G, 
+	const double e_tau, const double lambda)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_S);
     ens::L_BFGS opt;
-    update_s_fn fn(G, xtx, mu, e_tau, lambda);
+    const vec d = diagvec(xtx_GG);
+    update_s_fn fn(d, mu_G, e_tau, lambda);
     opt.MaxIterations() = 8;
     
     // we are using the relationship s = exp(u) to
     // for s to be positive everywhere
-    vec u = log(s(G));
-    opt.Optimize(fn, u);
+    vec u = log(s_G);
+    GSVB_OPTIMIZE(opt, fn, u);
 
     return exp(u);
 }
 
 
+vec update_s(const uvec &G, const mat &xtx, const vec &mu, 
+	const vec &s, const double e_tau, const double lambda)
+{
+    return update_s(xtx(G, G), mu(G), s(G), e_tau, lambda);
+}
+
+
 // ----------------- S -------------------
 class update_S_fn
 {
     public:
-	update_S_fn(const uvec &G, const mat &xtx, const vec &mu, 
-		const double e_tau, const double lambda) :
-	    G(G), xtx(xtx), mu(mu), e_tau(e_tau), lambda(lambda) { }
+	update_S_fn(const mat &psi, const vec &mu_G, const double e_tau, 
+		const double lambda) :
+	    psi(psi), mm(dot(mu_G, mu_G)), e_tau(e_tau), lambda(lambda) { }
 
 	double EvaluateWithGradient(const mat &v, mat &grad) {
-	    const mat psi = xtx(G, G);
-	    const vec w = vec(G.size(), arma::fill::value(v(0, 0)));
+	    const vec w = vec(psi.n_rows, arma::fill::value(v(0, 0)));
 	    const mat S = arma::inv(e_tau * psi + arma::diagmat(w));
 	    const vec ds = arma::diagvec(S);
 
 	    const double res = 0.5 * e_tau * arma::trace(psi * S) -
-		0.5 * log(arma::det(S)) + 
-		lambda * pow(sum(ds) + dot(mu(G), mu(G)), 0.5);
+		0.5 * log_det_cov(S) + 
+		lambda * pow(sum(ds) + mm, 0.5);
 
 	    // gradient wrt. v
-	    double tv = 0.5 * lambda * pow(sum(ds) + dot(mu(G), mu(G)), -0.5);
+	    double tv = 0.5 * lambda * pow(sum(ds) + mm, -0.5);
 	    // grad = 0.5 * (v(0, 0) - 2.0 * tv) * accu(S % S);
 	    grad = (0.5 * v(0, 0) - tv) * accu(S % S);
 
@@ -313,9 +573,8 @@ class update_S_fn
 	}
 
     private:
-	const uvec &G;
-	const mat &xtx;
-	const vec &mu;
+	const mat &psi;		// xtx(G, G)
+	const double mm;	// dot(mu(G), mu(G))
 	const double e_tau;
 	const double lambda;
 };
@@ -324,59 +583,139 @@ class update_S_fn
 double update_S(const uvec &G, const mat &xtx, const vec &mu, 
 	mat &S, double s, const double e_tau, const double lambda)
 {
+    return update_S(xtx(G, G), mu(G), S, s, e_tau, lambda, 
+	    group_spectrum());
+}
+
+
+// The objective of update_S_fn for large groups. S = (e_tau psi + v I)^-1 is
+// a function of the spectrum of psi = xtx(G, G), so the traces and the
+// log-determinant are sums over its eigenvalues, O(m) per evaluation
+class update_S_spectral_fn
+{
+    public:
+	update_S_spectral_fn(const group_spectrum &spec, const double mm,
+		const double e_tau, const double lambda) :
+	    spec(spec), mm(mm), e_tau(e_tau), lambda(lambda) { }
+
+	double EvaluateWithGradient(const mat &v, mat &grad) {
+	    const double e = e_tau, a = v(0, 0);
+
+	    // tr(psi S), log det S, tr S and accu(S % S)
+	    const double tps = spec.trace([&](double t) -> double { 
+		    return t / (e * t + a); });
+	    const double lds = -spec.trace([&](double t) -> double { 
+		    return log(e * t + a); });
+	    const double ts = spec.trace([&](double t) -> double { 
+		    return 1.0 / (e * t + a); });
+	    const double tss = spec.trace([&](double t) -> double { 
+		    return 1.0 / ((e * t + a) * (e * t + a)); });
+
+	    const double res = 0.5 * e_tau * tps - 0.5 * lds + 
+		lambda * pow(ts + mm, 0.5);
+
+	    double tv = 0.5 * lambda * pow(ts + mm, -0.5);
+	    grad = (0.5 * a - tv) * tss;
+
+	    return res;
+	}
+
+    private:
+	const group_spectrum &spec;
+	const double mm;		// dot(mu(G), mu(G))
+	const double e_tau;
+	const double lambda;
+};
+
+
+double update_S(const mat &xtx_GG, const vec &mu_G, mat &S, double s, 
+	const double e_tau, const double lambda, 
+	const group_spectrum &spec)
+{
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_S);
     ens::L_BFGS opt;
-    update_S_fn fn(G, xtx, mu, e_tau, lambda);
     opt.MaxIterations() = 8;
    
     mat v = mat(1, 1);
     v(0, 0) = s;
-    opt.Optimize(fn, v);
+    const mat I = arma::eye(xtx_GG.n_rows, xtx_GG.n_rows);
+
+    if (spec.empty()) {
+	update_S_fn fn(xtx_GG, mu_G, e_tau, lambda);
+	GSVB_OPTIMIZE(opt, fn, v);
 
-    // update S
-    S = arma::inv(e_tau * xtx(G, G) + v(0, 0) * arma::eye(G.size(), G.size())); 
+	// update S
+	S = arma::inv(e_tau * xtx_GG + v(0, 0) * I); 
+    } else {
+	update_S_spectral_fn fn(spec, dot(mu_G, mu_G), e_tau, lambda);
+	GSVB_OPTIMIZE(opt, fn, v);
+
+	// the covariance is formed once from the eigenvectors, as it is 
+	// used by the other updates and returned
+	S = spec.covariance(e_tau, v(0, 0));
+    }
     return v(0, 0);
 }
 
 
 // ----------------- gamma -------------------
-double update_g(const uvec &G, const uvec &Gc, const mat &xtx,
-	const vec &yx, const vec &mu, const vec &s, const vec &g, double e_tau,
-	double lambda, double w)
+double update_g(const mat &xtx_GG, const vec &cross, const vec &yx_G,
+	const vec &mu_G, const vec &s_G, double e_tau, double lambda, double w)
 {
-    const double mk = G.size();
-    double res = log(w / (1.0 - w)) + 0.5*mk + e_tau * arma::dot(yx(G), mu(G)) +
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_G);
+    const double mk = mu_G.n_elem;
+    double res = log(w / (1.0 - w)) + 0.5*mk + e_tau * arma::dot(yx_G, mu_G) +
 	0.5 * mk * log(2.0 * M_PI) +
-	sum(log(s(G))) -
+	sum(log(s_G)) -
 	mk * log(2.0) - 0.5 * (mk - 1.0) * log(M_PI) - lgamma(0.5 * (mk + 1)) +
 	mk * log(lambda) - 
-	lambda * sqrt(sum(pow(s(G), 2.0)) + sum(pow(mu(G), 2.0))) -
-	0.5 * e_tau * dot(diagvec(xtx(G, G)), pow(s(G), 2.0)) -
-	0.5 * e_tau * dot(mu(G).t() * xtx(G, G), mu(G)) -
-	e_tau * dot(mu(G).t() * xtx(G, Gc), g(Gc) % mu(Gc));
+	lambda * sqrt(sum(pow(s_G, 2.0)) + sum(pow(mu_G, 2.0))) -
+	0.5 * e_tau * dot(diagvec(xtx_GG), pow(s_G, 2.0)) -
+	0.5 * e_tau * dot(mu_G.t() * xtx_GG, mu_G) -
+	e_tau * dot(mu_G, cross);
 
     return sigmoid(res);
 }
 
 
-double update_g(const uvec &G, const uvec &Gc, const mat &xtx,
-	const vec &yx, const vec &mu, const mat &S, const vec &g, double e_tau,
+double update_g(const mat &xtx_GG, const vec &cross, const vec &yx_G,
+	const vec &mu_G, const mat &S, const double ldet_S, double e_tau, 
 	double lambda, double w)
 {
-    const double mk = G.size();
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_G);
+    const double mk = mu_G.n_elem;
     vec diag_S = diagvec(S);
-    double res = log(w / (1.0 - w)) + 0.5*mk + e_tau * arma::dot(yx(G), mu(G)) +
-	0.5 * log(det(2.0 * M_PI * S)) +
+    double res = log(w / (1.0 - w)) + 0.5*mk + e_tau * arma::dot(yx_G, mu_G) +
+	0.5 * (mk * log(2.0 * M_PI) + ldet_S) +
 	mk * log(2.0) - 0.5 * (mk - 1.0) * log(M_PI) - lgamma(0.5 * (mk + 1)) + // log(Ck)
 	mk * log(lambda) - 
-	lambda * sqrt(sum(diag_S) + sum(mu(G) % mu(G))) -
-	0.5 * e_tau * accu(xtx(G, G) % S) -
-	0.5 * e_tau * dot(mu(G).t() * xtx(G, G), mu(G)) -
-	e_tau * dot(mu(G).t() * xtx(G, Gc), g(Gc) % mu(Gc));
+	lambda * sqrt(sum(diag_S) + sum(mu_G % mu_G)) -
+	0.5 * e_tau * accu(xtx_GG % S) -
+	0.5 * e_tau * dot(mu_G.t() * xtx_GG, mu_G) -
+	e_tau * dot(mu_G, cross);
 
     return sigmoid(res);
 }
 
 
+double update_g(const uvec &G, const uvec &Gc, const mat &xtx,
+	const vec &yx, const vec &mu, const vec &s, const vec &g, double e_tau,
+	double lambda, double w)
+{
+    return update_g(xtx(G, G), xtx(G, Gc) * (g(Gc) % mu(Gc)), yx(G), mu(G),
+	    vec(s(G)), e_tau, lambda, w);
+}
+
+
+double update_g(const uvec &G, const uvec &Gc, const mat &xtx,
+	const vec &yx, const vec &mu, const mat &S, const vec &g, double e_tau,
+	double lambda, double w)
+{
+    return update_g(xtx(G, G), xtx(G, Gc) * (g(Gc) % mu(Gc)), yx(G), mu(G),
+	    S, log_det_cov(S), e_tau, lambda, w);
+}
+
+
 // ----------------- tau ---------------------
 // Used for testing and not directly used within the C++
 // implementation.
@@ -439,6 +778,7 @@ class update_a_b_fn
 void update_a_b(double &tau_a, double &tau_b, const double tau_a0,
 	const double tau_b0, const double R, const double n)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_TAU);
     ens::L_BFGS opt(50, 1000); // (numBasis, maxIterations)
     update_a_b_fn fn(tau_a0, tau_b0, R, n);
     
@@ -451,7 +791,7 @@ void update_a_b(double &tau_a, double &tau_b, const double tau_a0,
     pars(0, 0) = log(tau_a);
     pars(1, 0) = log(tau_b);
 
-    opt.Optimize(fn, pars);
+    GSVB_OPTIMIZE(opt, fn, pars);
     
     // update tau_a and tau_b
     tau_a = exp(pars(0, 0));
@@ -468,86 +808,104 @@ void update_a_b(double &tau_a, double &tau_b, const double tau_a0,
 // where Q: variational family, Pi: prior, Pi_D: model evidence
 // l(D; beta): likelihood
 //
+// The intractable term E_Q [ lambda * || b_{G_k} || ] is estimated by
+// Monte-Carlo integration. Samples are drawn in batches of mcn until the
+// std. error of the estimate is below mc_tol, or mc_max samples are drawn.
+// Returns a vector containing the ELBO and its std. error.
+//
 // TEST WRITTEN: [sort of]
 // [[Rcpp::export]]
-double elbo_linear_c(const double yty, const vec &yx, const mat &xtx, const uvec &groups,
+vec elbo_linear_c(const double yty, const vec &yx, const mat &xtx, const uvec &groups,
 	const uword n, const uword p, const vec &mu, const vec &s, const vec &g,
 	const double tau_a, const double tau_b, const double lambda, 
 	const double a0, const double b0, const double tau_a0, 
-	const double tau_b0, const uword mcn, const bool approx, 
-	const double approx_thresh)
+	const double tau_b0, const uword mcn, const double mc_tol,
+	const uword mc_max, const bool approx, const double approx_thresh)
 {
-    const double w = a0 / (a0 + b0);
-    const double e_tau = tau_a / tau_b;
-
-    double res = 0.0;
     const double R = compute_R(yty, yx, xtx, groups, mu, s, g, p, 
 	    approx, approx_thresh);
 
-    res += -0.5 * n * log(2 * M_PI) - 
-	0.5 * n * (log(tau_b) + R::digamma(tau_a)) -
-	0.5 * e_tau * yty -			// yty := <y, y>
-	0.5 * e_tau * R +			// S := (X'X)_ij E[b_i b_j]
-	e_tau * dot(yx, g % mu) +		// yx := X'y
-	0.5 * sum(g % log(2 * M_PI * pow(s, 2.0)));
+    return elbo_linear_c(R, yty, yx, groups, n, mu, s, g, tau_a, tau_b, 
+	    lambda, a0, b0, tau_a0, tau_b0, mcn, mc_tol, mc_max);
+}
+
+
+vec elbo_linear_c(const double R, const double yty, const vec &yx, 
+	const uvec &groups, const uword n, const vec &mu, const vec &s, 
+	const vec &g, const double tau_a, const double tau_b, 
+	const double lambda, const double a0, const double b0, 
+	const double tau_a0, const double tau_b0, const uword mcn, 
+	const double mc_tol, const uword mc_max)
+{
+    const uvec ugroups = unique(groups);
+    const double w = a0 / (a0 + b0);
+
+    double res = 0.0;
+    res += elbo_linear_lik(n, yty, R, dot(yx, g % mu), tau_a, tau_b, 
+	    tau_a0, tau_b0);
     
     // compute the terms that depend on gamma_k
-    for (uword K : unique(groups).eval()) {
+    std::vector<uvec> Gs;
+    for (uword K : ugroups) {
 	uvec G = find(groups == K);
 	uword k = G(0);
 	double mk = G.size();		// mk = group size
+	Gs.push_back(G);
 	
-	// Ck: part of the normalization constant for the Multivariate
-	// double Exp dist
-	double Ck = -mk*log(2.0) - 0.5*(mk-1.0)*log(M_PI) - lgamma(0.5*(mk+1));
-
-	res += g(k) * Ck +
-	    0.5 * g(k) * mk +
-	    g(k) * mk * log(lambda) -
-	    g(k) * log((1e-8 + g(k)) / (1e-8 + w)) -	// add 1e-8 to prevent -Inf
-	    (1 - g(k)) * log((1-g(k) + 1e-8) / (1 - w));
+	// Ck: normalization const. for the Multivariate double Exp dist,
+	// entropy of the slab and KL(g || w)
+	res += elbo_group(mk, g(k), w, lambda, accu(log(s(G) % s(G))));
+    }
 	
-	// Compute the Monte-Carlo integral of E_Q [ lambda * || b_{G_k} || ]
-	double mci = 0.0;
-	for (uword iter = 0; iter < mcn; ++iter) {
-	    mci += norm(arma::randn(mk) % s(G) + mu(G), 2);
+    // Compute the Monte-Carlo integral of E_Q [ lambda * S_k g_k || b_{G_k} || ]
+    const vec mci = mc_integrate([&]() -> double {
+	double r = 0.0;
+	for (const uvec &G : Gs) {
+	    r += g(G(0)) * norm(arma::randn(G.size()) % s(G) + mu(G), 2);
 	}
-	mci = mci / static_cast<double>(mcn);
+	return lambda * r;
+    }, mcn, mc_tol, mc_max);
 
-	res -= lambda * g(k) * mci;
-    }
-
-    // compute the expected value of E_G^-1 [ log dG^-1(a', b') / dG^-1(a, b)]
-    res += tau_a * log(tau_b) - tau_a0 * log(tau_b0) + R::lgammafn(tau_a0)
-	- R::lgammafn(tau_a) + (tau_a0 - tau_a)*(log(tau_b) + R::digamma(tau_a)) +
-	(tau_b0 - tau_b) * tau_a / tau_b;
+    res -= mci(0);
 
-    return(res);
+    vec elbo = { res, mci(1) };
+    return(elbo);
 }
 
 // un-constrained
 // [[Rcpp::export]]
-double elbo_linear_u(const double yty, const vec &yx, const mat &xtx, const uvec &groups,
+vec elbo_linear_u(const double yty, const vec &yx, const mat &xtx, const uvec &groups,
 	const uword n, const uword p, const vec &mu, const std::vector<mat> &Ss, 
 	const vec &g, const double tau_a, const double tau_b, const double lambda,
 	const double a0, const double b0, const double tau_a0, const double tau_b0, 
-	const uword mcn, const bool approx, const double approx_thresh)
+	const uword mcn, const double mc_tol, const uword mc_max,
+	const bool approx, const double approx_thresh)
+{
+    const double R = compute_R(yty, yx, xtx, groups, mu, Ss, g, p, 
+	    approx, approx_thresh);
+
+    return elbo_linear_u(R, yty, yx, groups, n, mu, Ss, g, tau_a, tau_b, 
+	    lambda, a0, b0, tau_a0, tau_b0, mcn, mc_tol, mc_max);
+}
+
+
+vec elbo_linear_u(const double R, const double yty, const vec &yx, 
+	const uvec &groups, const uword n, const vec &mu, 
+	const std::vector<mat> &Ss, const vec &g, const double tau_a, 
+	const double tau_b, const double lambda, const double a0, 
+	const double b0, const double tau_a0, const double tau_b0, 
+	const uword mcn, const double mc_tol, const uword mc_max)
 {
     const uvec ugroups = unique(groups);
     const double w = a0 / (a0 + b0);
-    const double e_tau = tau_a / tau_b;
 
     double res = 0.0;
-    const double R = compute_R(yty, yx, xtx, groups, mu, Ss, g, p, 
-	    approx, approx_thresh);
-
-    res += -0.5 * n * log(2 * M_PI) - 
-	0.5 * n * (log(tau_b) + R::digamma(tau_a)) -
-	0.5 * e_tau * yty -			// yty := <y, y>
-	0.5 * e_tau * R +			// S := (X'X)_ij E[b_i b_j]
-	e_tau * dot(yx, g % mu);		// yx := X'y
+    res += elbo_linear_lik(n, yty, R, dot(yx, g % mu), tau_a, tau_b, 
+	    tau_a0, tau_b0);
 
     // compute the terms that depend on gamma_k
+    std::vector<uvec> Gs;
+    std::vector<mat> Rs;
     for (uword group : ugroups) 
     {
 	uvec G = find(groups == group);	// indices of group members 
@@ -558,35 +916,54 @@ double elbo_linear_u(const double yty, const vec &yx, const mat &xtx, const uvec
 	uword group_index = find(ugroups == group).eval().at(0);
 	mat S = Ss.at(group_index);
 	
-	// Normalization const, Ck: double exp, Sk: multivariate norm
-	double Ck = -mk*log(2.0) - 0.5*(mk-1.0)*log(M_PI) - lgamma(0.5*(mk+1));
-	double Sk = 0.5 * log(arma::det(2 * M_PI * S));
-
-	res += g(k) * Sk + 
-	    g(k) * Ck +
-	    0.5 * g(k) * mk +
-	    g(k) * mk * log(lambda) -
-	    g(k) * log((1e-8 + g(k)) / (1e-8 + w)) -	// add 1e-8 to prevent -Inf
-	    (1 - g(k)) * log((1-g(k) + 1e-8) / (1 - w));
+	// Normalization const, Ck: double exp, entropy of the multivariate 
+	// norm and KL(g || w)
+	res += elbo_group(mk, g(k), w, lambda, log_det_cov(S));
+
+	// the square root of S is computed once and reused for every sample
+	Gs.push_back(G);
+	Rs.push_back(arma::sqrtmat_sympd(S));
+    }
 	
-	// Compute the Monte-Carlo integral of E_Q [ lambda * || b_{G_k} || ]
-	double mci = 0.0;
-	for (uword iter = 0; iter < mcn; ++iter) {
-	    // X ~ N(0, I)
-	    // Y = S^1/2 X + mu => Y ~ N(mu, S)
-	    mci += norm(sqrtmat(S) * arma::randn(mk) + mu(G), 2);
+    // Compute the Monte-Carlo integral of E_Q [ lambda * S_k g_k || b_{G_k} || ]
+    // X ~ N(0, I)
+    // Y = S^1/2 X + mu => Y ~ N(mu, S)
+    const vec mci = mc_integrate([&]() -> double {
+	double r = 0.0;
+	for (uword i = 0; i < Gs.size(); ++i) {
+	    const uvec &G = Gs.at(i);
+	    r += g(G(0)) * norm(Rs.at(i) * arma::randn(G.size()) + mu(G), 2);
 	}
-	mci = mci / static_cast<double>(mcn);
+	return lambda * r;
+    }, mcn, mc_tol, mc_max);
 
-	res -= lambda * g(k) * mci;
-    }
+    res -= mci(0);
+
+    vec elbo = { res, mci(1) };
+    return(elbo);
+}
+
+
+// Terms of the ELBO that depend on the likelihood and tau^2, where
+// R := E [ | y - Xb |^2 ] and yx_gm := <yx, g o mu>
+double elbo_linear_lik(const uword n, const double yty, const double R, 
+	const double yx_gm, const double tau_a, const double tau_b,
+	const double tau_a0, const double tau_b0)
+{
+    const double e_tau = tau_a / tau_b;
+
+    double res = -0.5 * n * log(2 * M_PI) - 
+	0.5 * n * (log(tau_b) + R::digamma(tau_a)) -
+	0.5 * e_tau * yty -			// yty := <y, y>
+	0.5 * e_tau * R +			// S := (X'X)_ij E[b_i b_j]
+	e_tau * yx_gm;				// yx := X'y
 
     // compute the expected value of E_G^-1 [ log dG^-1(a', b') / dG^-1(a, b)]
     res += tau_a * log(tau_b) - tau_a0 * log(tau_b0) + R::lgammafn(tau_a0)
 	- R::lgammafn(tau_a) + (tau_a0 - tau_a)*(log(tau_b) + R::digamma(tau_a)) +
 	(tau_b0 - tau_b) * tau_a / tau_b;
 
-    return(res);
+    return res;
 }
 
 
@@ -662,3 +1039,27 @@ double compute_R(const double yty, const vec &yx, const mat &xtx,
     double R = yty + xtx_bi_bj - 2.0 * dot(yx, g % mu);
     return R;
 }
+
+
+// Within group terms of R for group k
+//
+// r_k := g_k (tr(xtx_GG S) + mu_G' xtx_GG mu_G) - g_k^2 mu_G' xtx_GG mu_G
+//
+// so that R = <y, y> - 2 <yx, g o mu> + <g o mu, xtx (g o mu)> + S_k r_k,
+// this allows R to be maintained as groups are updated.
+double compute_r_k(const mat &xtx_GG, const vec &mu_G, const vec &s_G,
+	const double g)
+{
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_TAU);
+    const double q = dot(mu_G, xtx_GG * mu_G);
+    return g * (dot(diagvec(xtx_GG), s_G % s_G) + q) - g * g * q;
+}
+
+
+double compute_r_k(const mat &xtx_GG, const vec &mu_G, const mat &S,
+	const double g)
+{
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_TAU);
+    const double q = dot(mu_G, xtx_GG * mu_G);
+    return g * (accu(xtx_GG % S) + q) - g * g * q;
+}
@@ -1,11 +1,53 @@
 #ifndef GSVB_FIT_LINEAR_H
 #define GSVB_FIT_LINEAR_H
 
+#include <memory>
+
 #include "RcppEnsmallen.h"
 
 #include "gsvb_types.h"
 #include "utils.h"
+#include "async.h"
+#include "convergence.h"
+#include "memory.h"
+#include "control.h"
+#include "spectrum.h"
+#include "gram.h"
+
+struct gsvb_model;
+
+Rcpp::List fit_linear_model(gsvb_model &m, vec mu, vec s, vec g, 
+    bool track_elbo, const uword track_elbo_every, 
+    const uword track_elbo_mcn, const double track_elbo_tol,
+    const uword track_elbo_max, unsigned int niter, double tol, 
+    const uvec convergence, const uword convergence_k, bool verbose, 
+	const uword ordering, const double compact, const Rcpp::List &control);
+
+// The updates of a group G given its block of the Gram matrix, xtx_GG :=
+// xtx(G, G), and its cross terms with the other groups,
+// cross := xtx(G, Gc) * (g(Gc) % mu(Gc))
+vec update_mu(const mat &xtx_GG, const vec &cross, const vec &yx_G,
+	const vec &mu_G, const vec &s, const double e_tau, 
+	const double lambda);
 
+vec update_s(const mat &xtx_GG, const vec &mu_G, const vec &s_G, 
+	const double e_tau, const double lambda);
+
+// the traces and log-determinant are evaluated from the spectrum of xtx_GG
+// if spec is not empty
+double update_S(const mat &xtx_GG, const vec &mu_G, mat &S, double s, 
+	const double e_tau, const double lambda, 
+	const group_spectrum &spec);
+
+double update_g(const mat &xtx_GG, const vec &cross, const vec &yx_G,
+	const vec &mu_G, const vec &s_G, double e_tau, double lambda, double w);
+
+// ldet_S := log det S
+double update_g(const mat &xtx_GG, const vec &cross, const vec &yx_G,
+	const vec &mu_G, const mat &S, const double ldet_S, double e_tau, 
+	double lambda, double w);
+
+// as above, given the full xtx
 vec update_mu(const uvec &G, const uvec &Gc, const mat &xtx, 
 	const vec &yx, const vec &mu, const vec &s, const vec &g, 
 	const double sigma, const double lambda);
@@ -39,17 +81,44 @@ double compute_R(const double yty, const vec &yx, const mat &xtx,
 	const vec &g, const uword p, const bool approx, 
 	const double approx_thresh=1e-3);
 
-double elbo_linear_c(const double yty, const vec &yx, const mat &xtx, const uvec &groups,
+double compute_r_k(const mat &xtx_GG, const vec &mu_G, const vec &s_G,
+	const double g);
+
+double compute_r_k(const mat &xtx_GG, const vec &mu_G, const mat &S,
+	const double g);
+
+double elbo_linear_lik(const uword n, const double yty, const double R, 
+	const double yx_gm, const double tau_a, const double tau_b,
+	const double tau_a0, const double tau_b0);
+
+// ELBO, returns the estimate and the Monte-Carlo std. error
+vec elbo_linear_c(const double yty, const vec &yx, const mat &xtx, const uvec &groups,
 	const uword n, const uword p, const vec &mu, const vec &s, const vec &g,
 	const double tau_a, const double tau_b, const double lambda, 
 	const double a0, const double b0, const double tau_a0, 
-	const double tau_b0, const uword mcn, const bool approx, 
-	const double approx_thresh=1e-3);
+	const double tau_b0, const uword mcn, const double mc_tol,
+	const uword mc_max, const bool approx, const double approx_thresh=1e-3);
 
-double elbo_linear_u(const double yty, const vec &yx, const mat &xtx, const uvec &groups,
+vec elbo_linear_u(const double yty, const vec &yx, const mat &xtx, const uvec &groups,
 	const uword n, const uword p, const vec &mu, const std::vector<mat> &Ss, 
 	const vec &g, const double tau_a, const double tau_b, const double lambda,
 	const double a0, const double b0, const double tau_a0, const double tau_b0, 
-	const uword mcn, const bool approx, const double approx_thresh=1e-3);
+	const uword mcn, const double mc_tol, const uword mc_max,
+	const bool approx, const double approx_thresh=1e-3);
+
+// as above, given R := E [ | y - Xb |^2 ], see compute_R
+vec elbo_linear_c(const double R, const double yty, const vec &yx, 
+	const uvec &groups, const uword n, const vec &mu, const vec &s, 
+	const vec &g, const double tau_a, const double tau_b, 
+	const double lambda, const double a0, const double b0, 
+	const double tau_a0, const double tau_b0, const uword mcn, 
+	const double mc_tol, const uword mc_max);
+
+vec elbo_linear_u(const double R, const double yty, const vec &yx, 
+	const uvec &groups, const uword n, const vec &mu, 
+	const std::vector<mat> &Ss, const vec &g, const double tau_a, 
+	const double tau_b, const double lambda, const double a0, 
+	const double b0, const double tau_a0, const double tau_b0, 
+	const uword mcn, const double mc_tol, const uword mc_max);
 
 #endif
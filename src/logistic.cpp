@@ -1,4 +1,5 @@
 #include "logistic.h"
+#include "model.h"
 #include <bitset>
 
 #define GSVB_BINOM_MAXITS 8
@@ -7,12 +8,67 @@
 Rcpp::List fit_logistic(vec y, mat X, uvec groups, const double lambda, 
     const double a0, const double b0, vec mu, vec s, vec g, 
     const bool diag_cov, bool track_elbo, const uword track_elbo_every, 
-    const uword track_elbo_mcn, const double thresh, const int l, 
-    unsigned int niter, unsigned int alg, double tol, bool verbose,
-	const uword ordering)
+    const uword track_elbo_mcn, const double track_elbo_tol,
+    const uword track_elbo_max, const double thresh, const int l, 
+    unsigned int niter, unsigned int alg, double tol, 
+    const uvec convergence, const uword convergence_k, bool verbose,
+	const uword ordering, const double compact, const Rcpp::List control)
 {
+    GSVB_PROFILE_FIT();
+    GSVB_PROFILE_SETUP();
+    GSVB_MEMORY_FIT();
+
+    // the model holds the data and the expressions of the bound, the 
+    // refined bound is used by the binomial-refined family, which is also
+    // the family of the model of its first stage
+    const fit_control ctl(control);
+    const uword family = ctl.family > 0 ? ctl.family : (alg == 1 ? 4 : alg);
+    std::unique_ptr<gsvb_model> m(new gsvb_model(groups, family, diag_cov,
+	    lambda, a0, b0, 0.0, 0.0, X.n_rows));
+    m->X = std::move(X);
+    m->y = std::move(y);
+    m->yX = m->X.t() * m->y;
+
+    GSVB_PROFILE_SETUP_END();
+
+    Rcpp::List f = fit_logistic_model(*m, mu, s, g, track_elbo, 
+	    track_elbo_every, track_elbo_mcn, track_elbo_tol, track_elbo_max, 
+	    thresh, l, niter, alg, tol, convergence, convergence_k, verbose, 
+	    ordering, compact, control);
+
+    if (ctl.model)
+	f.push_back(Rcpp::XPtr<gsvb_model>(m.release(), true), "model");
+    return f;
+}
+
+
+// Fit the model from the data held by m, the expressions of the bound are
+// reused if m holds them for alg, used to warm restart a fit
+Rcpp::List fit_logistic_model(gsvb_model &m, vec mu, vec s, vec g, 
+    bool track_elbo, const uword track_elbo_every, 
+    const uword track_elbo_mcn, const double track_elbo_tol,
+    const uword track_elbo_max, const double thresh, const int l, 
+    unsigned int niter, unsigned int alg, double tol, 
+    const uvec convergence, const uword convergence_k, bool verbose,
+	const uword ordering, const double compact, const Rcpp::List &control)
+{
+    GSVB_PROFILE_FIT();
+    GSVB_PROFILE_SETUP();
+    GSVB_MEMORY_FIT();
+
+    fit_control ctl(control);
+    const mat &X = m.X;
+    const vec &y = m.y;
+    const uvec &groups = m.groups;
+    const bool diag_cov = m.diag_cov;
+    const double lambda = m.lambda;
     const uword n = X.n_rows;
     const uword p = X.n_cols;
+
+    // the cached expressions are for the state of m, they are invalid
+    // while it is updated
+    const bool cached = m.cache == alg;
+    m.cache = 0;
     
     const uvec ugroups = arma::unique(groups);
     uvec it_groups = ugroups;
@@ -20,26 +76,32 @@ Rcpp::List fit_logistic(vec y, mat X, uvec groups, const double lambda,
 
 
     const uword M = ugroups.size();
-    const double w = a0 / (a0 + b0);
+    const double w = m.a0 / (m.a0 + m.b0);
     
     // init new bound
     vec mu_old, s_old, g_old;
-    mat Xm = mat(n, M);
-    mat Xs = mat(n, M);
+    mat &Xm = m.Xm;
+    mat &Xs = m.Xs;
     vec ug = vec(M);
+    if (alg == 1)
+	for (uword gi = 0; gi < M; ++gi)
+	    ug(gi) = g(arma::find(groups == ugroups(gi), 1).eval().at(0));
 
     // init jensens
-    mat XX = mat(n, p);
-    const vec yX = X.t() * y;
-    vec P = vec(n, arma::fill::zeros);
+    mat &XX = m.XX;
+    const vec &yX = m.yX;
+    vec &P = m.P;
 
     // init jaakkola
-    mat XAX = mat(p, p);
-    vec jaak_vp = vec(n);
+    mat &XAX = m.XAX;
+    vec &jaak_vp = m.jaak_vp;
+    vec &yXh = m.yXh;
     std::vector<mat> Ss;
 	
     // new bound init
-    if (alg == 1)
+    if (alg == 1 && !cached) {
+	Xm = mat(n, M);
+	Xs = mat(n, M);
 	for (uword group : ugroups) 
 	{
 	    uword gi = arma::find(ugroups == group).eval().at(0);
@@ -47,43 +109,131 @@ Rcpp::List fit_logistic(vec y, mat X, uvec groups, const double lambda,
 
 	    Xm.col(gi) = X.cols(G) * mu(G);
 	    Xs.col(gi) = (X.cols(G) % X.cols(G)) * (s(G) % s(G));
-	    ug(gi) = g(G(0));
 	}
+    }
     
-    // jensens init
-    if (alg == 2) {
-	XX = X % X;
+    // jensens init, XX only depends on X
+    if (alg == 2 && !cached) {
+	if (XX.is_empty()) XX = X % X;
 	P = compute_P(X, XX, mu, s, g, groups);
     }
 
     // jaak init
     if (alg == 3) {
-	jaak_vp = jaak_update_l(X, mu, s, g);
-	XAX = X.t() * diagmat(a(jaak_vp)) * X;
-
 	// init unristricted covariance matrix
 	if (!diag_cov) {
-	    for (uword group : ugroups) {
-		uvec G = find(groups == group);	
-		Ss.push_back(arma::diagmat(s(G)));
+	    if (!ctl.Ss.empty()) {
+		Ss = ctl.Ss;
+	    } else {
+		for (uword group : ugroups) {
+		    uvec G = find(groups == group);	
+		    Ss.push_back(arma::diagmat(s(G)));
+		}
+	    }
+	    if (!cached) jaak_vp = jaak_update_l(X, mu, Ss, g, groups, ugroups);
+	} else if (!cached) {
+	    jaak_vp = jaak_update_l(X, mu, s, g);
+	}
+	if (yXh.is_empty()) yXh = X.t() * (y - 0.5);
+    }
+
+    // bookkeeping for the ELBO, closed form contribution of each group and 
+    // Jensen's bound of the Monte-Carlo part, which is evaluated off the 
+    // main thread
+    convergence_monitor conv(convergence, tol, convergence_k);
+    const bool track_elbo_k = track_elbo || conv.needs_elbo();
+
+    vec elbo_k = vec(M, arma::fill::zeros);
+    vec bound_k = vec(M, arma::fill::zeros);
+    std::unique_ptr<elbo_worker> elbo_eval;
+
+    if (track_elbo)
+	elbo_eval.reset(new elbo_worker(groups, lambda, track_elbo_mcn, 
+		    track_elbo_tol, track_elbo_max, m.rng()));
+
+    if (track_elbo_k) {
+	for (uword gi = 0; gi < M; ++gi) {
+	    uvec G = arma::find(groups == ugroups(gi));
+	    if (alg == 3 && !diag_cov) {
+		elbo_group_refresh(elbo_k, bound_k, gi, mu(G), Ss.at(gi), 
+			g(G(0)), w, lambda);
+	    } else {
+		elbo_group_refresh(elbo_k, bound_k, gi, mu(G), s(G), g(G(0)), 
+			w, lambda);
 	    }
 	}
     }
 
+    // expected log-likelihood, lower bounded using the bound of the 
+    // algorithm, i.e. E_Q [ log(1 + exp(x'b)) ] is upper bounded by
+    //	 alg 1: ell, the refined bound
+    //	 alg 2: log(1 + E_Q [ exp(x'b) ]) by Jensen's inq.
+    //	 alg 3: Jaakkola's bound where the variational parameter
+    //	    l = sqrt(E_Q [ (x'b)^2 ]), so the quadratic term vanishes
+    auto elbo_lik = [&]() -> double {
+	GSVB_PROFILE_SCOPE(GSVB_PHASE_ELBO);
+	if (alg == 1) 
+	    return dot(yX, g % mu) - ell(Xm, Xs, ug, thresh, l);
+	if (alg == 2)
+	    return dot(yX, g % mu) - accu(log1p(P));
+	return dot(yXh, g % mu) - accu(log1p(exp(-jaak_vp)) + 0.5 * jaak_vp);
+    };
+
+    // mu, s, g, their previous values and yX
+    gsvb_memory_.record("X", X);
+    gsvb_memory_.record("XX", XX);
+    gsvb_memory_.record("XAX", alg == 3 ? sizeof(double) * p * p : 0.0);
+    gsvb_memory_.record("Xm", Xm);
+    gsvb_memory_.record("Xs", Xs);
+    gsvb_memory_.record("Ss", Ss);
+    gsvb_memory_.record("P", bytes_of(P) + bytes_of(jaak_vp));
+    gsvb_memory_.record("state", 7.0 * sizeof(double) * p);
+
+    // the copies of the columns of a group and their squares made by the
+    // updates, and diagmat(a) X formed for XAX
+    uword m_max = 0;
+    for (uword group : ugroups)
+	m_max = std::max<uword>(m_max, accu(groups == group));
+    gsvb_memory_.temporary("X_G", 2.0 * sizeof(double) * n * m_max);
+    if (alg == 3)
+	gsvb_memory_.temporary("AX", bytes_of(X));
+
+    GSVB_PROFILE_SETUP_END();
+
     uword num_iter = niter;
-    std::vector<double> elbo_values;
+    std::vector<double> elbo_values = ctl.elbo;
+    std::vector<double> elbo_se = ctl.elbo_se;
     bool converged = false;
-    
-    for (unsigned int iter = 1; iter <= niter; ++iter)
+    uword converged_by = 0;
+    uword stopped_by = 0;
+
+    // state written to the checkpoints
+    auto state = [&]() -> fit_checkpoint {
+	fit_checkpoint c;
+	if (track_elbo) elbo_eval->finish(elbo_values, elbo_se);
+	c.mu = mu; c.s = s; c.g = g; c.Ss = Ss;
+	c.tau_a = c.tau_b = NAN;
+	c.elbo = elbo_values; c.elbo_se = elbo_se;
+	return c;
+    };
+
+    // elbo and active set reported to the progress callback
+    auto progress = [&]() -> fit_progress {
+	fit_progress info;
+	info.elbo = NA_REAL;
+	if (track_elbo) elbo_eval->latest(info.elbo);
+	info.active = count_active(g, groups);
+	return info;
+    };
+
+    for (unsigned int iter = ctl.start + 1; iter <= niter; ++iter)
     {
 	mu_old = mu; s_old = s; g_old = g;
 
-	if (alg == 3) {
-	    if (diag_cov) {
-		jaak_vp = jaak_update_l(X, mu, s, g);
-	    } else {
-		jaak_vp = jaak_update_l(X, mu, Ss, g, groups, ugroups);
-	    }
+	// the variational parameter l is updated at the end of each sweep,
+	// the model holds XAX for its l
+	if (alg == 3 && !(cached && iter == ctl.start + 1)) {
+	    GSVB_PROFILE_SCOPE(GSVB_PHASE_AUX);
 	    XAX = X.t() * diagmat(a(jaak_vp)) * X;
 	}
 
@@ -121,6 +271,7 @@ Rcpp::List fit_logistic(vec y, mat X, uvec groups, const double lambda,
 	for (uword group : g_order)
 	{
 	    uvec G  = arma::find(groups == group);
+	    GSVB_PROFILE_GROUP(arma::find(ugroups == group).eval().at(0));
 	    
 	    // update using new bound
 	    if (alg == 1)
@@ -128,15 +279,24 @@ Rcpp::List fit_logistic(vec y, mat X, uvec groups, const double lambda,
 		uword gi = arma::find(ugroups == group).eval().at(0);
 
 		mu(G) = nb_update_m(y, X, mu, s, ug, lambda, gi, G, Xm, Xs, thresh, l);
-		Xm.col(gi) = X.cols(G) * mu(G);
+		{
+		    GSVB_PROFILE_SCOPE(GSVB_PHASE_AUX);
+		    Xm.col(gi) = X.cols(G) * mu(G);
+		}
 
 		s(G)  = nb_update_s(y, X, mu, s, ug, lambda, gi, G, Xm, Xs, thresh, l);
-		Xs.col(gi) = (X.cols(G) % X.cols(G)) * (s(G) % s(G));
+		{
+		    GSVB_PROFILE_SCOPE(GSVB_PHASE_AUX);
+		    Xs.col(gi) = (X.cols(G) % X.cols(G)) * (s(G) % s(G));
+		}
 
 		double tg = nb_update_g(y, X, mu, s, ug, lambda, gi, G, Xm, Xs, 
 			thresh, l, w);
 		for (uword j : G) g(j) = tg;
 		ug(gi) = tg;
+
+		if (track_elbo_k)
+		    elbo_group_refresh(elbo_k, bound_k, gi, mu(G), s(G), tg, w, lambda);
 	    }
 
 	    // update using jensens
@@ -151,6 +311,11 @@ Rcpp::List fit_logistic(vec y, mat X, uvec groups, const double lambda,
 		for (uword j : G) g(j) = tg;
 
 		P %= compute_P_G(X.cols(G), XX.cols(G), mu(G), s(G), g(G(0)));
+
+		if (track_elbo_k) {
+		    uword gi = arma::find(ugroups == group).eval().at(0);
+		    elbo_group_refresh(elbo_k, bound_k, gi, mu(G), s(G), tg, w, lambda);
+		}
 	    }
 
 	    // update using jaakola bound
@@ -164,6 +329,11 @@ Rcpp::List fit_logistic(vec y, mat X, uvec groups, const double lambda,
 		    s(G)  = jaak_update_s(XAX, mu, s, lambda, G);
 		    double tg = jaak_update_g(y, X, XAX, mu, s, g, lambda, w, G, Gc);
 		    for (uword j : G) g(j) = tg;
+
+		    if (track_elbo_k) {
+			uword gi = arma::find(ugroups == group).eval().at(0);
+			elbo_group_refresh(elbo_k, bound_k, gi, mu(G), s(G), tg, w, lambda);
+		    }
 		} 
 		else 
 		{
@@ -176,24 +346,42 @@ Rcpp::List fit_logistic(vec y, mat X, uvec groups, const double lambda,
 
 		    double tg = jaak_update_g(y, X, XAX, mu, S, g, lambda, w, G, Gc);
 		    for (uword j : G) g(j) = tg;
+
+		    if (track_elbo_k)
+			elbo_group_refresh(elbo_k, bound_k, gi, mu(G), S, tg, w, lambda);
 		}
 	    }
+
+	    if (track_elbo)
+		elbo_eval->mark(arma::find(ugroups == group).eval().at(0));
 	}
 
+	if (alg == 3) {
+	    if (diag_cov) {
+		jaak_vp = jaak_update_l(X, mu, s, g);
+	    } else {
+		jaak_vp = jaak_update_l(X, mu, Ss, g, groups, ugroups);
+	    }
+	}
+
+	const double elbo_det = track_elbo_k ? elbo_lik() + accu(elbo_k) : 0.0;
+
 	if (track_elbo && (iter % track_elbo_every == 0)) {
-	    double e = elbo_logistic(y, X, groups, mu, s, g, Ss, lambda, w, track_elbo_mcn,
-		    diag_cov);
-	    elbo_values.push_back(e);
+	    GSVB_PROFILE_SCOPE(GSVB_PHASE_ELBO);
+	    elbo_eval->submit(elbo_det, mu, s, Ss, g);
 	}
+
+	GSVB_PROFILE_SWEEP();
 	
-	// check for break, print iter
-	Rcpp::checkUserInterrupt();
+	// progress, checkpoint, check for break, print iter
+	stopped_by = ctl.end_sweep(iter, state, progress);
 	if (verbose) Rcpp::Rcout << iter;
 	
 	// check convergence
-	if (sum(abs(mu_old - mu)) < tol &&
-	    sum(abs(s_old  - s))  < tol &&
-	    sum(abs(g_old  - g))  < tol) 
+	converged_by = conv.check(mu_old, mu, s_old, s, g_old, g, 
+		elbo_det - accu(bound_k));
+
+	if (converged_by) 
 	{
 	    if (verbose)
 		Rcpp::Rcout << "\nConverged in " << iter << " iterations\n";
@@ -202,24 +390,51 @@ Rcpp::List fit_logistic(vec y, mat X, uvec groups, const double lambda,
 	    converged = true;
 	    break;
 	}
+
+	if (stopped_by)
+	{
+	    if (verbose)
+		Rcpp::Rcout << "\nStopped after " << iter << " iterations\n";
+
+	    num_iter = iter;
+	    break;
+	}
     }
     
     // compute elbo for final eval
     if (track_elbo) {
-	double e = elbo_logistic(y, X, groups, mu, s, g, Ss, lambda, w, track_elbo_mcn,
-		diag_cov);
-	elbo_values.push_back(e);
+	GSVB_PROFILE_SCOPE(GSVB_PHASE_ELBO);
+	elbo_eval->submit(elbo_lik() + accu(elbo_k), mu, s, Ss, g);
+	elbo_eval->finish(elbo_values, elbo_se);
+	gsvb_memory_.record("elbo_queue", elbo_eval->peak_bytes());
+    }
+
+    // the model holds XAX for the final l
+    if (ctl.model) {
+	if (alg == 3) XAX = X.t() * diagmat(a(jaak_vp)) * X;
+	m.set_state(mu, s, Ss, vec(), g, 0.0, 0.0);
+	m.cache = alg;
     }
 
+    // drop the inactive groups
+    uvec active = ugroups;
+    if (compact > 0)
+	active = compact_state(mu, s, Ss, g, groups, compact);
 
     return Rcpp::List::create(
+	Rcpp::Named("active") = active,
 	Rcpp::Named("mu") = mu,
 	Rcpp::Named("sigma") = s,
 	Rcpp::Named("gamma") = g,
 	Rcpp::Named("converged") = converged,
+	Rcpp::Named("converged_by") = converged_by,
+	Rcpp::Named("stopped_by") = stopped_by,
 	Rcpp::Named("iterations") = num_iter,
 	Rcpp::Named("S") = Ss,
-	Rcpp::Named("elbo") = elbo_values
+	Rcpp::Named("elbo") = elbo_values,
+	Rcpp::Named("elbo_se") = elbo_se,
+	Rcpp::Named("profile") = GSVB_PROFILE_RESULT(),
+	Rcpp::Named("memory") = gsvb_memory_.result()
     );
 }
 
@@ -589,12 +804,13 @@ vec nb_update_m(const vec &y, const mat &X, const vec &m,
 	const vec &s, const vec &ug, double lambda, uword group,
 	const uvec G, mat &Xm, const mat &Xs, const double thresh, const int l)  
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_MU);
     ens::L_BFGS opt;
     opt.MaxIterations() = GSVB_BINOM_MAXITS;
     nb_update_m_fn fn(y, X, m, s, ug, lambda, group, G, Xm, Xs, thresh, l);
 
     arma::vec mG = m(G);
-    opt.Optimize(fn, mG);
+    GSVB_OPTIMIZE(opt, fn, mG);
 
     return mG;
 }
@@ -654,12 +870,13 @@ vec nb_update_s(const vec &y, const mat &X, const vec &m, const vec &s, vec ug,
 	const double lambda, const uword group, const uvec G, 
 	const mat &Xm, mat &Xs, const double thresh, const int l)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_S);
     ens::L_BFGS opt;
     opt.MaxIterations() = GSVB_BINOM_MAXITS;
     nb_update_s_fn fn(y, X, m, s, ug, lambda, group, G, Xm, Xs, thresh, l);
     
     vec u = log(s(G));
-    opt.Optimize(fn, u);
+    GSVB_OPTIMIZE(opt, fn, u);
 
     return exp(u);
 }
@@ -671,6 +888,7 @@ double nb_update_g(const vec &y, const mat &X, const vec &m, const vec &s,
 	const uvec &G, const mat &Xm, const mat &Xs,
 	const double thresh, const int l, const double w)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_G);
     const double mk = G.size();
     const double Ck = mk * log(2.0) + 0.5*(mk-1.0)*log(M_PI) + 
 	lgamma(0.5*(mk + 1.0));
@@ -740,12 +958,13 @@ class jen_update_mu_fn
 vec jen_update_mu(const vec &yX_G, const mat &X_G, const mat &XX_G, const vec &mu_G,
 	const vec &s_G, const double lambda, const vec &P)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_MU);
     ens::L_BFGS opt;
     opt.MaxIterations() = GSVB_BINOM_MAXITS;
     jen_update_mu_fn fn(yX_G, X_G, XX_G, s_G, lambda, P);
 
     arma::vec mG = mu_G;
-    opt.Optimize(fn, mG);
+    GSVB_OPTIMIZE(opt, fn, mG);
 
     return mG;
 }
@@ -796,12 +1015,13 @@ class jen_update_s_fn
 vec jen_update_s(const mat &X_G, const mat &XX_G, const vec &mu_G,
 	const vec &s_G, const double lambda, const vec &P)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_S);
     ens::L_BFGS opt;
     opt.MaxIterations() = GSVB_BINOM_MAXITS;
     jen_update_s_fn fn(X_G, XX_G, mu_G, lambda, P);
 
     arma::vec u = log(s_G);
-    opt.Optimize(fn, u);
+    GSVB_OPTIMIZE(opt, fn, u);
 
     return exp(u);
 }
@@ -810,6 +1030,7 @@ vec jen_update_s(const mat &X_G, const mat &XX_G, const vec &mu_G,
 double jen_update_g(const vec &yX_G, const mat &X_G, const mat &XX_G, const vec &mu_G,
 	const vec &s_G, const double lambda, const double w, const double mk, const vec &P)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_G);
     const double Ck = mk * log(2.0) + 0.5*(mk-1.0)*log(M_PI) + 
 	lgamma(0.5*(mk + 1.0));
 
@@ -876,12 +1097,13 @@ vec jaak_update_mu(const vec &y, const mat &X, const mat &XAX,
 	const vec &mu, const vec &s, const vec &g, const double lambda,
 	const uvec &G, const uvec &Gc)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_MU);
     ens::L_BFGS opt;
     opt.MaxIterations() = GSVB_BINOM_MAXITS;
     jaak_update_mu_fn fn(y, X, XAX, mu, s, g, lambda, G, Gc);
 
     vec mG = mu(G);
-    opt.Optimize(fn, mG);
+    GSVB_OPTIMIZE(opt, fn, mG);
 
     return mG;
 }
@@ -923,12 +1145,13 @@ class jaak_update_s_fn
 vec jaak_update_s(const mat &XAX, const vec &mu, 
 	const vec &s, const double lambda, const uvec &G)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_S);
     ens::L_BFGS opt;
     opt.MaxIterations() = GSVB_BINOM_MAXITS;
     jaak_update_s_fn fn(XAX, mu,lambda, G);
 
     vec u = log(s(G));
-    opt.Optimize(fn, u);
+    GSVB_OPTIMIZE(opt, fn, u);
 
     return exp(u);
 }
@@ -938,6 +1161,7 @@ double jaak_update_g(const vec &y, const mat &X, const mat &XAX,
 	const vec &mu, const vec &s, const vec &g, const double lambda,
 	const double w, const uvec &G, const uvec &Gc)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_G);
     const double mk = G.size();
     const double Ck = mk * log(2.0) + 0.5*(mk-1.0)*log(M_PI) + 
 	lgamma(0.5*(mk + 1.0));
@@ -962,6 +1186,7 @@ double jaak_update_g(const vec &y, const mat &X, const mat &XAX, const vec &mu,
 	const mat &S, const vec &g, const double lambda, const double w,
 	const uvec &G, const uvec &Gc)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_G);
     const double mk = G.size();
     const double Ck = mk * log(2.0) + 0.5*(mk-1.0)*log(M_PI) + 
 	lgamma(0.5*(mk + 1.0));
@@ -973,7 +1198,7 @@ double jaak_update_g(const vec &y, const mat &X, const mat &XAX, const vec &mu,
 	0.5 * mk - 
 	Ck +
 	mk * log(lambda) +
-	0.5 * log(det(2.0 * M_PI * S)) -
+	0.5 * (mk * log(2.0 * M_PI) + log_det_cov(S)) -
 	lambda * sqrt(sum(ds) + dot(mu(G), mu(G))) +
 	dot((y - 0.5), X.cols(G) * mu(G)) -
 	0.5 * dot(mu(G), XAX(G, G) * mu(G)) -
@@ -986,6 +1211,7 @@ double jaak_update_g(const vec &y, const mat &X, const mat &XAX, const vec &mu,
 
 vec jaak_update_l(const mat &X, const vec &mu, const vec &s, const vec &g) 
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_AUX);
     return sqrt(pow(X * (g % mu), 2) + (X % X) * (g % s % s));
 }
 
@@ -993,6 +1219,7 @@ vec jaak_update_l(const mat &X, const vec &mu, const vec &s, const vec &g)
 vec jaak_update_l(const mat &X, const vec &mu, const std::vector<mat> &Ss,
 	const vec &g, const uvec &groups, const uvec &ugroups)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_AUX);
     uword n = X.n_rows;
     vec res = pow(X * (g % mu), 2);
 
@@ -1033,7 +1260,7 @@ class jaak_update_S_fn
 	    const vec ds = arma::diagvec(S);
 
 	    const double res = 0.5 * arma::trace(psi * S) -
-		0.5 * log(arma::det(S)) + 
+		0.5 * log_det_cov(S) + 
 		lambda * pow(sum(ds) + dot(mu(G), mu(G)), 0.5);
 
 	    // gradient wrt. w
@@ -1054,12 +1281,13 @@ class jaak_update_S_fn
 vec jaak_update_S(const mat &XAX, const vec &mu, mat &S, const vec &s, 
 	const double lambda, const uvec &G)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_S);
     ens::L_BFGS opt;
     jaak_update_S_fn fn(XAX, mu, lambda, G);
     opt.MaxIterations() = GSVB_BINOM_MAXITS;
     
     vec sG = s(G);
-    opt.Optimize(fn, sG);
+    GSVB_OPTIMIZE(opt, fn, sG);
 
     // update S
     S = arma::inv(XAX(G, G) + diagmat(sG)); 
@@ -1070,55 +1298,61 @@ vec jaak_update_S(const mat &XAX, const vec &mu, mat &S, const vec &s,
 // ---------------------------------------- 
 // ELBO
 // ----------------------------------------
+// The expected log-likelihood and E_Q [ lambda * || b_{G_k} || ] are
+// estimated jointly by Monte-Carlo integration. Samples are drawn in batches
+// of mcn until the std. error is below mc_tol, or mc_max samples are drawn.
+// Returns a vector containing the ELBO and its std. error.
+//
 // [[Rcpp::export]]
-double elbo_logistic(const vec &y, const mat &X, const uvec &groups,
+vec elbo_logistic(const vec &y, const mat &X, const uvec &groups,
 	const vec &mu, const vec &s, const vec &g, const std::vector<mat> &Ss,
-	const double lambda, const double w, const uword mcn, const bool diag)
+	const double lambda, const double w, const uword mcn, const double mc_tol,
+	const uword mc_max, const bool diag)
 {
     double res = 0.0;
 
     uvec ugroups = arma::unique(groups);
+    std::vector<uvec> Gs;
+    std::vector<mat> Rs;
 
-    // noramlizing consts
+    // noramlizing consts, entropy and KL(g || w)
     for (uword group : ugroups) 
     {
 	uvec G = find(groups == group);
 	uword k = G(0);
-
 	double mk = G.size();
-	double Ck = -mk*log(2.0) - 0.5*(mk-1.0)*log(M_PI) - lgamma(0.5*(mk+1));
 
-	res += g(k) * Ck +
-	    0.5 * g(k) * mk +
-	    g(k) * mk * log(lambda) -
-	    g(k) * log((1e-8 + g(k)) / (1e-8 + w)) -	// add 1e-8 to prevent -Inf
-	    (1 - g(k)) * log((1-g(k) + 1e-8) / (1 - w));
+	// square root of the covariance, computed once for all samples
+	Gs.push_back(G);
+	if (diag) {
+	    res += elbo_group(mk, g(k), w, lambda, accu(log(s(G) % s(G))));
+	} else {
+	    uword gi = arma::find(ugroups == group).eval().at(0);
+	    res += elbo_group(mk, g(k), w, lambda, log_det_cov(Ss.at(gi)));
+	    Rs.push_back(arma::sqrtmat_sympd(Ss.at(gi)));
+	}
     }
 
 
     // monte carlo integral for intractable terms
-    double mci = 0.0;
     vec beta = vec(mu.n_rows, arma::fill::zeros);
 
-    for (uword iter = 0; iter < mcn; ++iter) {
-	for (uword group : ugroups)
+    const vec mci = mc_integrate([&]() -> double {
+	double r = 0.0;
+	beta.zeros();
+
+	for (uword gi = 0; gi < Gs.size(); ++gi)
 	{
-	    uvec G = find(groups == group);
+	    const uvec &G = Gs.at(gi);
 	    uword k = G(0);
 	    double mk = G.size();
 
 	    // Compute the Monte-Carlo integral of E_Q [ lambda * || b_{G_k} || ]
-	    vec beta_G = vec(mk, arma::fill::zeros);
-	    if (diag) {
-		beta_G = arma::randn(mk) % s(G) + mu(G);
-	    } else {
-		uword gi = arma::find(ugroups == group).eval().at(0);
-		mat S = Ss.at(gi);
-		
-		beta_G = arma::sqrtmat_sympd(S) * arma::randn(mk) + mu(G);
-	    }
+	    vec beta_G = diag ? 
+		vec(arma::randn(mk) % s(G) + mu(G)) :
+		vec(Rs.at(gi) * arma::randn(mk) + mu(G));
 
-	    mci -= lambda * g(k) * norm(beta_G, 2);
+	    r -= lambda * g(k) * norm(beta_G, 2);
 	    
 	    if (R::runif(0, 1) <= g(k)) {
 		beta(G) = beta_G;
@@ -1127,10 +1361,11 @@ double elbo_logistic(const vec &y, const mat &X, const uvec &groups,
 	
 	uvec nzero = find(beta != 0);
 	vec Xb = X.cols(nzero) * beta(nzero);
-	mci += dot(y, Xb) - accu(Xb.for_each(log1pexp));
-    }
-    mci = mci / static_cast<double>(mcn);
-    res += mci;
+	r += dot(y, Xb) - accu(Xb.for_each(log1pexp));
+
+	return r;
+    }, mcn, mc_tol, mc_max);
 
-    return(res);
+    vec elbo = { res + mci(0), mci(1) };
+    return(elbo);
 }
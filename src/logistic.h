@@ -1,15 +1,45 @@
 #ifndef GSVB_FIT_LOGISTIC_H
 #define GSVB_FIT_LOGISTIC_H
 
+#include <memory>
+
 #include "RcppEnsmallen.h"
 
 #include "gsvb_types.h"
 #include "utils.h"
+#include "async.h"
+#include "convergence.h"
+#include "memory.h"
+#include "control.h"
+
+Rcpp::List fit_logistic(vec y, mat X, uvec groups, const double lambda, 
+    const double a0, const double b0, vec mu, vec s, vec g, 
+    const bool diag_cov, bool track_elbo, const uword track_elbo_every, 
+    const uword track_elbo_mcn, const double track_elbo_tol,
+    const uword track_elbo_max, const double thresh, const int l, 
+    unsigned int niter, unsigned int alg, double tol, 
+    const uvec convergence, const uword convergence_k, bool verbose,
+	const uword ordering, const double compact, const Rcpp::List control);
+
+struct gsvb_model;
+
+Rcpp::List fit_logistic_model(gsvb_model &m, vec mu, vec s, vec g, 
+    bool track_elbo, const uword track_elbo_every, 
+    const uword track_elbo_mcn, const double track_elbo_tol,
+    const uword track_elbo_max, const double thresh, const int l, 
+    unsigned int niter, unsigned int alg, double tol, 
+    const uvec convergence, const uword convergence_k, bool verbose,
+	const uword ordering, const double compact, const Rcpp::List &control);
 
 // expected log-likelihood introduced for the new bound
 double ell(const mat &Xm, const mat &Xs,  const vec &g, double thresh, int l);
 double tll(const vec &mu, const vec &sig, const int l);
 
+vec dt_dm(const mat &X, const vec &mu, const vec &sig, const uvec &G, 
+	const int l);
+vec dt_ds(const mat &X, const vec &s, const vec &mu, const vec &sig, 
+	const uvec &G, const int l);
+
 vec nb_update_m(const vec &y, const mat &X, const vec &m, const vec &s, const vec &ug,
 	double lambda, uword group, const uvec G, mat &Xm, const mat &Xs, 
 	const double thresh, const int l);
@@ -66,9 +96,10 @@ vec jaak_update_l(const mat &X, const vec &mu, const std::vector<mat> &Ss,
 vec a(const vec &x);
 
 
-// ELBO
-double elbo_logistic(const vec &y, const mat &X, const uvec &groups,
+// ELBO, returns the estimate and the Monte-Carlo std. error
+vec elbo_logistic(const vec &y, const mat &X, const uvec &groups,
 	const vec &mu, const vec &s, const vec &g, const std::vector<mat> &Ss,
-	const double lambda, const double w, const uword mcn, const bool diag);
+	const double lambda, const double w, const uword mcn, const double mc_tol,
+	const uword mc_max, const bool diag);
 
 #endif
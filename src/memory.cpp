@@ -0,0 +1,102 @@
+#include "memory.h"
+
+
+static thread_local memory_tracker *active_tracker = nullptr;
+
+
+memory_tracker::memory_tracker() :
+    peak_held(0.0),
+    previous(active_tracker)
+{
+    if (!previous) active_tracker = this;
+}
+
+
+memory_tracker::~memory_tracker()
+{
+    if (!previous) active_tracker = nullptr;
+}
+
+
+memory_tracker *memory_tracker::active()
+{
+    return active_tracker;
+}
+
+
+// the index of name, added if not yet recorded
+uword memory_tracker::find(const std::string &name)
+{
+    for (uword i = 0; i < names.size(); ++i)
+	if (names.at(i) == name) return i;
+
+    names.push_back(name);
+    peak.push_back(0.0);
+    current.push_back(0.0);
+    is_temporary.push_back(false);
+    return names.size() - 1;
+}
+
+
+// the bytes of the buffers currently held
+double memory_tracker::held() const
+{
+    double bytes = 0.0;
+    for (double b : current) bytes += b;
+    return bytes;
+}
+
+
+// the current size of a buffer, 0 once it is freed
+void memory_tracker::record(const std::string &name, const double bytes)
+{
+    const uword i = find(name);
+    peak.at(i) = std::max(peak.at(i), bytes);
+    current.at(i) = bytes;
+    peak_held = std::max(peak_held, held());
+}
+
+
+// a temporary alive alongside the buffers currently held
+void memory_tracker::temporary(const std::string &name, const double bytes)
+{
+    const uword i = find(name);
+    peak.at(i) = std::max(peak.at(i), bytes);
+    is_temporary.at(i) = true;
+    peak_held = std::max(peak_held, held() + bytes);
+}
+
+
+void memory_tracker::record(const std::string &name, const mat &x)
+{
+    record(name, bytes_of(x));
+}
+
+
+void memory_tracker::record(const std::string &name, 
+	const std::vector<mat> &xs)
+{
+    double bytes = 0.0;
+    for (const mat &x : xs) bytes += bytes_of(x);
+    record(name, bytes);
+}
+
+
+// peak bytes of each buffer and temporary, the total of the buffers, an 
+// upper bound of the peak of their sum, and the peak held at once 
+Rcpp::NumericVector memory_tracker::result() const
+{
+    Rcpp::NumericVector res(peak.begin(), peak.end());
+    Rcpp::CharacterVector nm(names.begin(), names.end());
+
+    double total = 0.0;
+    for (uword i = 0; i < peak.size(); ++i)
+	if (!is_temporary.at(i)) total += peak.at(i);
+    res.push_back(total);
+    nm.push_back("total");
+    res.push_back(peak_held);
+    nm.push_back("peak");
+
+    res.names() = nm;
+    return res;
+}
@@ -0,0 +1,57 @@
+#ifndef GSVB_MEMORY_H
+#define GSVB_MEMORY_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "gsvb_types.h"
+
+// Accounting of the memory held by the major buffers of a fit, e.g. X, 
+// xtx, XAX and the group covariances. The fitters record each buffer 
+// after it is allocated, resized or freed, and each large temporary, e.g.
+// the workspace of the SVD of X or the copies of the columns of a group,
+// while it is alive. The peak size of each is returned in the fit as 
+// `memory`, in bytes, together with the total of the buffers and the peak
+// of the memory held at once, the buffers alive at the time and the 
+// temporary.
+//
+// As with the profiler, a fitter called by another fitter records into 
+// the tracker of the outer fit, see GSVB_MEMORY_FIT.
+class memory_tracker
+{
+    public:
+	memory_tracker();
+	~memory_tracker();
+
+	void record(const std::string &name, const double bytes);
+	void record(const std::string &name, const mat &x);
+	void record(const std::string &name, const std::vector<mat> &xs);
+	void temporary(const std::string &name, const double bytes);
+
+	Rcpp::NumericVector result() const;
+
+	// the tracker of the outermost fit running on this thread
+	static memory_tracker *active();
+
+    private:
+	uword find(const std::string &name);
+	double held() const;
+
+	std::vector<std::string> names;
+	std::vector<double> peak;
+	std::vector<double> current;	// 0 for the temporaries
+	std::vector<bool> is_temporary;
+	double peak_held;
+	memory_tracker *previous;
+};
+
+inline double bytes_of(const mat &x) 
+{ 
+    return sizeof(double) * static_cast<double>(x.n_elem); 
+}
+
+#define GSVB_MEMORY_FIT() memory_tracker gsvb_memory_own_; \
+    memory_tracker &gsvb_memory_ = *memory_tracker::active()
+
+#endif
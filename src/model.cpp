@@ -0,0 +1,215 @@
+#include "model.h"
+
+
+gsvb_model::gsvb_model(const uvec &groups, const uword family,
+	const bool diag_cov, const double lambda, const double a0,
+	const double b0, const double tau_a0, const double tau_b0,
+	const uword n) :
+    groups(groups), family(family), diag_cov(diag_cov), lambda(lambda),
+    a0(a0), b0(b0), tau_a0(tau_a0), tau_b0(tau_b0), n(n),
+    tau_a(0.0), tau_b(0.0), gram(GSVB_GRAM_DENSE), yty(0.0), cache(0),
+    rng(static_cast<uint64_t>(R::runif(0, 1) * 4294967296.0))
+{
+}
+
+
+// update the variational parameters, the sampler is rebuilt on first use
+void gsvb_model::set_state(const vec &mu, const vec &s,
+	const std::vector<mat> &Ss, const vec &v, const vec &g,
+	const double tau_a, const double tau_b)
+{
+    const uvec ugroups = arma::unique(groups);
+
+    this->mu = mu;
+    this->s = s;
+    this->Ss = Ss;
+    this->v = v;
+    this->g = vec(ugroups.n_elem);
+    for (uword k = 0; k < ugroups.n_elem; ++k)
+	this->g(k) = g(arma::find(groups == ugroups(k), 1).eval().at(0));
+    this->tau_a = tau_a;
+    this->tau_b = tau_b;
+
+    sampler_.reset();
+}
+
+
+vec gsvb_model::coef_g() const
+{
+    const uvec ugroups = arma::unique(groups);
+    vec gj = vec(groups.n_elem);
+    for (uword k = 0; k < ugroups.n_elem; ++k)
+	gj(arma::find(groups == ugroups(k))).fill(g(k));
+    return gj;
+}
+
+
+// the poisson fit holds the factors of the covariances, S = U'U
+const beta_sampler &gsvb_model::sampler()
+{
+    if (!sampler_) {
+	if (family == 5 && !diag_cov && cache == 5) {
+	    std::vector<mat> Ls;
+	    for (const mat &U : Us) Ls.push_back(U.t());
+	    sampler_.reset(new beta_sampler(mu, g, groups, Ls));
+	} else {
+	    sampler_.reset(new beta_sampler(mu, s, Ss, g, groups, diag_cov));
+	}
+    }
+    return *sampler_;
+}
+
+
+// R := E [ | y - Xb |^2 ] of the linear model from X'X in the
+// representation of the fit, the sum is not truncated for the SVD
+static double linear_R(const gsvb_model &m, const vec &gj,
+	const bool approx, const double approx_thresh)
+{
+    if (m.gram == GSVB_GRAM_DENSE) {
+	if (m.diag_cov)
+	    return compute_R(m.yty, m.yx, m.xtx, m.groups, m.mu, m.s, gj,
+		    m.mu.n_rows, approx, approx_thresh);
+	return compute_R(m.yty, m.yx, m.xtx, m.groups, m.mu, m.Ss, gj,
+		m.mu.n_rows, approx, approx_thresh);
+    }
+
+    const vec gm = gj % m.mu;
+    const gram_svd gram(m.V, m.d2, gm);
+    const uvec ugroups = arma::unique(m.groups);
+
+    double R = m.yty - 2.0 * dot(m.yx, gm) + gram.quad(gm);
+    for (uword k = 0; k < ugroups.n_elem; ++k) {
+	const uvec G = arma::find(m.groups == ugroups(k));
+	const mat xtx_GG = gram.block(G);
+	R += m.diag_cov ? compute_r_k(xtx_GG, m.mu(G), m.s(G), m.g(k)) :
+	    compute_r_k(xtx_GG, m.mu(G), m.Ss.at(k), m.g(k));
+    }
+    return R;
+}
+
+
+// [[Rcpp::export]]
+vec model_elbo(SEXP model, const uword mcn, const double mc_tol,
+	const uword mc_max, const bool approx, const double approx_thresh)
+{
+    Rcpp::XPtr<gsvb_model> m(model);
+    const vec gj = m->coef_g();
+    const double w = m->a0 / (m->a0 + m->b0);
+
+    if (m->family == 1) {
+	const double R = linear_R(*m, gj, approx, approx_thresh);
+	if (m->diag_cov)
+	    return elbo_linear_c(R, m->yty, m->yx, m->groups, m->n, m->mu,
+		    m->s, gj, m->tau_a, m->tau_b, m->lambda, m->a0, m->b0,
+		    m->tau_a0, m->tau_b0, mcn, mc_tol, mc_max);
+
+	return elbo_linear_u(R, m->yty, m->yx, m->groups, m->n, m->mu,
+		m->Ss, gj, m->tau_a, m->tau_b, m->lambda, m->a0, m->b0,
+		m->tau_a0, m->tau_b0, mcn, mc_tol, mc_max);
+    }
+
+    if (m->family == 5) {
+	if (m->diag_cov)
+	    return elbo_poisson(m->y, m->X, m->groups, m->mu, m->s, gj,
+		    m->lambda, w, mcn, mc_tol, mc_max);
+
+	return elbo_poisson_S(m->y, m->X, m->groups, m->mu, m->Ss, gj,
+		m->lambda, w, mcn, mc_tol, mc_max);
+    }
+
+    // binomial families
+    if (m->diag_cov)
+	return elbo_logistic(m->y, m->X, m->groups, m->mu, m->s, gj,
+		std::vector<mat>(1, mat(1, 1, arma::fill::zeros)), m->lambda, w,
+		mcn, mc_tol, mc_max, true);
+
+    return elbo_logistic(m->y, m->X, m->groups, m->mu,
+	    vec(m->mu.n_rows, arma::fill::ones), gj, m->Ss, m->lambda, w,
+	    mcn, mc_tol, mc_max, false);
+}
+
+
+// [[Rcpp::export]]
+sp_mat model_sample(SEXP model, const uword samples,
+	const unsigned int seed)
+{
+    Rcpp::XPtr<gsvb_model> m(model);
+    return m->sampler().sample(seed, 0, samples);
+}
+
+
+// [[Rcpp::export]]
+Rcpp::List model_predict(SEXP model, const mat &X, const uword samples,
+	const vec &probs, const bool keep_samples, const uword type,
+	const unsigned int seed)
+{
+    Rcpp::XPtr<gsvb_model> m(model);
+
+    if (type == 2)
+	return predict_moments(X, m->mu, m->s, m->Ss, m->g, m->groups,
+		m->diag_cov, m->family, m->tau_a, m->tau_b);
+
+    return predict_sampler(m->sampler(), X, m->family, m->tau_a, m->tau_b,
+	    samples, probs, keep_samples, seed);
+}
+
+
+// Free the model before the handle is collected, e.g. the model of the
+// first stage of the binomial-refined fit
+//
+// [[Rcpp::export]]
+void model_free(SEXP model)
+{
+    Rcpp::XPtr<gsvb_model> m(model);
+    m.release();
+}
+
+
+// Warm restart the fit from the state of the model. The fitters continue
+// from the data and cached expressions of the model, the linear model from
+// X'X in the representation of the fit that built it. The binomial-refined
+// family is restarted with the refined bound. The state of the model is
+// updated in place.
+//
+// [[Rcpp::export]]
+Rcpp::List model_refit(SEXP model, bool track_elbo,
+	const uword track_elbo_every, const uword track_elbo_mcn,
+	const double track_elbo_tol, const uword track_elbo_max,
+	const double thresh, const int l, unsigned int niter, double tol,
+	const uvec convergence, const uword convergence_k, bool verbose,
+	const uword ordering)
+{
+    Rcpp::XPtr<gsvb_model> m(model);
+    const vec gj = m->coef_g();
+
+    // continue from the saved state rather than the priors, the full
+    // covariances are passed as is, m->s holds their std. devs
+    Rcpp::List control;
+    control.push_back(Rcpp::wrap(true), "model");
+    if (!m->diag_cov)
+	control.push_back(Rcpp::wrap(m->Ss), "S");
+    if (m->v.n_elem > 0)
+	control.push_back(Rcpp::wrap(m->v), "v");
+    if (m->family == 1) {
+	control.push_back(Rcpp::wrap(m->tau_a), "tau_a");
+	control.push_back(Rcpp::wrap(m->tau_b), "tau_b");
+    }
+
+    if (m->family == 1)
+	return fit_linear_model(*m, m->mu, m->s, gj, track_elbo,
+		track_elbo_every, track_elbo_mcn, track_elbo_tol,
+		track_elbo_max, niter, tol, convergence, convergence_k, verbose,
+		ordering, 0.0, control);
+
+    if (m->family == 5)
+	return fit_poisson_model(*m, m->mu, m->s, gj, track_elbo,
+		track_elbo_every, track_elbo_mcn, track_elbo_tol,
+		track_elbo_max, niter, tol, convergence, convergence_k, verbose,
+		0.0, control);
+
+    const unsigned int alg = m->family == 4 ? 1 : m->family;
+    return fit_logistic_model(*m, m->mu, m->s, gj, track_elbo,
+	    track_elbo_every, track_elbo_mcn, track_elbo_tol, track_elbo_max,
+	    thresh, l, niter, alg, tol, convergence, convergence_k, verbose,
+	    ordering, 0.0, control);
+}
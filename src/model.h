@@ -0,0 +1,93 @@
+#ifndef GSVB_MODEL_H
+#define GSVB_MODEL_H
+
+#include <vector>
+#include <memory>
+#include <random>
+
+#include "gsvb_types.h"
+#include "linear.h"
+#include "logistic.h"
+#include "poisson.h"
+#include "sample.h"
+#include "predict.h"
+
+
+// A fitted model kept on the C++ side and passed to R as an external
+// pointer, so follow-up calls do not rebuild their state from R lists.
+//
+// The model is built by the fitter, which works on the data and cached
+// expressions held here, so a refit continues from them:
+//   linear:	yx := X'y, yty := y'y and X'X in the representation of the
+//		fit, xtx if gram is GSVB_GRAM_DENSE and V, d2 if it is
+//		GSVB_GRAM_SVD, see gram.h
+//   binomial:	X, y, yX := X'y and the expressions of the bound, Xm, Xs
+//		(alg 1), XX, P (alg 2), yXh, XAX, jaak_vp (alg 3)
+//   poisson:	X, y, yX, XX (diagonal covariance), P and Us, the Cholesky
+//		factors of Ss
+// The expressions that depend on the variational parameters are for the
+// current state and are valid if cache is the alg of fit_logistic they
+// were formed for, or 5 for the poisson fit. The fitters set cache to 0
+// while they update the state.
+//
+// rng seeds the ELBO workers of the fits, so refits continue its stream,
+// it is seeded from R's RNG when the model is built. Samples are seeded
+// by the callers. v holds the precision parameters of the full
+// covariances of the linear model, see update_S.
+struct gsvb_model
+{
+    gsvb_model(const uvec &groups, const uword family, const bool diag_cov,
+	    const double lambda, const double a0, const double b0,
+	    const double tau_a0, const double tau_b0, const uword n);
+
+    // g are the inclusion probabilities of the coefficients
+    void set_state(const vec &mu, const vec &s, const std::vector<mat> &Ss,
+	    const vec &v, const vec &g, const double tau_a, const double tau_b);
+
+    // inclusion probabilities of the coefficients
+    vec coef_g() const;
+
+    // the covariances are factored on first use
+    const beta_sampler &sampler();
+
+    // model specification
+    const uvec groups;
+    const uword family;
+    const bool diag_cov;
+    const double lambda, a0, b0, tau_a0, tau_b0;
+    const uword n;
+
+    // variational parameters, g are the group inclusion probabilities
+    vec mu, s, g;
+    std::vector<mat> Ss;
+    vec v;
+    double tau_a, tau_b;
+
+    // linear model
+    uword gram;
+    mat xtx;
+    mat V;
+    vec d2;
+    vec yx;
+    double yty;
+
+    // binomial and poisson models
+    mat X;
+    vec y;
+    vec yX;
+    uword cache;
+    mat Xm, Xs;
+    mat XX;
+    vec P;
+    vec yXh;
+    mat XAX;
+    vec jaak_vp;
+    std::vector<mat> Us;
+
+    std::mt19937_64 rng;
+
+    private:
+	std::unique_ptr<beta_sampler> sampler_;
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include "partition.h"
+
+
+linear_block::linear_block(const mat &X, const vec &y, const uvec &groups,
+	const double lambda, const double a0, const double b0, const vec &mu,
+	const vec &s, const vec &g, const bool diag_cov) :
+    groups(groups), ugroups(arma::unique(groups)), diag_cov(diag_cov),
+    lambda(lambda), w(a0 / (a0 + b0)), mu(mu), s(s), g(g), X(X), y(y)
+{
+    const uword M = ugroups.n_elem;
+    v = vec(M, arma::fill::ones);
+    r_k = vec(M, arma::fill::zeros);
+
+    for (uword gi = 0; gi < M; ++gi) {
+	const uvec G = arma::find(groups == ugroups(gi));
+	if (G(G.n_elem - 1) - G(0) + 1 != G.n_elem)
+	    Rcpp::stop("the groups of a block must be contiguous");
+	const auto X_G = X.cols(G(0), G(G.n_elem - 1));
+	Gs.push_back(G);
+	xtx_GG.push_back(X_G.t() * X_G);
+
+	if (diag_cov) {
+	    r_k(gi) = compute_r_k(xtx_GG.at(gi), mu(G), s(G), g(G(0)));
+	} else {
+	    Ss.push_back(arma::diagmat(s(G)));
+	    r_k(gi) = compute_r_k(xtx_GG.at(gi), mu(G), Ss.at(gi), g(G(0)));
+	}
+    }
+
+    c = X * (g % mu);
+}
+
+
+// summaries of the change of a parameter block used by the convergence
+// criteria: sum |d|, max |d|, sum |old| and the number of elements
+static vec block_change(const vec &old, const vec &cur)
+{
+    const vec d = abs(old - cur);
+    return vec({ accu(d), d.n_elem ? d.max() : 0.0, accu(abs(old)),
+	    static_cast<double>(d.n_elem) });
+}
+
+
+// [[Rcpp::export]]
+SEXP block_create(const mat &X, const vec &y, const uvec &groups,
+	const double lambda, const double a0, const double b0, const vec &mu,
+	const vec &s, const vec &g, const bool diag_cov)
+{
+    linear_block *b = new linear_block(X, y, groups, lambda, a0, b0, mu, s,
+	    g, diag_cov);
+    return Rcpp::XPtr<linear_block>(b, true);
+}
+
+
+// The contribution of the block to the fit, used to form the initial fit
+// [[Rcpp::export]]
+Rcpp::List block_contribution(SEXP block)
+{
+    Rcpp::XPtr<linear_block> b(block);
+    return Rcpp::List::create(
+	Rcpp::Named("c") = b->c,
+	Rcpp::Named("r") = accu(b->r_k)
+    );
+}
+
+
+// Runs `sweeps` sweeps over the groups of the block against the residual
+// of the other blocks, y - (fit - c_k), with E[1/tau^2] held at e_tau.
+// Returns the new contribution of the block, the sum of its r_k and the
+// change of mu, s (v if the covariance is not diagonal) and g as the rows
+// of a 3 x 4 matrix, see block_change.
+// [[Rcpp::export]]
+Rcpp::List block_sweep(SEXP block, const vec &fit, const double e_tau,
+	const uword sweeps, const uword ordering)
+{
+    Rcpp::XPtr<linear_block> b(block);
+    linear_block &m = *b;
+
+    const vec yx = m.X.t() * (m.y - fit + m.c);
+    const vec mu_old = m.mu, g_old = m.g;
+    const vec s_old = m.diag_cov ? m.s : m.v;
+    uvec g_order = m.ugroups;
+
+    for (uword sweep = 0; sweep < sweeps; ++sweep)
+    {
+	if (ordering == 1) {
+	    g_order = arma::shuffle(m.ugroups);
+	} else if (ordering == 2) {
+	    vec beta_mag = vec(m.ugroups.n_elem, arma::fill::zeros);
+	    for (uword i = 0; i < m.ugroups.n_elem; ++i)
+		beta_mag(i) = arma::norm(m.mu(m.Gs.at(i)), 2);
+	    g_order = m.ugroups(sort_index(beta_mag, "descend"));
+	}
+
+	for (uword group : g_order)
+	{
+	    const uword gi = std::lower_bound(m.ugroups.begin(), 
+		    m.ugroups.end(), group) - m.ugroups.begin();
+	    const uvec &G = m.Gs.at(gi);
+	    const mat &xtx_GG = m.xtx_GG.at(gi);
+	    const auto X_G = m.X.cols(G(0), G(G.n_elem - 1));
+
+	    // the cross terms with the other groups of the block
+	    const vec gm_G_old = m.g(G) % m.mu(G);
+	    const vec yx_G = yx(G);
+	    const vec cross = X_G.t() * (m.c - X_G * gm_G_old);
+
+	    if (m.diag_cov) {
+		m.mu(G) = update_mu(xtx_GG, cross, yx_G, vec(m.mu(G)), 
+			vec(m.s(G)), e_tau, m.lambda);
+		m.s(G) = update_s(xtx_GG, vec(m.mu(G)), vec(m.s(G)), e_tau,
+			m.lambda);
+		const double tg = update_g(xtx_GG, cross, yx_G, vec(m.mu(G)),
+			vec(m.s(G)), e_tau, m.lambda, m.w);
+		m.g(G).fill(tg);
+		m.r_k(gi) = compute_r_k(xtx_GG, m.mu(G), m.s(G), tg);
+	    } else {
+		mat &S = m.Ss.at(gi);
+		m.mu(G) = update_mu(xtx_GG, cross, yx_G, vec(m.mu(G)), 
+			vec(sqrt(diagvec(S))), e_tau, m.lambda);
+		m.v(gi) = update_S(xtx_GG, vec(m.mu(G)), S, m.v(gi), e_tau, 
+			m.lambda, group_spectrum());
+		const double tg = update_g(xtx_GG, cross, yx_G, vec(m.mu(G)), 
+			S, log_det_cov(S), e_tau, m.lambda, m.w);
+		m.g(G).fill(tg);
+		m.r_k(gi) = compute_r_k(xtx_GG, m.mu(G), S, tg);
+	    }
+
+	    m.c += X_G * (m.g(G) % m.mu(G) - gm_G_old);
+	}
+    }
+
+    // recomputed so that rounding does not accumulate across sweeps
+    m.c = m.X * (m.g % m.mu);
+
+    mat change = mat(3, 4);
+    change.row(0) = block_change(mu_old, m.mu).t();
+    change.row(1) = block_change(s_old, m.diag_cov ? m.s : m.v).t();
+    change.row(2) = block_change(g_old, m.g).t();
+
+    const bool crossed = any((g_old > GSVB_CONV_GAMMA_THRESH) !=
+	    (m.g > GSVB_CONV_GAMMA_THRESH));
+
+    return Rcpp::List::create(
+	Rcpp::Named("c") = m.c,
+	Rcpp::Named("r") = accu(m.r_k),
+	Rcpp::Named("change") = change,
+	Rcpp::Named("crossed") = crossed
+    );
+}
+
+
+// [[Rcpp::export]]
+Rcpp::List block_state(SEXP block)
+{
+    Rcpp::XPtr<linear_block> b(block);
+    return Rcpp::List::create(
+	Rcpp::Named("mu") = b->mu,
+	Rcpp::Named("sigma") = b->s,
+	Rcpp::Named("gamma") = b->g,
+	Rcpp::Named("S") = b->Ss
+    );
+}
+
+
+// The tau update of fit_linear given the expected residual R
+// [[Rcpp::export]]
+vec linear_tau(const double tau_a0, const double tau_b0, const double R,
+	const double n)
+{
+    double tau_a = tau_a0, tau_b = tau_b0;
+    update_a_b(tau_a, tau_b, tau_a0, tau_b0, R, n);
+    return vec({ tau_a, tau_b });
+}
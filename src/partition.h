@@ -0,0 +1,54 @@
+#ifndef GSVB_PARTITION_H
+#define GSVB_PARTITION_H
+
+#include <vector>
+#include <algorithm>
+
+#include "gsvb_types.h"
+#include "linear.h"
+
+
+// A contiguous range of the groups of a linear model, owned by one worker
+// of gsvb.fit_partitioned and passed to R as an external pointer that
+// never leaves the worker process.
+//
+// The block holds its columns of X, the blocks X_G'X_G of the Gram matrix
+// of each of its groups, and the variational parameters of its groups. The
+// other blocks enter only through their fitted values, so each sweep 
+// exchanges the n-vector of the current fit X E[b] and returns the block's
+// contribution
+//   c_k := X_k (g_k o mu_k)
+// and the within group terms of the expected residual, sum_k r_k, see
+// compute_r_k. Within the block the cross terms of a group G with the 
+// others are X_G'(c_k - X_G (g o mu)_G), and c_k is updated after each
+// group, so the memory of a block is O(n p_k + sum |G|^2). The blocks are
+// updated in parallel from the same fit, i.e. a block-Jacobi schedule.
+struct linear_block
+{
+    linear_block(const mat &X, const vec &y, const uvec &groups,
+	    const double lambda, const double a0, const double b0,
+	    const vec &mu, const vec &s, const vec &g, const bool diag_cov);
+
+    // labels of the groups local to the block, and the columns of each,
+    // the groups are contiguous
+    const uvec groups;
+    const uvec ugroups;
+    std::vector<uvec> Gs;
+    const bool diag_cov;
+    const double lambda, w;
+
+    // variational parameters, g repeated for each coefficient of a group
+    vec mu, s, g;
+    std::vector<mat> Ss;
+    vec v;
+
+    // data, the Gram blocks X_G'X_G, the block's contribution to the fit
+    // and the r_k terms
+    const mat X;
+    const vec y;
+    std::vector<mat> xtx_GG;
+    vec c;
+    vec r_k;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "poisson.h"
+#include "model.h"
 
 #define GSVB_POS_MAXITS 8
 
@@ -6,32 +7,88 @@
 Rcpp::List fit_poisson(vec y, mat X, uvec groups, const double lambda, 
     const double a0, const double b0, vec mu, vec s, vec g, 
     const bool diag_cov, bool track_elbo, const uword track_elbo_every, 
-    const uword track_elbo_mcn, unsigned int niter, double tol, bool verbose)
+    const uword track_elbo_mcn, const double track_elbo_tol,
+    const uword track_elbo_max, unsigned int niter, double tol, 
+    const uvec convergence, const uword convergence_k, bool verbose,
+    const double compact, const Rcpp::List control)
 {
+    GSVB_PROFILE_FIT();
+    GSVB_PROFILE_SETUP();
+    GSVB_MEMORY_FIT();
+
+    // the model holds the data, XX, P and the Cholesky factors
+    const fit_control ctl(control);
+    std::unique_ptr<gsvb_model> m(new gsvb_model(groups, 5, diag_cov, lambda,
+	    a0, b0, 0.0, 0.0, X.n_rows));
+    m->X = std::move(X);
+    m->y = std::move(y);
+    m->yX = m->X.t() * m->y;
+
+    GSVB_PROFILE_SETUP_END();
+
+    Rcpp::List f = fit_poisson_model(*m, mu, s, g, track_elbo, 
+	    track_elbo_every, track_elbo_mcn, track_elbo_tol, track_elbo_max, 
+	    niter, tol, convergence, convergence_k, verbose, compact, control);
+
+    if (ctl.model)
+	f.push_back(Rcpp::XPtr<gsvb_model>(m.release(), true), "model");
+    return f;
+}
+
+
+// Fit the model from the data held by m, P and the factors are reused if 
+// m holds them, used to warm restart a fit
+Rcpp::List fit_poisson_model(gsvb_model &m, vec mu, vec s, vec g, 
+    bool track_elbo, const uword track_elbo_every, 
+    const uword track_elbo_mcn, const double track_elbo_tol,
+    const uword track_elbo_max, unsigned int niter, double tol, 
+    const uvec convergence, const uword convergence_k, bool verbose,
+    const double compact, const Rcpp::List &control)
+{
+    GSVB_PROFILE_FIT();
+    GSVB_PROFILE_SETUP();
+    GSVB_MEMORY_FIT();
+
+    fit_control ctl(control);
+    const mat &X = m.X;
+    const vec &y = m.y;
+    const uvec &groups = m.groups;
+    const bool diag_cov = m.diag_cov;
+    const double lambda = m.lambda;
+
+    // the cached expressions are for the state of m, they are invalid
+    // while it is updated
+    const bool cached = m.cache == 5;
+    m.cache = 0;
+
     const uvec ugroups = arma::unique(groups);
-    const double w = a0 / (a0 + b0);
-    const vec yX = X.t() * y;
+    const double w = m.a0 / (m.a0 + m.b0);
+    const vec &yX = m.yX;
     
     // init
     vec mu_old, s_old, g_old;
-    mat XX;
-    vec P;
+    mat &XX = m.XX;
+    vec &P = m.P;
     s_old = s; // init s_old
 
     // only used for diag_cov = FALSE
     std::vector<mat> Ss;
-    std::vector<mat> Us;
+    std::vector<mat> &Us = m.Us;
 
-    if (diag_cov) {
-	XX = X % X;
+    if (cached) {
+	Ss = m.Ss;
+    } else if (diag_cov) {
+	if (XX.is_empty()) XX = X % X;
 	P = compute_P(X, XX, mu, s, g, groups);
     } else {
+	Us.clear();
 
 	// populate the covariance matrices and chol decompositions
 	for (uword i = 0; i < ugroups.size(); ++i) {
 	    uvec G  = arma::find(groups == ugroups(i));
 
-	    mat S = arma::diagmat(s(G) % s(G));
+	    mat S = ctl.Ss.empty() ? mat(arma::diagmat(s(G) % s(G))) : 
+		ctl.Ss.at(i);
 
 	    if (S.n_cols != 1) {
 		uvec upper_indices = trimatu_ind( size(S), 1 );
@@ -64,11 +121,80 @@ Rcpp::List fit_poisson(vec y, mat X, uvec groups, const double lambda,
 	}
     }
 
+    // bookkeeping for the ELBO, closed form contribution of each group and 
+    // Jensen's bound of the Monte-Carlo part, which is evaluated off the 
+    // main thread
+    const uword M = ugroups.size();
+    const double lgy = accu(lgamma(y + 1));
+    convergence_monitor conv(convergence, tol, convergence_k);
+    const bool track_elbo_k = track_elbo || conv.needs_elbo();
+
+    vec elbo_k = vec(M, arma::fill::zeros);
+    vec bound_k = vec(M, arma::fill::zeros);
+    std::unique_ptr<elbo_worker> elbo_eval;
+
+    if (track_elbo)
+	elbo_eval.reset(new elbo_worker(groups, lambda, track_elbo_mcn, 
+		    track_elbo_tol, track_elbo_max, m.rng()));
+
+    if (track_elbo_k) {
+	for (uword i = 0; i < M; ++i) {
+	    uvec G  = arma::find(groups == ugroups(i));
+	    if (diag_cov) {
+		elbo_group_refresh(elbo_k, bound_k, i, mu(G), s(G), g(G(0)), w,
+			lambda);
+	    } else {
+		elbo_group_refresh(elbo_k, bound_k, i, mu(G), Ss.at(i), g(G(0)), 
+			w, lambda);
+	    }
+	}
+    }
+
+    // mu, s, g, their previous values and yX
+    gsvb_memory_.record("X", X);
+    gsvb_memory_.record("XX", XX);
+    gsvb_memory_.record("Ss", Ss);
+    gsvb_memory_.record("Us", Us);
+    gsvb_memory_.record("P", P);
+    gsvb_memory_.record("state", 7.0 * sizeof(double) * mu.n_elem);
+
+    // the copies of the columns of a group, and their squares, made by the
+    // updates
+    uword m_max = 0;
+    for (uword group : ugroups)
+	m_max = std::max<uword>(m_max, accu(groups == group));
+    gsvb_memory_.temporary("X_G", (diag_cov ? 2.0 : 1.0) * sizeof(double) *
+	    X.n_rows * m_max);
+
+    GSVB_PROFILE_SETUP_END();
+
     uword num_iter = niter;
-    std::vector<double> elbo_values;
+    std::vector<double> elbo_values = ctl.elbo;
+    std::vector<double> elbo_se = ctl.elbo_se;
     bool converged = false;
-
-    for (unsigned int iter = 1; iter <= niter; ++iter)
+    uword converged_by = 0;
+    uword stopped_by = 0;
+
+    // state written to the checkpoints, Us is refactored on resume
+    auto state = [&]() -> fit_checkpoint {
+	fit_checkpoint c;
+	if (track_elbo) elbo_eval->finish(elbo_values, elbo_se);
+	c.mu = mu; c.s = s; c.g = g; c.Ss = Ss;
+	c.tau_a = c.tau_b = NAN;
+	c.elbo = elbo_values; c.elbo_se = elbo_se;
+	return c;
+    };
+
+    // elbo and active set reported to the progress callback
+    auto progress = [&]() -> fit_progress {
+	fit_progress info;
+	info.elbo = NA_REAL;
+	if (track_elbo) elbo_eval->latest(info.elbo);
+	info.active = count_active(g, groups);
+	return info;
+    };
+
+    for (unsigned int iter = ctl.start + 1; iter <= niter; ++iter)
     {
 	mu_old = mu; g_old = g;
 
@@ -78,6 +204,7 @@ Rcpp::List fit_poisson(vec y, mat X, uvec groups, const double lambda,
 	for (uword i = 0; i < ugroups.size(); ++i)
 	{
 	    uvec G  = arma::find(groups == ugroups(i));
+	    GSVB_PROFILE_GROUP(i);
 
 	    if (diag_cov) 
 	    {
@@ -90,6 +217,9 @@ Rcpp::List fit_poisson(vec y, mat X, uvec groups, const double lambda,
 		for (uword j : G) g(j) = tg;
 
 		P %= compute_P_G(X, XX, mu, s, g, G);
+
+		if (track_elbo_k)
+		    elbo_group_refresh(elbo_k, bound_k, i, mu(G), s(G), tg, w, lambda);
 	    } 
 	    else 
 	    {
@@ -108,25 +238,34 @@ Rcpp::List fit_poisson(vec y, mat X, uvec groups, const double lambda,
 
 		P %= compute_P_G_chol(X.cols(G), mu(G), U, tg);
 		s(G) = diagvec(U);
+
+		if (track_elbo_k)
+		    elbo_group_refresh(elbo_k, bound_k, i, mu(G), S, tg, w, lambda);
 	    }
+
+	    if (track_elbo) elbo_eval->mark(i);
 	}
 
-	if (track_elbo && (iter % track_elbo_every == 0)) {
-	    double e = diag_cov ? 
-		elbo_poisson(y, X, groups, mu, s, g, P, lambda, w, track_elbo_mcn) :
-		elbo_poisson_S(y, X, groups, mu, Us, g, P, lambda, w, track_elbo_mcn);
+	// record the ELBO, the expected log-likelihood is available through P
+	const double elbo_det = track_elbo_k ? 
+	    dot(yX, g % mu) - accu(P) - lgy + accu(elbo_k) : 0.0;
 
-	    elbo_values.push_back(e);
+	if (track_elbo && (iter % track_elbo_every == 0)) {
+	    GSVB_PROFILE_SCOPE(GSVB_PHASE_ELBO);
+	    elbo_eval->submit(elbo_det, mu, s, Ss, g);
 	}
+
+	GSVB_PROFILE_SWEEP();
 	
-	// check for break, print iter
-	Rcpp::checkUserInterrupt();
+	// progress, checkpoint, check for break, print iter
+	stopped_by = ctl.end_sweep(iter, state, progress);
 	if (verbose) Rcpp::Rcout << iter;
 	
 	// check convergence
-	if (sum(abs(mu_old - mu)) < tol &&
-	    sum(abs(s_old  - s))  < tol &&
-	    sum(abs(g_old  - g))  < tol) 
+	converged_by = conv.check(mu_old, mu, s_old, s, g_old, g, 
+		elbo_det - accu(bound_k));
+
+	if (converged_by) 
 	{
 	    if (verbose)
 		Rcpp::Rcout << "\nConverged in " << iter << " iterations\n";
@@ -135,24 +274,50 @@ Rcpp::List fit_poisson(vec y, mat X, uvec groups, const double lambda,
 	    converged = true;
 	    break;
 	}
+
+	if (stopped_by)
+	{
+	    if (verbose)
+		Rcpp::Rcout << "\nStopped after " << iter << " iterations\n";
+
+	    num_iter = iter;
+	    break;
+	}
     }
     
     // compute elbo for final eval
     if (track_elbo) {
-	double e = diag_cov ? 
-	    elbo_poisson(y, X, groups, mu, s, g, P, lambda, w, track_elbo_mcn) :
-	    elbo_poisson_S(y, X, groups, mu, Us, g, P, lambda, w, track_elbo_mcn);
-	elbo_values.push_back(e);
+	GSVB_PROFILE_SCOPE(GSVB_PHASE_ELBO);
+	elbo_eval->submit(dot(yX, g % mu) - accu(P) - lgy + accu(elbo_k), 
+		mu, s, Ss, g);
+	elbo_eval->finish(elbo_values, elbo_se);
+	gsvb_memory_.record("elbo_queue", elbo_eval->peak_bytes());
+    }
+
+    if (ctl.model) {
+	m.set_state(mu, s, Ss, vec(), g, 0.0, 0.0);
+	m.cache = 5;
     }
 
+    // drop the inactive groups
+    uvec active = ugroups;
+    if (compact > 0)
+	active = compact_state(mu, s, Ss, g, groups, compact);
+
     return Rcpp::List::create(
+	Rcpp::Named("active") = active,
 	Rcpp::Named("mu") = mu,
 	Rcpp::Named("sigma") = s,
 	Rcpp::Named("gamma") = g,
 	Rcpp::Named("S") = Ss,
 	Rcpp::Named("converged") = converged,
+	Rcpp::Named("converged_by") = converged_by,
+	Rcpp::Named("stopped_by") = stopped_by,
 	Rcpp::Named("iterations") = num_iter,
-	Rcpp::Named("elbo") = elbo_values
+	Rcpp::Named("elbo") = elbo_values,
+	Rcpp::Named("elbo_se") = elbo_se,
+	Rcpp::Named("profile") = GSVB_PROFILE_RESULT(),
+	Rcpp::Named("memory") = gsvb_memory_.result()
     );
 }
 
@@ -202,12 +367,13 @@ class pois_update_mu_fn
 vec pois_update_mu(const vec &yX, const mat &X, const mat &XX, const vec &mu,
 	const vec &s, const double lambda, const uvec &G, const vec &P)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_MU);
     ens::L_BFGS opt;
     opt.MaxIterations() = GSVB_POS_MAXITS;
     pois_update_mu_fn fn(yX, X, XX, s, lambda, G, P);
 
     arma::vec mG = mu(G);
-    opt.Optimize(fn, mG);
+    GSVB_OPTIMIZE(opt, fn, mG);
 
     return mG;
 }
@@ -259,12 +425,13 @@ class pois_update_s_fn
 vec pois_update_s(const mat &X, const mat &XX, const vec &mu, const vec &s,
 	const double lambda, const uvec &G, const vec &P)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_S);
     ens::L_BFGS opt;
     opt.MaxIterations() = GSVB_POS_MAXITS;
     pois_update_s_fn fn(X, XX, mu, lambda, G, P);
 
     arma::vec u = log(s(G));
-    opt.Optimize(fn, u);
+    GSVB_OPTIMIZE(opt, fn, u);
 
     return exp(u);
 }
@@ -275,6 +442,7 @@ double pois_update_g(const vec &yX, const mat &X, const mat &XX, const vec &mu,
 	const vec &s, const double lambda, const double w, const uvec &G, 
 	const vec &P)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_G);
     const double mk = G.size();
     const double Ck = mk * log(2.0) + 0.5*(mk-1.0)*log(M_PI) + 
 	lgamma(0.5*(mk + 1.0));
@@ -298,64 +466,58 @@ double pois_update_g(const vec &yX, const mat &X, const mat &XX, const vec &mu,
 // ---------------------------------------
 // ELBO
 // ---------------------------------------
+// E_Q [ lambda * || b_{G_k} || ] is estimated by Monte-Carlo integration.
+// Samples are drawn in batches of mcn until the std. error is below mc_tol,
+// or mc_max samples are drawn. Returns the ELBO and its std. error.
+//
 // [[Rcpp::export]]
-double elbo_poisson(const vec &y, const mat &X, const uvec &groups,
+vec elbo_poisson(const vec &y, const mat &X, const uvec &groups,
 	const vec &mu, const vec &s, const vec &g, const double lambda, 
-	const double w, const uword mcn)
+	const double w, const uword mcn, const double mc_tol, const uword mc_max)
 {
     const mat &XX = X % X;
     const vec P = compute_P(X, XX, mu, s, g, groups);
-    double res = elbo_poisson(y, X, groups, mu, s, g, P, lambda, w, mcn);
+    vec res = elbo_poisson(y, X, groups, mu, s, g, P, lambda, w, mcn, 
+	    mc_tol, mc_max);
 
     return(res);
 }
 
 
-double elbo_poisson(const vec &y, const mat &X, const uvec &groups,
+vec elbo_poisson(const vec &y, const mat &X, const uvec &groups,
 	const vec &mu, const vec &s, const vec &g, const vec &P,
-	const double lambda, const double w, const uword mcn)
+	const double lambda, const double w, const uword mcn,
+	const double mc_tol, const uword mc_max)
 {
     double res = 0.0;
     uvec ugroups = arma::unique(groups);
     
     res += dot(y, (X * (mu % g))) - accu(P) - accu(lgamma(y + 1));
 
-    // noramlizing consts
+    // noramlizing consts, entropy and KL(g || w)
+    std::vector<uvec> Gs;
     for (uword group : ugroups) 
     {
 	uvec G = find(groups == group);
 	uword k = G(0);
+	Gs.push_back(G);
 
-	double mk = G.size();
-	double Ck = -mk*log(2.0) - 0.5*(mk-1.0)*log(M_PI) - lgamma(0.5*(mk+1));
-
-	res += g(k) * Ck +
-	    0.5 * g(k) * mk +
-	    g(k) * mk * log(lambda) -
-	    g(k) * log((1e-8 + g(k)) / (1e-8 + w)) -	// add 1e-8 to prevent -Inf
-	    (1 - g(k)) * log((1-g(k) + 1e-8) / (1 - w));
+	res += elbo_group(G.size(), g(k), w, lambda, accu(log(s(G) % s(G))));
     }
 
     // monte carlo integral for intractable terms
-    double mci = 0.0;
-    vec beta = vec(mu.n_rows, arma::fill::zeros);
-
-    for (uword iter = 0; iter < mcn; ++iter) {
-	for (uword group : ugroups)
-	{
-	    uvec G = find(groups == group);
-	    uword k = G(0);
-	    double mk = G.size();
-
-	    // Compute the Monte-Carlo integral of E_Q [ lambda * || b_{G_k} || ]
-	    vec beta_G = arma::randn(mk) % s(G) + mu(G);
-	    mci -= lambda * g(k) * norm(beta_G, 2);
+    // Compute the Monte-Carlo integral of E_Q [ lambda * || b_{G_k} || ]
+    const vec mci = mc_integrate([&]() -> double {
+	double r = 0.0;
+	for (const uvec &G : Gs) {
+	    vec beta_G = arma::randn(G.size()) % s(G) + mu(G);
+	    r -= lambda * g(G(0)) * norm(beta_G, 2);
 	}
-    }
-    mci = mci / static_cast<double>(mcn);
-    res += mci;
+	return r;
+    }, mcn, mc_tol, mc_max);
 
-    return(res);
+    vec elbo = { res + mci(0), mci(1) };
+    return(elbo);
 }
 
 
@@ -431,13 +593,14 @@ class pois_update_mu_fn_S
 vec pois_update_mu_S(const vec &yX_G, const mat &X_G, const vec &mu_G,
 	const mat &U, const double lambda, const vec &P)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_MU);
     ens::L_BFGS opt;
     opt.MaxIterations() = GSVB_POS_MAXITS;
     // opt.MaxIterations() = 1000;
     pois_update_mu_fn_S fn(yX_G, X_G, U, lambda, P);
 
     arma::vec mG = mu_G;
-    opt.Optimize(fn, mG);
+    GSVB_OPTIMIZE(opt, fn, mG);
 
     return mG;
 }
@@ -499,7 +662,7 @@ class pois_update_U_fn
 	    const vec PP = P % mvnMGF_chol(X_G, mu_G, U);
 
 	    double res = accu(PP) -
-		0.5 * log(det(S)) +
+		0.5 * log_det_cov(S) +
 		lambda * pow(ds + dot(mu_G, mu_G), 0.5);
 
 	    mat Pgrad = mat(size(U), arma::fill::zeros);
@@ -534,13 +697,14 @@ class pois_update_U_fn
 vec pois_update_U(const mat &X_G, const vec &mu_G, const mat &U,
 	const double lambda, const vec &P)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_S);
     ens::L_BFGS opt;
     opt.MaxIterations() = GSVB_POS_MAXITS;
     // opt.MaxIterations() = 1000;
     pois_update_U_fn fn(X_G, mu_G, lambda, P);
 
     arma::vec ug = U(trimatu_ind(size(U)));
-    opt.Optimize(fn, ug);
+    GSVB_OPTIMIZE(opt, fn, ug);
 
     return ug;
 }
@@ -552,6 +716,7 @@ double pois_update_g_S(const vec &yX_G, const mat &X_G, const vec &mu_G,
 	const mat &U, const mat &S, const double lambda, const double w,
 	const vec &P)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_G);
     const double mk = X_G.n_cols;
     const double Ck = mk * log(2.0) + 0.5*(mk-1.0)*log(M_PI) + 
 	lgamma(0.5*(mk + 1.0));
@@ -565,7 +730,7 @@ double pois_update_g_S(const vec &yX_G, const mat &X_G, const vec &mu_G,
 	0.5 * mk - 
 	Ck +
 	mk * log(lambda) +
-	0.5 * log(det(2.0 * M_PI * S)) -
+	0.5 * (mk * log(2.0 * M_PI) + log_det_cov(S)) -
 	lambda * sqrt(ds + dot(mu_G, mu_G)) +
 	dot(yX_G, mu_G) -
 	sum(P % (P1 - 1));
@@ -575,66 +740,60 @@ double pois_update_g_S(const vec &yX_G, const mat &X_G, const vec &mu_G,
 
 
 // [[Rcpp::export]]
-double elbo_poisson_S(const vec &y, const mat &X, const uvec &groups,
+vec elbo_poisson_S(const vec &y, const mat &X, const uvec &groups,
 	const vec &mu, const std::vector<mat> &Ss, const vec &g, 
-	const double lambda, const double w, const uword mcn)
+	const double lambda, const double w, const uword mcn,
+	const double mc_tol, const uword mc_max)
 {
     std::vector<mat> Us;
     for (mat S : Ss) {
 	Us.push_back(chol(S, "upper"));
     }
     const vec P = compute_P_chol(X, mu, Us, g, groups);
-    double res = elbo_poisson_S(y, X, groups, mu, Us, g, P, lambda, w, mcn);
+    vec res = elbo_poisson_S(y, X, groups, mu, Us, g, P, lambda, w, mcn,
+	    mc_tol, mc_max);
 
     return(res);
 }
 
 
-double elbo_poisson_S(const vec &y, const mat &X, const uvec &groups,
+vec elbo_poisson_S(const vec &y, const mat &X, const uvec &groups,
 	const vec &mu, const std::vector<mat> &Us, const vec &g, 
-	const vec &P, const double lambda, const double w, const uword mcn)
+	const vec &P, const double lambda, const double w, const uword mcn,
+	const double mc_tol, const uword mc_max)
 {
     double res = 0.0;
     uvec ugroups = arma::unique(groups);
     
     res += dot(y, (X * (mu % g))) - accu(P) - accu(lgamma(y + 1));
 
-    // noramlizing consts
-    for (uword group : ugroups) 
+    // noramlizing consts, entropy and KL(g || w)
+    // log det S = 2 S_i log |U_ii|
+    std::vector<uvec> Gs;
+    for (uword gi = 0; gi < ugroups.size(); ++gi)
     {
-	uvec G = find(groups == group);
+	uvec G = find(groups == ugroups(gi));
 	uword k = G(0);
+	Gs.push_back(G);
 
-	double mk = G.size();
-	double Ck = -mk*log(2.0) - 0.5*(mk-1.0)*log(M_PI) - lgamma(0.5*(mk+1));
-
-	res += g(k) * Ck +
-	    0.5 * g(k) * mk +
-	    g(k) * mk * log(lambda) -
-	    g(k) * log((1e-8 + g(k)) / (1e-8 + w)) -	// add 1e-8 to prevent -Inf
-	    (1 - g(k)) * log((1-g(k) + 1e-8) / (1 - w));
+	const double ldet = 2.0 * accu(log(abs(diagvec(Us.at(gi)))));
+	res += elbo_group(G.size(), g(k), w, lambda, ldet);
     }
 
     // monte carlo integral for intractable terms
-    double mci = 0.0;
-    vec beta = vec(mu.n_rows, arma::fill::zeros);
-
-    for (uword iter = 0; iter < mcn; ++iter) {
-	for (uword gi = 0; gi < ugroups.size(); ++gi)
-	{
-	    uvec G = find(groups == ugroups(gi));
-	    uword k = G(0);
-	    double mk = G.size();
-
-	    // Compute the Monte-Carlo integral of E_Q [ lambda * || b_{G_k} || ]
-	    vec beta_G = Us.at(gi) * arma::randn(mk) + mu(G);
-	    mci -= lambda * g(k) * norm(beta_G, 2);
+    // Compute the Monte-Carlo integral of E_Q [ lambda * || b_{G_k} || ]
+    const vec mci = mc_integrate([&]() -> double {
+	double r = 0.0;
+	for (uword gi = 0; gi < Gs.size(); ++gi) {
+	    const uvec &G = Gs.at(gi);
+	    vec beta_G = Us.at(gi).t() * arma::randn(G.size()) + mu(G);
+	    r -= lambda * g(G(0)) * norm(beta_G, 2);
 	}
-    }
-    mci = mci / static_cast<double>(mcn);
-    res += mci;
+	return r;
+    }, mcn, mc_tol, mc_max);
 
-    return(res);
+    vec elbo = { res + mci(0), mci(1) };
+    return(elbo);
 }
 
 
@@ -2,11 +2,33 @@
 #define GSVB_FIT_POISSON_H
 
 #include <vector>
+#include <memory>
 
 #include "RcppEnsmallen.h"
 
 #include "gsvb_types.h"
 #include "utils.h"
+#include "async.h"
+#include "convergence.h"
+#include "memory.h"
+#include "control.h"
+
+Rcpp::List fit_poisson(vec y, mat X, uvec groups, const double lambda, 
+    const double a0, const double b0, vec mu, vec s, vec g, 
+    const bool diag_cov, bool track_elbo, const uword track_elbo_every, 
+    const uword track_elbo_mcn, const double track_elbo_tol,
+    const uword track_elbo_max, unsigned int niter, double tol, 
+    const uvec convergence, const uword convergence_k, bool verbose,
+    const double compact, const Rcpp::List control);
+
+struct gsvb_model;
+
+Rcpp::List fit_poisson_model(gsvb_model &m, vec mu, vec s, vec g, 
+    bool track_elbo, const uword track_elbo_every, 
+    const uword track_elbo_mcn, const double track_elbo_tol,
+    const uword track_elbo_max, unsigned int niter, double tol, 
+    const uvec convergence, const uword convergence_k, bool verbose,
+    const double compact, const Rcpp::List &control);
 
 // func for diag cov S
 vec pois_update_mu(const vec &yX, const mat &X, const mat &XX, const vec &mu,
@@ -31,13 +53,25 @@ double pois_update_g_S(const vec &yX_G, const mat &X_G, const vec &mu_G,
 	const mat &U, const mat &S, const double lambda, const double w,
 	const vec &P);
 
-// ELBO
-double elbo_poisson(const vec &y, const mat &X, const uvec &groups,
+// ELBO, returns the estimate and the Monte-Carlo std. error
+vec elbo_poisson(const vec &y, const mat &X, const uvec &groups,
 	const vec &mu, const vec &s, const vec &g, const vec &P,
-	const double lambda, const double w, const uword mcn);
+	const double lambda, const double w, const uword mcn,
+	const double mc_tol, const uword mc_max);
 
-double elbo_poisson_S(const vec &y, const mat &X, const uvec &groups,
+vec elbo_poisson_S(const vec &y, const mat &X, const uvec &groups,
 	const vec &mu, const std::vector<mat> &Us, const vec &g, 
-	const vec &P, const double lambda, const double w, const uword mcn);
+	const vec &P, const double lambda, const double w, const uword mcn,
+	const double mc_tol, const uword mc_max);
+
+vec elbo_poisson(const vec &y, const mat &X, const uvec &groups,
+	const vec &mu, const vec &s, const vec &g, const double lambda, 
+	const double w, const uword mcn, const double mc_tol, 
+	const uword mc_max);
+
+vec elbo_poisson_S(const vec &y, const mat &X, const uvec &groups,
+	const vec &mu, const std::vector<mat> &Ss, const vec &g, 
+	const double lambda, const double w, const uword mcn, 
+	const double mc_tol, const uword mc_max);
 
 #endif
@@ -0,0 +1,223 @@
+#include "predict.h"
+
+// number of samples of beta in a block, a multiple of GSVB_SAMPLE_CHUNK
+#define GSVB_PREDICT_BLOCK (4 * GSVB_SAMPLE_CHUNK)
+
+// number of rows of X processed by a single task
+#define GSVB_PREDICT_ROWS 1024
+
+
+// draw from the posterior predictive given the linear predictor xb
+template <typename RNG>
+double predict_response(const uword family, const double xb, 
+	const double sigma, RNG &rng, std::student_t_distribution<double> &rt)
+{
+    if (family == 1)
+	return xb + sigma * rt(rng);
+
+    if (family == 5) {
+	const double lambda = exp(xb);
+	if (!(lambda > 0)) return 0.0;
+	if (!(lambda < 1e18)) return lambda;
+	std::poisson_distribution<long long> rpois(lambda);
+	return static_cast<double>(rpois(rng));
+    }
+
+    return 1.0 / (1.0 + exp(-xb));
+}
+
+
+// Sample from the posterior predictive distribution without storing the
+// samples.
+//
+// Samples of beta are drawn in blocks as sparse matrices and only the 
+// columns of X of the groups active in a sample are used to compute the
+// linear predictor. The mean of each row is accumulated online and the 
+// quantiles are estimated with P^2 sketches, so memory is O(n) regardless
+// of the number of samples, unless keep_samples = TRUE.
+//
+// [[Rcpp::export]]
+Rcpp::List predict_stream(const mat &X, const vec &mu, const vec &s,
+	const std::vector<mat> &Ss, const vec &g, const uvec &groups, 
+	const bool diag_cov, const uword family, const double tau_a, 
+	const double tau_b, const uword samples, const vec &probs, 
+	const bool keep_samples, const unsigned int seed)
+{
+    const beta_sampler sampler(mu, s, Ss, g, groups, diag_cov);
+
+    return predict_sampler(sampler, X, family, tau_a, tau_b, samples, probs,
+	    keep_samples, seed);
+}
+
+
+// streaming posterior predictive given a sampler, see predict_stream
+Rcpp::List predict_sampler(const beta_sampler &sampler, const mat &X,
+	const uword family, const double tau_a, const double tau_b, 
+	const uword samples, const vec &probs, const bool keep_samples, 
+	const unsigned int seed)
+{
+    const uword n = X.n_rows;
+    const uword nq = probs.n_elem;
+    const uword n_tasks = (n + GSVB_PREDICT_ROWS - 1) / GSVB_PREDICT_ROWS;
+
+    // only used for the linear model
+    const double sigma = family == 1 ? sqrt(tau_b / tau_a) : 0.0;
+    const double df = family == 1 ? 2.0 + tau_a : 1.0;
+
+    vec y_mean = vec(n, arma::fill::zeros);
+    std::vector<p2_quantile> sketches;
+    sketches.reserve(n * nq);
+    for (uword i = 0; i < n; ++i)
+	for (uword q = 0; q < nq; ++q)
+	    sketches.push_back(p2_quantile(probs(q)));
+
+    mat y_star = keep_samples ? mat(n, samples) : mat();
+
+    for (uword j0 = 0, b = 0; j0 < samples; j0 += GSVB_PREDICT_BLOCK, ++b)
+    {
+	const uword j1 = std::min<uword>(samples, j0 + GSVB_PREDICT_BLOCK);
+	const uword nb = j1 - j0;
+
+	// CSC representation of the block, read by all threads
+	sp_mat B = sampler.sample(seed, j0, j1);
+	B.sync();
+	const uword *col_ptrs = B.col_ptrs;
+	const uword *row_indices = B.row_indices;
+	const double *values = B.values;
+
+	#pragma omp parallel for schedule(dynamic)
+	for (uword t = 0; t < n_tasks; ++t)
+	{
+	    const uword r0 = t * GSVB_PREDICT_ROWS;
+	    const uword r1 = std::min<uword>(n, r0 + GSVB_PREDICT_ROWS);
+
+	    std::seed_seq sseq{ seed, static_cast<unsigned int>(b), 
+		static_cast<unsigned int>(t), 1u };
+	    std::mt19937_64 rng(sseq);
+	    std::student_t_distribution<double> rt(df);
+
+	    // linear predictor, only the active columns of X are used
+	    mat xb = mat(r1 - r0, nb, arma::fill::zeros);
+	    for (uword j = 0; j < nb; ++j)
+		for (uword k = col_ptrs[j]; k < col_ptrs[j + 1]; ++k)
+		    xb.col(j) += values[k] * X.col(row_indices[k]).subvec(r0, r1 - 1);
+
+	    for (uword j = 0; j < nb; ++j) 
+	    {
+		for (uword i = r0; i < r1; ++i) 
+		{
+		    const double y = predict_response(family, xb(i - r0, j), 
+			    sigma, rng, rt);
+
+		    y_mean(i) += (y - y_mean(i)) / (j0 + j + 1.0);
+		    for (uword q = 0; q < nq; ++q) 
+			sketches[i * nq + q].add(y);
+
+		    if (keep_samples) y_star(i, j0 + j) = y;
+		}
+	    }
+	}
+
+	Rcpp::checkUserInterrupt();
+    }
+
+    mat y_quantiles = mat(nq, n);
+    for (uword i = 0; i < n; ++i)
+	for (uword q = 0; q < nq; ++q)
+	    y_quantiles(q, i) = sketches[i * nq + q].quantile();
+
+    Rcpp::List res = Rcpp::List::create(
+	Rcpp::Named("mean") = y_mean,
+	Rcpp::Named("quantiles") = y_quantiles
+    );
+
+    if (keep_samples)
+	res["samples"] = y_star;
+
+    return res;
+}
+
+
+// Closed form moments of the posterior predictive distribution.
+//
+// Under the variational posterior x'b is a sum of independent group terms,
+// where group k contributes x_G'b_G ~ g_k N(c_k, v_k) + (1 - g_k) delta_0 
+// with c_k = x_G'mu_G and v_k = x_G'S_G x_G. Hence
+//   linear:   E[y] = S_k g_k c_k,
+//	       V[y] = S_k g_k (v_k + c_k^2) - g_k^2 c_k^2 + E[tau^2]
+//   poisson:  E[y] = P(x), the product of the group mixture MGFs computed
+//	       by compute_P_G as in the fit, and V[y] = P(x) + P(2x) - P(x)^2
+//   binomial: the probit approximation, E[y] = sigmoid(m / sqrt(1 + pi v/8))
+//	       where m and v are the mean and variance of x'b
+//
+// g are the group inclusion probabilities.
+//
+// [[Rcpp::export]]
+Rcpp::List predict_moments(const mat &X, const vec &mu, const vec &s,
+	const std::vector<mat> &Ss, const vec &g, const uvec &groups, 
+	const bool diag_cov, const uword family, const double tau_a, 
+	const double tau_b)
+{
+    const uword n = X.n_rows;
+    const uvec ugroups = arma::unique(groups);
+
+    vec m = vec(n, arma::fill::zeros);	// E[x'b]
+    vec v = vec(n, arma::fill::zeros);	// V[x'b]
+    vec P = vec(n, arma::fill::ones);	// E[exp(x'b)]
+    vec P2 = vec(n, arma::fill::ones);	// E[exp(2 x'b)]
+
+    for (uword k = 0; k < ugroups.n_elem; ++k)
+    {
+	const double gk = g(k);
+	if (gk == 0.0) continue;
+
+	const uvec G = arma::find(groups == ugroups(k));
+	const mat X_G = X.cols(G);
+	const mat XX_G = diag_cov ? mat(X_G % X_G) : mat();
+
+	if (family == 5) {
+	    // the MGF at 2x is that at x of 2 X_G
+	    if (diag_cov) {
+		P  %= compute_P_G(X_G, XX_G, mu(G), s(G), gk);
+		P2 %= compute_P_G(2.0 * X_G, 4.0 * XX_G, mu(G), s(G), gk);
+	    } else {
+		P  %= compute_P_G(X_G, mu(G), Ss.at(k), gk);
+		P2 %= compute_P_G(2.0 * X_G, mu(G), Ss.at(k), gk);
+	    }
+	    continue;
+	}
+
+	const vec c = X_G * mu(G);
+	const vec q = diag_cov ? mvn_quad(XX_G, vec(s(G))) : 
+	    mvn_quad(X_G, Ss.at(k));
+
+	m += gk * c;
+	v += gk * (q + c % c) - gk * gk * (c % c);
+    }
+
+    vec y_mean, y_var;
+
+    if (family == 1) 
+    {
+	// E[tau^2] of the inverse-Gamma(tau_a, tau_b) posterior
+	const double e_tau2 = tau_a > 1.0 ? tau_b / (tau_a - 1.0) : 
+	    arma::datum::inf;
+	y_mean = m;
+	y_var = v + e_tau2;
+    } 
+    else if (family == 5) 
+    {
+	y_mean = P;
+	y_var = P + P2 - P % P;
+    } 
+    else 
+    {
+	y_mean = 1.0 / (1.0 + exp(-m / sqrt(1.0 + M_PI * v / 8.0)));
+	y_var = y_mean % (1.0 - y_mean);
+    }
+
+    return Rcpp::List::create(
+	Rcpp::Named("mean") = y_mean,
+	Rcpp::Named("var") = y_var
+    );
+}
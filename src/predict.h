@@ -0,0 +1,33 @@
+#ifndef GSVB_PREDICT_H
+#define GSVB_PREDICT_H
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "gsvb_types.h"
+#include "sample.h"
+#include "quantile.h"
+#include "utils.h"
+
+Rcpp::List predict_stream(const mat &X, const vec &mu, const vec &s,
+	const std::vector<mat> &Ss, const vec &g, const uvec &groups, 
+	const bool diag_cov, const uword family, const double tau_a, 
+	const double tau_b, const uword samples, const vec &probs, 
+	const bool keep_samples, const unsigned int seed);
+
+Rcpp::List predict_sampler(const beta_sampler &sampler, const mat &X,
+	const uword family, const double tau_a, const double tau_b, 
+	const uword samples, const vec &probs, const bool keep_samples, 
+	const unsigned int seed);
+
+Rcpp::List predict_moments(const mat &X, const vec &mu, const vec &s,
+	const std::vector<mat> &Ss, const vec &g, const uvec &groups, 
+	const bool diag_cov, const uword family, const double tau_a, 
+	const double tau_b);
+
+#endif
@@ -0,0 +1,191 @@
+#include "profile.h"
+
+#ifdef GSVB_PROFILE
+
+static const char *phase_names[GSVB_PHASE_COUNT] = {
+    "setup", "mu", "s", "g", "tau", "elbo", "aux"
+};
+
+static thread_local fit_profiler *active_profiler = nullptr;
+
+
+fit_profiler::fit_profiler() :
+    start(clock::now()), group(-1),
+    time(GSVB_PHASE_COUNT, arma::fill::zeros),
+    calls(GSVB_PHASE_COUNT, arma::fill::zeros),
+    evals(GSVB_PHASE_COUNT, arma::fill::zeros),
+    iterations(GSVB_PHASE_COUNT, arma::fill::zeros),
+    sweep_start(GSVB_PHASE_COUNT, arma::fill::zeros),
+    sweep_evals_start(0.0), sweep_iterations_start(0.0),
+    previous(active_profiler)
+{
+    const char *path = std::getenv("GSVB_PROFILE_TRACE");
+    trace = path != nullptr && path[0] != '\0';
+
+    if (!previous) active_profiler = this;
+}
+
+
+fit_profiler::~fit_profiler()
+{
+    if (!previous) active_profiler = nullptr;
+}
+
+
+fit_profiler *fit_profiler::active()
+{
+    return active_profiler;
+}
+
+
+double fit_profiler::since_start(const clock::time_point t) const
+{
+    return std::chrono::duration<double>(t - start).count();
+}
+
+
+void fit_profiler::begin(const uword phase)
+{
+    const clock::time_point now = clock::now();
+
+    // pause the enclosing phase
+    if (!stack.empty())
+	time(stack.back().phase) +=
+	    std::chrono::duration<double>(now - stack.back().resume).count();
+
+    open_phase op = { phase, now, now };
+    stack.push_back(op);
+    calls(phase) += 1;
+}
+
+
+void fit_profiler::end()
+{
+    if (stack.empty()) return;
+
+    const clock::time_point now = clock::now();
+    const open_phase op = stack.back();
+    stack.pop_back();
+
+    time(op.phase) += std::chrono::duration<double>(now - op.resume).count();
+
+    if (!stack.empty())
+	stack.back().resume = now;
+
+    if (trace && events.size() < GSVB_PROFILE_MAX_EVENTS) {
+	trace_event e = { op.phase, group, since_start(op.begin),
+	    std::chrono::duration<double>(now - op.begin).count() };
+	events.push_back(e);
+    }
+}
+
+
+// the sweeps are timed from the end of the setup
+void fit_profiler::end_setup()
+{
+    end();
+    sweep_start = time;
+    sweep_evals_start = accu(evals);
+    sweep_iterations_start = accu(iterations);
+}
+
+
+void fit_profiler::set_group(const uword gi)
+{
+    group = static_cast<long>(gi);
+    if (group_evals.size() <= gi) {
+	group_evals.resize(gi + 1, 0.0);
+	group_iterations.resize(gi + 1, 0.0);
+    }
+}
+
+
+void fit_profiler::count(const uword n_evals, const uword n_iterations)
+{
+    const uword phase = stack.empty() ? GSVB_PHASE_SETUP : stack.back().phase;
+    evals(phase) += n_evals;
+    iterations(phase) += n_iterations;
+
+    if (group >= 0) {
+	group_evals.at(group) += n_evals;
+	group_iterations.at(group) += n_iterations;
+    }
+}
+
+
+// record the totals of the sweep that just finished
+void fit_profiler::end_sweep()
+{
+    sweep_time.push_back(time - sweep_start);
+    sweep_start = time;
+
+    const double e = accu(evals), it = accu(iterations);
+    sweep_evals.push_back(e - sweep_evals_start);
+    sweep_iterations.push_back(it - sweep_iterations_start);
+    sweep_evals_start = e;
+    sweep_iterations_start = it;
+
+    group = -1;
+}
+
+
+Rcpp::List fit_profiler::result()
+{
+    // close any open phases
+    while (!stack.empty()) end();
+
+    const double total = since_start(clock::now());
+
+    Rcpp::CharacterVector names(phase_names, phase_names + GSVB_PHASE_COUNT);
+    auto named = [&](const vec &x) -> Rcpp::NumericVector {
+	Rcpp::NumericVector v(x.begin(), x.end());
+	v.names() = names;
+	return v;
+    };
+
+    Rcpp::NumericMatrix st(sweep_time.size(), GSVB_PHASE_COUNT);
+    for (uword i = 0; i < sweep_time.size(); ++i)
+	for (uword j = 0; j < GSVB_PHASE_COUNT; ++j)
+	    st(i, j) = sweep_time.at(i)(j);
+    Rcpp::colnames(st) = names;
+
+    const char *path = std::getenv("GSVB_PROFILE_TRACE");
+    if (trace && path) write_trace(path);
+
+    return Rcpp::List::create(
+	Rcpp::Named("total") = total,
+	Rcpp::Named("time") = named(time),
+	Rcpp::Named("calls") = named(calls),
+	Rcpp::Named("evals") = named(evals),
+	Rcpp::Named("iterations") = named(iterations),
+	Rcpp::Named("group_evals") = group_evals,
+	Rcpp::Named("group_iterations") = group_iterations,
+	Rcpp::Named("sweep_time") = st,
+	Rcpp::Named("sweep_evals") = sweep_evals,
+	Rcpp::Named("sweep_iterations") = sweep_iterations
+    );
+}
+
+
+// Chrome trace event format, complete events ("ph": "X") in microseconds
+void fit_profiler::write_trace(const std::string &path) const
+{
+    std::ofstream out(path.c_str(), std::ios::trunc);
+    if (!out) {
+	Rcpp::warning("cannot write profile trace to " + path);
+	return;
+    }
+
+    out << "{\"traceEvents\":[\n";
+    for (uword i = 0; i < events.size(); ++i) {
+	const trace_event &e = events.at(i);
+	out << "{\"name\":\"" << phase_names[e.phase] <<
+	    "\",\"ph\":\"X\",\"pid\":1,\"tid\":1" <<
+	    ",\"ts\":" << 1e6 * e.begin << ",\"dur\":" << 1e6 * e.duration <<
+	    ",\"args\":{\"group\":" << e.group + 1 << "}}" <<
+	    (i + 1 < events.size() ? ",\n" : "\n");
+    }
+    out << "],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+#endif
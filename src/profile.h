@@ -0,0 +1,179 @@
+#ifndef GSVB_PROFILE_H
+#define GSVB_PROFILE_H
+
+// Instrumentation of the fitters, compiled in when GSVB_PROFILE is defined,
+// e.g. by adding -DGSVB_PROFILE to PKG_CPPFLAGS in src/Makevars. Otherwise
+// the macros below expand to nothing, or to the uninstrumented call, and
+// the fitters return an empty profile.
+//
+// Wall time is attributed to the innermost open phase, so the phase times
+// are exclusive and sum to at most the total time of the fit. The number
+// of objective evaluations and iterations of each L-BFGS call are counted
+// by an ensmallen callback and attributed to the innermost phase and the
+// current group.
+//
+// If the environment variable GSVB_PROFILE_TRACE is set to a path, every
+// phase is also written as an event in the Chrome trace format, viewable
+// in chrome://tracing or Perfetto, when the fit returns.
+
+#include "gsvb_types.h"
+
+#define GSVB_PHASE_SETUP 0	// precomputation, e.g. xtx
+#define GSVB_PHASE_MU 1
+#define GSVB_PHASE_S 2
+#define GSVB_PHASE_G 3
+#define GSVB_PHASE_TAU 4	// compute R, update_a_b
+#define GSVB_PHASE_ELBO 5
+#define GSVB_PHASE_AUX 6	// maintenance of XAX, P, Xm, Xs, jaak_vp
+#define GSVB_PHASE_COUNT 7
+
+#ifdef GSVB_PROFILE
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <fstream>
+
+#define GSVB_PROFILE_MAX_EVENTS 1000000
+
+class fit_profiler
+{
+    public:
+	fit_profiler();
+	~fit_profiler();
+
+	void begin(const uword phase);
+	void end();
+	void end_setup();
+	void set_group(const uword gi);
+	void count(const uword evals, const uword iterations);
+	void end_sweep();
+
+	Rcpp::List result();
+
+	// the profiler of the outermost fit running on this thread
+	static fit_profiler *active();
+
+    private:
+	typedef std::chrono::steady_clock clock;
+
+	struct open_phase {
+	    uword phase;
+	    clock::time_point begin;
+	    clock::time_point resume;
+	};
+
+	struct trace_event {
+	    uword phase;
+	    long group;
+	    double begin;
+	    double duration;
+	};
+
+	double since_start(const clock::time_point t) const;
+	void write_trace(const std::string &path) const;
+
+	clock::time_point start;
+	std::vector<open_phase> stack;
+	std::vector<trace_event> events;
+	bool trace;
+	long group;
+
+	vec time;
+	vec calls;
+	vec evals;
+	vec iterations;
+	std::vector<double> group_evals;
+	std::vector<double> group_iterations;
+
+	vec sweep_start;
+	std::vector<vec> sweep_time;
+	std::vector<double> sweep_evals;
+	std::vector<double> sweep_iterations;
+	double sweep_evals_start;
+	double sweep_iterations_start;
+
+	fit_profiler *previous;
+};
+
+
+// times the enclosing block
+class profile_scope
+{
+    public:
+	explicit profile_scope(const uword phase) {
+	    fit_profiler *p = fit_profiler::active();
+	    if (p) p->begin(phase);
+	}
+	~profile_scope() {
+	    fit_profiler *p = fit_profiler::active();
+	    if (p) p->end();
+	}
+};
+
+
+// ensmallen callback counting objective evaluations and iterations
+class profile_counter
+{
+    public:
+	profile_counter() : evals(0), iterations(0) {}
+
+	template <typename OptimizerType, typename FunctionType,
+		 typename MatType>
+	bool Evaluate(OptimizerType &, FunctionType &, const MatType &,
+		const double) {
+	    ++evals;
+	    return false;
+	}
+
+	template <typename OptimizerType, typename FunctionType,
+		 typename MatType>
+	bool StepTaken(OptimizerType &, FunctionType &, MatType &) {
+	    ++iterations;
+	    return false;
+	}
+
+	template <typename OptimizerType, typename FunctionType,
+		 typename MatType>
+	void EndOptimization(OptimizerType &, FunctionType &, MatType &) {
+	    fit_profiler *p = fit_profiler::active();
+	    if (p) p->count(evals, iterations);
+	}
+
+    private:
+	uword evals;
+	uword iterations;
+};
+
+#define GSVB_PROFILE_CAT_(a, b) a ## b
+#define GSVB_PROFILE_CAT(a, b) GSVB_PROFILE_CAT_(a, b)
+
+// a fitter called by another fitter, e.g. fit_linear_model from fit_linear,
+// records into the profiler of the outer fit
+#define GSVB_PROFILE_FIT() fit_profiler gsvb_profiler_own_; \
+    fit_profiler &gsvb_profiler_ = *fit_profiler::active(); \
+    (void) gsvb_profiler_
+#define GSVB_PROFILE_SETUP() gsvb_profiler_.begin(GSVB_PHASE_SETUP)
+#define GSVB_PROFILE_SETUP_END() gsvb_profiler_.end_setup()
+#define GSVB_PROFILE_SCOPE(phase) \
+    profile_scope GSVB_PROFILE_CAT(gsvb_scope_, __LINE__)(phase)
+#define GSVB_PROFILE_GROUP(gi) gsvb_profiler_.set_group(gi)
+#define GSVB_PROFILE_SWEEP() gsvb_profiler_.end_sweep()
+#define GSVB_PROFILE_RESULT() gsvb_profiler_.result()
+#define GSVB_OPTIMIZE(opt, fn, x) (opt).Optimize(fn, x, profile_counter())
+
+#else
+
+#define GSVB_PROFILE_FIT()
+#define GSVB_PROFILE_SETUP()
+#define GSVB_PROFILE_SETUP_END()
+#define GSVB_PROFILE_SCOPE(phase)
+#define GSVB_PROFILE_GROUP(gi)
+#define GSVB_PROFILE_SWEEP()
+#define GSVB_PROFILE_RESULT() Rcpp::List()
+#define GSVB_OPTIMIZE(opt, fn, x) (opt).Optimize(fn, x)
+
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+#include "quantile.h"
+
+
+p2_quantile::p2_quantile(const double p) :
+    p(p), n(0)
+{
+    for (int i = 0; i < 5; ++i) {
+	q[i] = 0.0;
+	m[i] = i + 1.0;
+    }
+}
+
+
+void p2_quantile::add(const double x)
+{
+    if (n < 5) {
+	q[n++] = x;
+	if (n == 5) std::sort(q, q + 5);
+	return;
+    }
+
+    // find the cell containing x and update the extreme markers
+    int k;
+    if (x < q[0]) {
+	q[0] = x;
+	k = 0;
+    } else if (x >= q[4]) {
+	q[4] = x;
+	k = 3;
+    } else {
+	k = 0;
+	while (x >= q[k + 1]) ++k;
+    }
+
+    for (int i = k + 1; i < 5; ++i) m[i] += 1.0;
+    n += 1;
+
+    // desired positions of the markers
+    const double nm1 = n - 1.0;
+    const double d[5] = { 1.0, 1.0 + nm1 * p / 2.0, 1.0 + nm1 * p, 
+	1.0 + nm1 * (1.0 + p) / 2.0, static_cast<double>(n) };
+
+    // adjust the heights of the middle markers
+    for (int i = 1; i < 4; ++i) 
+    {
+	const double di = d[i] - m[i];
+
+	if ((di >= 1.0 && m[i + 1] - m[i] > 1.0) || 
+	    (di <= -1.0 && m[i - 1] - m[i] < -1.0))
+	{
+	    const int ds = di > 0 ? 1 : -1;
+	    const double qp = parabolic(i, ds);
+
+	    q[i] = (q[i - 1] < qp && qp < q[i + 1]) ? qp : linear(i, ds);
+	    m[i] += ds;
+	}
+    }
+}
+
+
+double p2_quantile::parabolic(const int i, const double d) const
+{
+    return q[i] + d / (m[i + 1] - m[i - 1]) * (
+	(m[i] - m[i - 1] + d) * (q[i + 1] - q[i]) / (m[i + 1] - m[i]) +
+	(m[i + 1] - m[i] - d) * (q[i] - q[i - 1]) / (m[i] - m[i - 1]));
+}
+
+
+double p2_quantile::linear(const int i, const int d) const
+{
+    return q[i] + d * (q[i + d] - q[i]) / (m[i + d] - m[i]);
+}
+
+
+double p2_quantile::quantile() const
+{
+    if (n == 0) return arma::datum::nan;
+    if (n > 5) return q[2];
+
+    // exact for at most five observations
+    double x[5];
+    std::copy(q, q + n, x);
+    std::sort(x, x + n);
+
+    const double h = (n - 1.0) * p;
+    const uword lo = static_cast<uword>(h);
+    const uword hi = std::min<uword>(lo + 1, n - 1);
+    
+    return x[lo] + (h - lo) * (x[hi] - x[lo]);
+}
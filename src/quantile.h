@@ -0,0 +1,30 @@
+#ifndef GSVB_QUANTILE_H
+#define GSVB_QUANTILE_H
+
+#include <algorithm>
+
+#include "gsvb_types.h"
+
+// Online estimate of the p-th quantile using the P^2 algorithm of 
+// Jain and Chlamtac (1985). Five markers are kept, so the memory does not
+// depend on the number of observations. The first five observations are
+// kept exactly and the quantile is interpolated as in R's quantile (type 7)
+class p2_quantile
+{
+    public:
+	p2_quantile(const double p = 0.5);
+
+	void add(const double x);
+	double quantile() const;
+
+    private:
+	double parabolic(const int i, const double d) const;
+	double linear(const int i, const int d) const;
+
+	double p;
+	uword n;
+	double q[5];	// marker heights
+	double m[5];	// marker positions
+};
+
+#endif
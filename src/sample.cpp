@@ -0,0 +1,118 @@
+#include "sample.h"
+
+
+// g are the group inclusion probabilities, Ss are the group covariances 
+// and are only used if diag_cov = FALSE.
+beta_sampler::beta_sampler(const vec &mu, const vec &s, 
+	const std::vector<mat> &Ss, const vec &g, const uvec &groups, 
+	const bool diag_cov) :
+    mu(mu), s(s), g(g), diag_cov(diag_cov)
+{
+    const uvec ugroups = arma::unique(groups);
+
+    for (uword k = 0; k < ugroups.n_elem; ++k) 
+    {
+	Gs.push_back(arma::find(groups == ugroups(k)));
+
+	if (!diag_cov)
+	    Ls.push_back(g(k) > 0 ? mat(arma::chol(Ss.at(k), "lower")) : mat());
+    }
+}
+
+
+beta_sampler::beta_sampler(const vec &mu, const vec &g, const uvec &groups,
+	const std::vector<mat> &Ls) :
+    mu(mu), g(g), diag_cov(false), Ls(Ls)
+{
+    const uvec ugroups = arma::unique(groups);
+
+    for (uword k = 0; k < ugroups.n_elem; ++k) 
+	Gs.push_back(arma::find(groups == ugroups(k)));
+}
+
+
+// draw samples j0, ..., j1 - 1 of chunk c, the column indices are relative
+// to the first sample of the chunk
+void beta_sampler::draw_chunk(const unsigned int seed, const uword c, 
+	const uword j0, const uword j1, std::vector<uword> &rows, std::vector<uword> &cols, 
+	std::vector<double> &vals) const
+{
+    std::seed_seq sseq{ seed, static_cast<unsigned int>(c) };
+    std::mt19937_64 rng(sseq);
+    std::uniform_real_distribution<double> runif(0.0, 1.0);
+    std::normal_distribution<double> rnorm(0.0, 1.0);
+
+    const uword start = c * GSVB_SAMPLE_CHUNK;
+    const uword end = std::min(j1, start + GSVB_SAMPLE_CHUNK);
+
+    for (uword j = start; j < end; ++j)
+    {
+	for (uword k = 0; k < Gs.size(); ++k)
+	{
+	    if (runif(rng) > g(k)) continue;
+
+	    const uvec &G = Gs.at(k);
+	    vec z = vec(G.n_elem);
+	    for (uword i = 0; i < G.n_elem; ++i) z(i) = rnorm(rng);
+
+	    if (j < j0) continue;
+
+	    const vec b = diag_cov ? vec(mu(G) + s(G) % z) : 
+		vec(mu(G) + Ls.at(k) * z);
+
+	    for (uword i = 0; i < G.n_elem; ++i) {
+		rows.push_back(G(i));
+		cols.push_back(j - j0);
+		vals.push_back(b(i));
+	    }
+	}
+    }
+}
+
+
+// samples j0, ..., j1 - 1 as the columns of a sparse matrix
+sp_mat beta_sampler::sample(const unsigned int seed, const uword j0, 
+	const uword j1) const
+{
+    const uword c0 = j0 / GSVB_SAMPLE_CHUNK;
+    const uword n_chunks = (j1 + GSVB_SAMPLE_CHUNK - 1) / GSVB_SAMPLE_CHUNK - c0;
+
+    std::vector< std::vector<uword> > rows(n_chunks), cols(n_chunks);
+    std::vector< std::vector<double> > vals(n_chunks);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (uword c = 0; c < n_chunks; ++c)
+	draw_chunk(seed, c0 + c, j0, j1, rows.at(c), cols.at(c), vals.at(c));
+
+    // gather the chunks, locations are in column major order
+    uword nnz = 0;
+    for (uword c = 0; c < n_chunks; ++c) nnz += vals.at(c).size();
+
+    arma::umat locations = arma::umat(2, nnz);
+    vec values = vec(nnz);
+    uword pos = 0;
+    for (uword c = 0; c < n_chunks; ++c) {
+	for (uword i = 0; i < vals.at(c).size(); ++i, ++pos) {
+	    locations(0, pos) = rows.at(c).at(i);
+	    locations(1, pos) = cols.at(c).at(i);
+	    values(pos) = vals.at(c).at(i);
+	}
+	std::vector<uword>().swap(rows.at(c));
+	std::vector<uword>().swap(cols.at(c));
+	std::vector<double>().swap(vals.at(c));
+    }
+
+    return sp_mat(locations, values, mu.n_rows, j1 - j0, false);
+}
+
+
+// Sample from the variational posterior, see beta_sampler.
+//
+// [[Rcpp::export]]
+sp_mat sample_beta(const vec &mu, const vec &s, const std::vector<mat> &Ss,
+	const vec &g, const uvec &groups, const bool diag_cov, 
+	const uword samples, const unsigned int seed)
+{
+    const beta_sampler sampler(mu, s, Ss, g, groups, diag_cov);
+    return sampler.sample(seed, 0, samples);
+}
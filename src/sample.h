@@ -0,0 +1,58 @@
+#ifndef GSVB_SAMPLE_H
+#define GSVB_SAMPLE_H
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "gsvb_types.h"
+
+// number of samples drawn from a single RNG stream
+#define GSVB_SAMPLE_CHUNK 64
+
+
+// Draws samples from the variational posterior.
+//
+// The square root of each group covariance is computed once. Samples are
+// drawn in chunks of GSVB_SAMPLE_CHUNK columns, each chunk has its own RNG
+// stream seeded by (seed, chunk), so the samples do not depend on the 
+// number of threads or how the samples are split into blocks, as long as
+// blocks start at a multiple of GSVB_SAMPLE_CHUNK. Only the active groups
+// of each sample are stored.
+class beta_sampler
+{
+    public:
+	beta_sampler(const vec &mu, const vec &s, const std::vector<mat> &Ss,
+		const vec &g, const uvec &groups, const bool diag_cov);
+
+	// full covariances given their lower triangular factors, S = L L'
+	beta_sampler(const vec &mu, const vec &g, const uvec &groups,
+		const std::vector<mat> &Ls);
+
+	sp_mat sample(const unsigned int seed, const uword j0, 
+		const uword j1) const;
+
+    private:
+	void draw_chunk(const unsigned int seed, const uword c, 
+		const uword j0, const uword j1,
+		std::vector<uword> &rows, std::vector<uword> &cols,
+		std::vector<double> &vals) const;
+
+	const vec mu;
+	const vec s;
+	const vec g;
+	const bool diag_cov;
+
+	std::vector<uvec> Gs;
+	std::vector<mat> Ls;
+};
+
+sp_mat sample_beta(const vec &mu, const vec &s, const std::vector<mat> &Ss,
+	const vec &g, const uvec &groups, const bool diag_cov, 
+	const uword samples, const unsigned int seed);
+
+#endif
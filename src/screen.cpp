@@ -0,0 +1,96 @@
+#include "screen.h"
+
+#include <unordered_map>
+
+
+// first column and size of each group, groups are contiguous
+static void group_ranges(const uvec &groups, uvec &first, uvec &size)
+{
+    std::vector<uword> f, s;
+    for (uword j = 0; j < groups.n_elem; ++j) {
+	if (j == 0 || groups(j) != groups(j - 1)) {
+	    f.push_back(j);
+	    s.push_back(0);
+	}
+	++s.back();
+    }
+    first = arma::conv_to<uvec>::from(f);
+    size = arma::conv_to<uvec>::from(s);
+}
+
+
+// [[Rcpp::export]]
+Rcpp::List group_components(const mat &X, const uvec &groups, 
+	const uword k)
+{
+    uvec first, size;
+    group_ranges(groups, first, size);
+    const uword M = first.n_elem;
+
+    uword cols = 0;
+    for (uword gi = 0; gi < M; ++gi)
+	cols += std::min(k, size(gi));
+
+    mat Z = mat(X.n_rows, cols);
+    uvec zgroups = uvec(cols);
+
+    uword c = 0;
+    for (uword gi = 0; gi < M; ++gi)
+    {
+	const mat XG = X.cols(first(gi), first(gi) + size(gi) - 1);
+	const uword kk = std::min(k, size(gi));
+
+	if (kk == size(gi)) {
+	    Z.cols(c, c + kk - 1) = XG;
+	} else {
+	    mat U, V;
+	    vec d;
+	    if (!arma::svd_econ(U, d, V, XG, "right"))
+		Rcpp::stop("SVD of a group failed");
+	    Z.cols(c, c + kk - 1) = XG * V.cols(0, kk - 1);
+	}
+
+	zgroups.subvec(c, c + kk - 1).fill(groups(first(gi)));
+	c += kk;
+    }
+
+    return Rcpp::List::create(
+	Rcpp::Named("Z") = Z,
+	Rcpp::Named("groups") = zgroups
+    );
+}
+
+
+// [[Rcpp::export]]
+vec group_score(const mat &X, const uvec &groups, const uvec &which,
+	const vec &r, const vec &w)
+{
+    uvec first, size;
+    group_ranges(groups, first, size);
+
+    // position of each label in the ranges
+    std::unordered_map<uword, uword> pos;
+    for (uword j = 0; j < first.n_elem; ++j)
+	pos[groups(first(j))] = j;
+
+    vec score = vec(which.n_elem, arma::fill::zeros);
+
+    for (uword i = 0; i < which.n_elem; ++i)
+    {
+	const auto it = pos.find(which(i));
+	if (it == pos.end())
+	    Rcpp::stop("group not found");
+
+	const uword j = it->second;
+	const mat XG = X.cols(first(j), first(j) + size(j) - 1);
+	const vec u = XG.t() * r;
+	const mat A = XG.t() * (XG.each_col() % w);
+
+	vec a;
+	if (!arma::solve(a, A, u, arma::solve_opts::no_approx))
+	    a = arma::pinv(A) * u;
+	score(i) = dot(u, a);
+    }
+
+    return score;
+}
@@ -0,0 +1,23 @@
+#ifndef GSVB_SCREEN_H
+#define GSVB_SCREEN_H
+
+#include <vector>
+#include <algorithm>
+
+#include "gsvb_types.h"
+
+// Kernels of the coarse-to-fine screening of gsvb.fit_screened. The groups
+// are contiguous, so both kernels make a single pass over the columns of X
+// and their cost is linear in p.
+
+// Leading k principal directions of each group, Z_G = X_G V_G, returned
+// with the group of each column of Z
+Rcpp::List group_components(const mat &X, const uvec &groups, 
+	const uword k);
+
+// Score statistic of adding each group in `which` to a model with working
+// residuals r and weights w, r' X_G (X_G' W X_G)^-1 X_G' r
+vec group_score(const mat &X, const uvec &groups, const uvec &which,
+	const vec &r, const vec &w);
+
+#endif
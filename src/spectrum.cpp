@@ -0,0 +1,20 @@
+#include "spectrum.h"
+
+
+group_spectrum::group_spectrum(const mat &psi)
+{
+    if (!arma::eig_sym(values, vectors, psi))
+	Rcpp::stop("eigendecomposition of xtx(G, G) failed");
+
+    // psi is positive semi-definite, rounding can give small negative
+    // eigenvalues
+    values.clamp(0.0, arma::datum::inf);
+}
+
+
+mat group_spectrum::covariance(const double e_tau, const double v) const
+{
+    const vec d = 1.0 / (e_tau * values + v);
+    const mat S = vectors * arma::diagmat(d) * vectors.t();
+    return arma::symmatu(S);	// exactly symmetric, for chol and log_det
+}
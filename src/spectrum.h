@@ -0,0 +1,64 @@
+#ifndef GSVB_SPECTRUM_H
+#define GSVB_SPECTRUM_H
+
+#include "gsvb_types.h"
+
+// Eigendecomposition psi = Q diag(l) Q' of the block xtx(G, G) of a group, 
+// used by the covariance updates of large groups in place of an inverse
+// and a determinant per step of the optimization.
+//
+// The covariance S = (e_tau psi + v I)^-1 shares the eigenvectors of psi,
+// so for any f the traces tr f(psi, S) are sums over the eigenvalues, 
+// O(m), e.g. tr(psi S) = S_j l_j / (e_tau l_j + v), and S itself is formed
+// with a product, Q diag(1 / (e_tau l + v)) Q', rather than an inverse. 
+// xtx is fixed during a fit, so the decomposition is computed once, at a
+// cost of about one inverse.
+//
+// spectral_options selects the groups the decomposition is kept for, 
+// min_size = 0 disables it.
+struct spectral_options
+{
+    spectral_options() : min_size(0) { }
+
+    bool use(const uword m) const { return min_size > 0 && m >= min_size; }
+
+    uword min_size;
+};
+
+
+class group_spectrum
+{
+    public:
+	group_spectrum() { }
+	explicit group_spectrum(const mat &psi);
+
+	bool empty() const { return values.n_elem == 0; }
+
+	// tr f(psi), f is applied to each eigenvalue
+	template <typename F>
+	double trace(F f) const;
+
+	// S = (e_tau psi + v I)^-1
+	mat covariance(const double e_tau, const double v) const;
+
+	double bytes() const {
+	    return sizeof(double) * static_cast<double>(values.n_elem + 
+		    vectors.n_elem);
+	}
+
+    private:
+	vec values;
+	mat vectors;
+};
+
+
+template <typename F>
+double group_spectrum::trace(F f) const
+{
+    double res = 0.0;
+    for (uword j = 0; j < values.n_elem; ++j)
+	res += f(values(j));
+    return res;
+}
+
+#endif
@@ -0,0 +1,91 @@
+#include "summary.h"
+
+
+// Summaries of the variational posterior.
+//
+// Computes the marginal credible intervals of the coefficients, which 
+// account for the Dirac mass at zero, and selects the groups controlling 
+// the Bayesian FDR, i.e. the largest set of groups with the highest 
+// inclusion probabilities such that the mean of 1 - g over the set is 
+// at most fdr.
+//
+// g are the group inclusion probabilities, Ss are the group covariances
+// and are only used if diag_cov = FALSE.
+//
+// [[Rcpp::export]]
+Rcpp::List posterior_summary(const vec &mu, const vec &s, 
+	const std::vector<mat> &Ss, const vec &g, const uvec &groups, 
+	const bool diag_cov, const double prob, const double fdr)
+{
+    const uword p = mu.n_rows;
+    const uword M = g.n_rows;
+    const double a = 1.0 - prob;
+
+    // marginal std. devs and inclusion probabilities of the coefficients
+    vec sd = vec(p);
+    vec gj = vec(p);
+    const uvec ugroups = arma::unique(groups);
+    for (uword k = 0; k < M; ++k) {
+	const uvec G = arma::find(groups == ugroups(k));
+	sd(G) = diag_cov ? vec(s(G)) : vec(sqrt(Ss.at(k).diag()));
+	gj(G).fill(g(k));
+    }
+
+    vec lower = vec(p, arma::fill::zeros);
+    vec upper = vec(p, arma::fill::zeros);
+    uvec contains_dirac = uvec(p, arma::fill::ones);
+
+    // computed serially, R::qnorm may raise an R warning, which must not
+    // be done off the main thread
+    for (uword j = 0; j < p; ++j)
+    {
+	const double gg = gj(j), m = mu(j), sj = sd(j);
+
+	if (gg > 1.0 - a) 
+	{
+	    // the interval needs to be wider to contain 1 - a of the mass,
+	    // if it contains the Dirac mass it needs to be smaller
+	    const double ag = 1.0 - (1.0 - a) / gg;
+	    lower(j) = R::qnorm(ag / 2.0, m, sj, 1, 0);
+	    upper(j) = R::qnorm(1.0 - ag / 2.0, m, sj, 1, 0);
+	    contains_dirac(j) = 0;
+
+	    if (lower(j) <= 0 && upper(j) >= 0) {
+		lower(j) = R::qnorm(ag / 2.0 + (1.0 - gg) / 2.0, m, sj, 1, 0);
+		upper(j) = R::qnorm(1.0 - ag / 2.0 - (1.0 - gg) / 2.0, m, sj, 1, 0);
+		contains_dirac(j) = 1;
+	    }
+	} 
+	else if (gg >= a) 
+	{
+	    // always contains the Dirac mass, so the density accounted for 
+	    // by the Dirac is removed from the interval
+	    lower(j) = R::qnorm(a / 2.0 + (1.0 - gg) / 2.0, m, sj, 1, 0);
+	    upper(j) = R::qnorm(1.0 - a / 2.0 - (1.0 - gg) / 2.0, m, sj, 1, 0);
+	}
+	// otherwise the spike contains 1 - a of the mass, the interval is {0}
+    }
+
+    // Bayesian FDR selection of the groups
+    const uvec ord = arma::sort_index(g, "descend");
+    uvec selected = uvec(M, arma::fill::zeros);
+    double cum_fdr = 0.0, bfdr = 0.0;
+    uword n_sel = 0;
+    for (uword i = 0; i < M; ++i) {
+	cum_fdr += 1.0 - g(ord(i));
+	if (cum_fdr / (i + 1.0) > fdr) break;
+	bfdr = cum_fdr / (i + 1.0);
+	n_sel = i + 1;
+    }
+    if (n_sel > 0) 
+	selected(ord.head(n_sel)).ones();
+
+    return Rcpp::List::create(
+	Rcpp::Named("lower") = lower,
+	Rcpp::Named("upper") = upper,
+	Rcpp::Named("contains_dirac") = contains_dirac,
+	Rcpp::Named("inclusion_prob") = gj,
+	Rcpp::Named("selected") = selected,
+	Rcpp::Named("bfdr") = bfdr
+    );
+}
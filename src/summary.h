@@ -0,0 +1,17 @@
+#ifndef GSVB_SUMMARY_H
+#define GSVB_SUMMARY_H
+
+#include <vector>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "gsvb_types.h"
+
+Rcpp::List posterior_summary(const vec &mu, const vec &s, 
+	const std::vector<mat> &Ss, const vec &g, const uvec &groups, 
+	const bool diag_cov, const double prob, const double fdr);
+
+#endif
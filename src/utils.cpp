@@ -10,24 +10,30 @@ vec sigmoid(const vec &x) {
 }
 
 
+// the variances x'S x of each row x of X, given XX := X % X and 
+// S = diag(sig^2), or the full covariance S
+vec mvn_quad(const mat &XX, const vec &sig)
+{
+    return XX * (sig % sig);
+}
+
+
+vec mvn_quad(const mat &X, const mat &S)
+{
+    return sum((X * S) % X, 1);
+}
+
+
 vec mvnMGF(const mat &X, const mat &XX, const vec &mu, const vec &sig) 
 {
-    return exp(X * mu + 0.5 * XX * (sig % sig));
+    return exp(X * mu + 0.5 * mvn_quad(XX, sig));
 }
 
 
 // [[Rcpp::export]]
 vec mvnMGF(const mat &X, const vec &mu, const mat &S)
 {
-    const int n = X.n_rows;
-    vec res = vec(n, arma::fill::zeros);
-
-    for (int i = 0; i < n; ++i) {
-	vec x = X.row(i).t();
-	res(i) = exp(dot(x, mu) + 0.5 * dot(x, S * x));
-    }
-
-    return res;
+    return exp(X * mu + 0.5 * mvn_quad(X, S));
 }
 
 // [[Rcpp::export]]
@@ -48,24 +54,28 @@ vec mvnMGF_chol(const mat &X, const vec &mu, const mat &U)
 vec compute_P_G(const mat &X, const mat &XX, const vec &mu, const vec &s, const vec &g, 
 	const uvec &G)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_AUX);
     return ((1 - g(G(0))) + g(G(0)) * mvnMGF(X.cols(G), XX.cols(G), mu(G), s(G)));
 }
 
 
 vec compute_P_G(const mat &X_G, const mat &XX_G, const vec &mu_G, const vec &s_G, const double g)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_AUX);
     return ((1 - g) + g * mvnMGF(X_G, XX_G, mu_G, s_G));
 }
 
 
 vec compute_P_G(const mat &X_G, const mat &mu_G, const mat &S, const double g) 
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_AUX);
     return ((1.0 - g) + g * mvnMGF(X_G, mu_G, S));
 }
 
 
 vec compute_P_G_chol(const mat &X_G, const mat &mu_G, const mat &U, const double g)
 {
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_AUX);
     return ((1.0 - g) + g * mvnMGF_chol(X_G, mu_G, U));
 }
 
@@ -110,3 +120,95 @@ vec compute_P_chol(const mat &X, const vec &mu, const std::vector<mat> &Us,
     }
     return P;
 }
+
+
+
+// ---------------- ELBO bookkeeping -----------------
+//
+// The ELBO decomposes into a likelihood term and a sum over groups. The 
+// contribution of group k only depends on (mu_G, S_G, g_k), so it is stored
+// in a per-group array and refreshed when the group is updated.
+//
+// elbo_group computes the terms of group k that are available in closed
+// form: the normalizing constant Ck of the multivariate double exponential,
+// the prior terms, the entropy of the slab (ldet := log det S) and the KL
+// divergence between Bern(g) and Bern(w).
+double elbo_group(const double mk, const double g, const double w, 
+	const double lambda, const double ldet)
+{
+    const double Ck = -mk*log(2.0) - 0.5*(mk-1.0)*log(M_PI) - lgamma(0.5*(mk+1));
+
+    return g * Ck +
+	0.5 * g * mk +
+	g * mk * log(lambda) +
+	0.5 * g * (mk * log(2.0 * M_PI) + ldet) -
+	g * log((1e-8 + g) / (1e-8 + w)) -	// add 1e-8 to prevent -Inf
+	(1 - g) * log((1-g + 1e-8) / (1 - w));
+}
+
+
+// Refresh the contribution of group gi. The Monte-Carlo integral of 
+// E_Q [ lambda * g_k || b_{G_k} || ] is evaluated jointly over the groups 
+// by the elbo_worker, see async.h. 
+//
+// bound_k holds lambda * g_k * sqrt(E_Q || b_{G_k} ||^2) which upper bounds
+// the integral by Jensen's inq., giving a deterministic lower bound of the
+// ELBO that is used to check convergence.
+void elbo_group_refresh(vec &elbo_k, vec &bound_k, const uword gi, 
+	const vec &mu_G, const vec &s_G, const double g, const double w, 
+	const double lambda)
+{
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_ELBO);
+    elbo_k(gi) = elbo_group(s_G.n_rows, g, w, lambda, accu(log(s_G % s_G)));
+    bound_k(gi) = lambda * g * sqrt(dot(mu_G, mu_G) + dot(s_G, s_G));
+}
+
+
+void elbo_group_refresh(vec &elbo_k, vec &bound_k, const uword gi, 
+	const vec &mu_G, const mat &S, const double g, const double w, 
+	const double lambda)
+{
+    elbo_group_refresh(elbo_k, bound_k, gi, mu_G, S, log_det_cov(S), g, w,
+	    lambda);
+}
+
+
+void elbo_group_refresh(vec &elbo_k, vec &bound_k, const uword gi, 
+	const vec &mu_G, const mat &S, const double ldet, const double g, 
+	const double w, const double lambda)
+{
+    GSVB_PROFILE_SCOPE(GSVB_PHASE_ELBO);
+    elbo_k(gi) = elbo_group(S.n_rows, g, w, lambda, ldet);
+    bound_k(gi) = lambda * g * sqrt(dot(mu_G, mu_G) + trace(S));
+}
+
+
+// Drop the groups with inclusion probability below min_g from the fitted
+// state (mu, s, g are of length p, Ss holds a matrix per group if not
+// empty). Used to return compact fits when the number of active groups
+// is small relative to p.
+//
+// Returns the labels of the groups that are kept.
+uvec compact_state(vec &mu, vec &s, std::vector<mat> &Ss, vec &g, 
+	const uvec &groups, const double min_g)
+{
+    const uvec ugroups = arma::unique(groups);
+    const uvec keep = arma::find(g >= min_g);
+    
+    std::vector<mat> Ss_active;
+    std::vector<uword> active;
+    for (uword k = 0; k < ugroups.n_elem; ++k) {
+	const uword j = arma::find(groups == ugroups(k), 1).eval().at(0);
+	if (g(j) < min_g) continue;
+
+	active.push_back(ugroups(k));
+	if (!Ss.empty()) Ss_active.push_back(Ss.at(k));
+    }
+
+    mu = vec(mu(keep));
+    s = vec(s(keep));
+    g = vec(g(keep));
+    Ss.swap(Ss_active);
+
+    return arma::conv_to<uvec>::from(active);
+}
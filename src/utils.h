@@ -2,14 +2,21 @@
 #define GSVB_UTILS_H
 
 #include <vector>
+#include <limits>
+#include <algorithm>
 
 #include "RcppEnsmallen.h"
 #include "gsvb_types.h"
+#include "profile.h"
 
 double sigmoid(double x);
 
 vec sigmoid(const vec &x);
 
+vec mvn_quad(const mat &XX, const vec &sig);
+
+vec mvn_quad(const mat &X, const mat &S);
+
 vec mvnMGF(const mat &X, const mat &XX, const vec &mu, const vec &sig);
 
 vec mvnMGF(const mat &X, const vec &mu, const mat &S);
@@ -37,4 +44,78 @@ vec compute_P(const mat &X, const vec &mu, const std::vector<mat> &Ss,
 vec compute_P_chol(const mat &X, const vec &mu, const std::vector<mat> &Us,
 	const vec &g, const uvec &groups);
 
+
+// ELBO bookkeeping
+double elbo_group(const double mk, const double g, const double w, 
+	const double lambda, const double ldet);
+
+void elbo_group_refresh(vec &elbo_k, vec &bound_k, const uword gi, 
+	const vec &mu_G, const vec &s_G, const double g, const double w, 
+	const double lambda);
+
+void elbo_group_refresh(vec &elbo_k, vec &bound_k, const uword gi, 
+	const vec &mu_G, const mat &S, const double g, const double w, 
+	const double lambda);
+
+// as above, given ldet := log det S
+void elbo_group_refresh(vec &elbo_k, vec &bound_k, const uword gi, 
+	const vec &mu_G, const mat &S, const double ldet, const double g, 
+	const double w, const double lambda);
+
+
+// log det S of a covariance, computed in the log domain as det(S)
+// underflows for groups of a few hundred coefficients
+inline double log_det_cov(const mat &S)
+{
+    double val, sign;
+    arma::log_det(val, sign, S);
+    return val;
+}
+
+
+// compact fit results
+uvec compact_state(vec &mu, vec &s, std::vector<mat> &Ss, vec &g, 
+	const uvec &groups, const double min_g);
+
+
+// standard error of the mean from the running sum of squares
+inline double mc_se(const double m2, const uword n)
+{
+    if (n < 2) return std::numeric_limits<double>::infinity();
+    return sqrt(m2 / (n - 1.0) / n);
+}
+
+
+// Monte-Carlo integration with an adaptive number of samples.
+//
+// Samples are drawn in batches of size `batch` until the standard error of
+// the estimate falls below `tol` relative to its magnitude (or below `tol`
+// for estimates smaller than 1), or `max_n` samples have been drawn, the
+// last batch is cut to max_n. `draw` is called once per sample and returns
+// the value of the integrand. If tol <= 0 a single batch is drawn.
+//
+// Returns a vector containing the estimate and its standard error
+template <typename F>
+vec mc_integrate(F draw, const uword batch, const double tol, const uword max_n)
+{
+    const uword b = std::max<uword>(batch, 1);
+    double mean = 0.0, m2 = 0.0;
+    uword n = 0;
+
+    do {
+	const uword k = tol > 0 && max_n > n ? std::min(b, max_n - n) : b;
+	for (uword i = 0; i < k; ++i) {
+	    const double x = draw();
+	    const double d = x - mean;
+	    n += 1;
+	    mean += d / n;
+	    m2 += d * (x - mean);	// Welford's update
+	}
+    } while (tol > 0 && n < max_n && 
+	    mc_se(m2, n) > tol * std::max(1.0, std::abs(mean)));
+
+    vec res = { mean, mc_se(m2, n) };
+    return res;
+}
+
 #endif